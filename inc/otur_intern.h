@@ -0,0 +1,25 @@
+/* - otur_intern.h (Part of the Otur Scheduler)
+ *
+ *   Command String Intern Table for the Otur Scheduler
+ *   Every distinct command line is stored once, reference counted, and shared by all of the
+ *   process nodes running it.  Nodes hold a small handle instead of their own copy.
+ *   - otur_intern() finds or adds a string and takes a reference; otur_intern_release() drops one.
+ *   - The string is freed with its last reference; otur_intern_trim() frees the table itself once
+ *     nothing is left in it.
+ */
+#ifndef OTUR_INTERN_H
+#define OTUR_INTERN_H
+
+#include <stdint.h>
+
+typedef uint32_t Otur_str;       // Handle to an interned string
+#define OTUR_STR_NIL 0xFFFFFFFFu // No string
+
+// Prototypes
+Otur_str otur_intern(const char *str);
+void otur_intern_release(Otur_str handle);
+const char *otur_intern_str(Otur_str handle);
+uint32_t otur_intern_count();
+void otur_intern_trim();
+
+#endif
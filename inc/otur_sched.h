@@ -10,22 +10,51 @@
 #ifndef OTUR_SCHED_H
 #define OTUR_SCHED_H
 
+#include <stdint.h>
+#include <sys/types.h>
 #include "vm_settings.h"
+#include "otur_table.h"
+#include "otur_intern.h"
+#include "otur_tenant.h"
+
+#define OTUR_EXIT_CANCELLED 125 // Exit Code of a process cancelled because a process it ran after failed
+
+// Process State Word (one 32-bit word per process in the Process Table, see otur_state)
+// - The low 16 bits are laid out as they always were: Exit Code in bits 0-7, Flags [C,D,R,U,H] in 11-15.
+// - Above them are the Flags that came later: Blocked (in the Wait Queue), Group (in a gang) and
+//   Pinned (to a set of CPUs).
+// - It's only ever changed whole, by compare-and-swap (see otur_transition), so any thread may read
+//   any process' state at any time and see one consistent word.
+#define OTUR_EXIT_MASK   0x000000FFu
+#define OTUR_CRITICAL    (1u << 11)
+#define OTUR_DEFUNCT     (1u << 12)
+#define OTUR_READY       (1u << 13)
+#define OTUR_RUNNING     (1u << 14)
+#define OTUR_HIGH        (1u << 15)
+#define OTUR_BLOCKED     (1u << 16)
+#define OTUR_GROUP       (1u << 17)
+#define OTUR_PINNED      (1u << 18) // Limited to some CPUs (see otur_pin)
+#define OTUR_STATE_LOW   0x0000FFFFu // The part shown, and persisted, as it always was
+
+// Order within each Ready Queue (see otur_select)
+#define OTUR_POLICY_FIFO 0 // First come, first served
+#define OTUR_POLICY_SJF  1 // Least predicted CPU time left first (see otur_predict), starving ones before all
 
 // Process Node Definition
+// - The hot fields (state, age, queue links) live in the Process Table, in slot idx (see otur_table.h).
+//   Use the otur_* accessors below for them.
 typedef struct process_node {
   pid_t pid;            // PID of the Process you're Tracking
-  char *cmd;            // Name of the Process being run
-  unsigned short state; // 16-bit: Contains the Flags [H,U,R,D,C] AND Exit Code
-  int age;              // How long this has been in the Ready Queue - Low since last run
-  struct process_node *next; // Pointer to next Process Node in a linked list
+  Otur_str cmd;         // Name of the Process being run, shared through the intern table (see otur_cmd)
+  uint32_t idx;         // Slot in the Process Table: Flags [H,U,R,D,C], Exit Code, Age and Links
 } Otur_process_s;
 
 // Queue Header Definition
 typedef struct queue_header {
   int count;            // How many Nodes are in this linked list?
-  Otur_process_s *head; // Points to FIRST node of linked list.  No Dummy Nodes.
-  Otur_process_s *tail; // Points to LAST node of linked list.  No Dummy Nodes. Optional.
+  uint32_t head;        // Slot of the FIRST node of the list, OTUR_NIL if empty.  No Dummy Nodes.
+  uint32_t tail;        // Slot of the LAST node of the list, OTUR_NIL if empty.
+  uint32_t id;          // Tags the slots in this list, so one pass can age them all
 } Otur_queue_s;
 
 // Schedule Header Definition
@@ -33,6 +62,12 @@ typedef struct otur_schedule {
   Otur_queue_s *ready_queue_high; // Linked List of High Priority Processes ready to Run on CPU
   Otur_queue_s *ready_queue_normal; // Linked List of Normal Processes ready to Run on CPU
   Otur_queue_s *defunct_queue; // Linked List of Defunct Processes 
+  Otur_queue_s *wait_queue; // Linked List of Blocked Processes, kept off the Ready Queues until runnable
+  Otur_queue_s *pending_queue; // Linked List of Processes waiting on others to finish first (see otur_depend)
+  int policy; // OTUR_POLICY_FIFO or OTUR_POLICY_SJF
+  uint32_t defer_kb; // While non-zero, processes this large (see otur_footprint) only run when nothing smaller is ready
+  int defer_hold;    // While set, processes that large aren't selected at all (eg. one is running already)
+  long deferred;     // Selections that passed over a ready process that large
 } Otur_schedule_s;
 
 // Prototypes
@@ -44,7 +79,66 @@ Otur_process_s *otur_select(Otur_schedule_s *schedule);
 int otur_promote(Otur_schedule_s *schedule);
 int otur_exited(Otur_schedule_s *schedule, Otur_process_s *process, int exit_code);
 int otur_killed(Otur_schedule_s *schedule, pid_t pid, int exit_code);
+int otur_block(Otur_schedule_s *schedule, Otur_process_s *process);
+int otur_unblock(Otur_schedule_s *schedule, pid_t pid);
+int otur_join(Otur_process_s *process, const char *gang);
+int otur_select_gang(Otur_schedule_s *schedule, Otur_process_s *leader, Otur_process_s **members, int max);
+int otur_depend(Otur_schedule_s *schedule, Otur_process_s *process, pid_t prereq);
+int otur_cancel(Otur_schedule_s *schedule, Otur_process_s **cancelled, int max);
+int otur_assign(Otur_process_s *process, int tenant);
+int otur_charge(Otur_process_s *process, uint32_t used_usec);
+int otur_predict(Otur_process_s *process, uint64_t usec);
+int otur_footprint(Otur_process_s *process, uint64_t kb);
+int otur_override(Otur_process_s *process, uint32_t quantum_usec, int level);
+int otur_pin(Otur_process_s *process, uint64_t cpus);
+int otur_learn(Otur_process_s *process, uint32_t used_usec, uint32_t slice_usec, uint32_t min_quantum, uint32_t max_quantum);
 int otur_reap(Otur_schedule_s *schedule, pid_t pid);
 void otur_cleanup(Otur_schedule_s *schedule);
 
+// Accessors for the fields kept in the Process Table
+static inline const char *otur_cmd(Otur_process_s *node) { return otur_intern_str(node->cmd); }
+static inline uint32_t otur_state(Otur_process_s *node) { return __atomic_load_n(&OTUR_STATE(node->idx), __ATOMIC_ACQUIRE); }
+static inline int otur_age(Otur_process_s *node) { return OTUR_AGE(node->idx); }
+static inline void otur_set_age(Otur_process_s *node, int age) { OTUR_AGE(node->idx) = age; }
+static inline uint32_t otur_born(Otur_process_s *node) { return OTUR_BORN(node->idx); }
+static inline uint32_t otur_died(Otur_process_s *node) { return OTUR_DIED(node->idx); }
+static inline uint32_t otur_quantum(Otur_process_s *node) { return OTUR_QUANTUM(node->idx); }
+static inline unsigned short otur_usage(Otur_process_s *node) { return OTUR_USAGE(node->idx); }
+static inline Otur_str otur_gang(Otur_process_s *node) { return OTUR_GANG(node->idx); }
+static inline const char *otur_gang_name(Otur_process_s *node) { return otur_intern_str(OTUR_GANG(node->idx)); }
+static inline int otur_tenant_of(Otur_process_s *node) { return OTUR_TENANT(node->idx); }
+static inline unsigned short otur_deps(Otur_process_s *node) { return OTUR_DEPS(node->idx); }
+static inline unsigned short otur_path(Otur_process_s *node) { return OTUR_PATH(node->idx); }
+static inline uint32_t otur_predicted(Otur_process_s *node) { return OTUR_PREDICT(node->idx); }
+static inline uint32_t otur_ran(Otur_process_s *node) { return OTUR_RAN(node->idx); }
+static inline uint32_t otur_rss(Otur_process_s *node) { return OTUR_RSS(node->idx); }
+static inline uint32_t otur_fixed_quantum(Otur_process_s *node) { return OTUR_FIXED(node->idx); }
+static inline int otur_level(Otur_process_s *node) { return OTUR_LEVEL(node->idx); }
+static inline int otur_boost(Otur_process_s *node) { return OTUR_BOOST(node->idx); }
+static inline uint64_t otur_cpus(Otur_process_s *node) { return OTUR_CPUS(node->idx); }
+
+// Changes a process' state in one step: clears the clear bits, then sets the set bits.
+// - Safe against any other thread changing the same word; retries until its swap lands.
+// Returns the state as it was just before the change.
+static inline uint32_t otur_transition(Otur_process_s *node, uint32_t clear, uint32_t set) {
+  uint32_t *word = &OTUR_STATE(node->idx);
+  uint32_t old = __atomic_load_n(word, __ATOMIC_RELAXED);
+  while(!__atomic_compare_exchange_n(word, &old, (old & ~clear) | set, 0, __ATOMIC_ACQ_REL, __ATOMIC_RELAXED)) {
+    // Another thread got there first: old is now its word, so try again from that
+  }
+  return old;
+}
+
+// List walking: otur_first(queue), then otur_next(node) until NULL
+static inline Otur_process_s *otur_first(Otur_queue_s *queue) {
+  return queue->head == OTUR_NIL ? NULL : OTUR_NODE(queue->head);
+}
+static inline Otur_process_s *otur_last(Otur_queue_s *queue) {
+  return queue->tail == OTUR_NIL ? NULL : OTUR_NODE(queue->tail);
+}
+static inline Otur_process_s *otur_next(Otur_process_s *node) {
+  uint32_t next = OTUR_NEXT(node->idx);
+  return next == OTUR_NIL ? NULL : OTUR_NODE(next);
+}
+
 #endif
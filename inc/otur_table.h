@@ -0,0 +1,129 @@
+/* - otur_table.h (Part of the Otur Scheduler)
+ *
+ *   Process Table for the Otur Scheduler
+ *   Every process lives in one slot of a shared, index-based table kept as a structure of arrays,
+ *   so the hot per-process fields (state, age, queue links) of neighbouring slots share cache lines.
+ *   - Slots are grouped into fixed-size chunks that are never moved, so a slot index stays valid
+ *     (and readable from another thread) while the table grows.
+ *   - Queues link slots through the next[]/prev[] arrays by 32-bit index; OTUR_NIL ends a list.
+ *   - Aging is one vectorized pass over the age[] arrays (AVX2 or SSE2, scalar elsewhere).
+ *   - Dependencies between processes are edges in a separate pool, each on two lists: the out list of
+ *     the process that must finish first, and the in list of the process that waits for it.
+ */
+#ifndef OTUR_TABLE_H
+#define OTUR_TABLE_H
+
+#include <stdint.h>
+#include <sys/types.h>
+
+#define OTUR_NIL        0xFFFFFFFFu // No slot
+#define OTUR_CHUNK_BITS 12
+#define OTUR_CHUNK_SIZE (1u << OTUR_CHUNK_BITS) // Slots per chunk
+#define OTUR_MAX_CHUNKS 1024                     // 4M slots in all
+#define OTUR_USAGE_UNKNOWN 0xFFFF               // No slice measured yet
+
+struct process_node;
+
+// One chunk of the table.  Arrays are 32-byte aligned for the vector passes.
+typedef struct otur_chunk {
+  int32_t age[OTUR_CHUNK_SIZE];      // Scheduler ticks spent in the Ready Queue - Normal
+  uint32_t queue[OTUR_CHUNK_SIZE];   // Id of the queue holding this slot, 0 if none
+  uint32_t next[OTUR_CHUNK_SIZE];    // Queue links (or the free list)
+  uint32_t prev[OTUR_CHUNK_SIZE];
+  uint32_t hnext[OTUR_CHUNK_SIZE];   // Next slot in the same pid hash bucket
+  pid_t pid[OTUR_CHUNK_SIZE];
+  uint32_t state[OTUR_CHUNK_SIZE];   // State Word: Flags and Exit Code (see OTUR_HIGH etc in otur_sched.h)
+  uint32_t born[OTUR_CHUNK_SIZE];    // otur_table_now() when invoked
+  uint32_t died[OTUR_CHUNK_SIZE];    // otur_table_now() when it went Defunct
+  uint32_t quantum[OTUR_CHUNK_SIZE]; // Learned quantum (usec), 0 until its first slice (see otur_learn)
+  uint32_t burst[OTUR_CHUNK_SIZE];   // Average CPU time used per slice (usec)
+  uint16_t usage[OTUR_CHUNK_SIZE];   // Average share of each slice used (per mille), OTUR_USAGE_UNKNOWN at first
+  uint32_t gang[OTUR_CHUNK_SIZE];    // Interned name of its gang (see otur_join), OTUR_STR_NIL if none
+  uint8_t tenant[OTUR_CHUNK_SIZE];   // Tenant it is charged to (see otur_tenant.h), 0 by default
+  uint16_t deps[OTUR_CHUNK_SIZE];    // Prerequisites it is still waiting on (see otur_depend), or OTUR_DEPS_*
+  uint16_t path[OTUR_CHUNK_SIZE];    // Longest chain of processes waiting on it, directly or not
+  uint32_t out[OTUR_CHUNK_SIZE];     // First edge to a process waiting on it, OTUR_NIL if none
+  uint32_t in[OTUR_CHUNK_SIZE];      // First edge from a process it waits on, OTUR_NIL if none
+  uint32_t predict[OTUR_CHUNK_SIZE]; // Predicted CPU time for its whole run (usec, see otur_predict), 0 if unknown
+  uint32_t ran[OTUR_CHUNK_SIZE];     // CPU time charged to it so far (usec, see otur_charge)
+  uint32_t rss[OTUR_CHUNK_SIZE];     // Resident memory when last sampled (KB, see otur_footprint), 0 if unknown
+  uint32_t fixed[OTUR_CHUNK_SIZE];   // Quantum asked for at launch (usec, see otur_override), 0 if none
+  uint8_t level[OTUR_CHUNK_SIZE];    // Priority level asked for at launch (see otur_override), 0 if none
+  uint8_t boost[OTUR_CHUNK_SIZE];    // Levels learned ahead of DEFAULT_PRIORITY by using little CPU (see otur_learn)
+  uint64_t cpus[OTUR_CHUNK_SIZE];    // CPUs it may run on, one bit each (see otur_pin), 0 for any
+  struct process_node *node[OTUR_CHUNK_SIZE]; // Cold data (command) for the slot
+} Otur_chunk_s;
+
+// One dependency: dependent runs after prereq has exited successfully
+typedef struct otur_edge {
+  uint32_t prereq;
+  uint32_t dependent;
+  uint32_t next_out;      // Next edge on prereq's out list (or the free list)
+  uint32_t next_in;       // Next edge on dependent's in list
+} Otur_edge_s;
+
+// The Table
+typedef struct otur_table {
+  Otur_chunk_s *chunks[OTUR_MAX_CHUNKS];
+  uint32_t used;          // Slots ever handed out (high water mark)
+  uint32_t live;          // Slots in use now
+  uint32_t free_head;     // Released slots, chained through next[]
+  uint32_t *buckets;      // pid hash -> first slot
+  uint32_t bucket_count;  // Power of two
+  uint32_t last_queue_id; // Ids handed out to queues so far
+  Otur_edge_s *edges;     // Dependency pool (indexed by edge, may move as it grows)
+  uint32_t edge_capacity;
+  uint32_t edge_used;     // Edges ever handed out (high water mark)
+  uint32_t edge_live;     // Edges in use now
+  uint32_t edge_free;     // Released edges, chained through next_out
+  uint32_t leveled;       // Live slots with a priority level (see otur_override)
+  uint32_t boosted;       // Live slots with a learned boost (see otur_learn)
+} Otur_table_s;
+
+extern Otur_table_s g_otur_table;
+
+// Slot field access (idx must be a slot that has been handed out)
+#define OTUR_CHUNK(idx) (g_otur_table.chunks[(idx) >> OTUR_CHUNK_BITS])
+#define OTUR_SLOT(idx)  ((idx) & (OTUR_CHUNK_SIZE - 1))
+#define OTUR_AGE(idx)   (OTUR_CHUNK(idx)->age[OTUR_SLOT(idx)])
+#define OTUR_QUEUE(idx) (OTUR_CHUNK(idx)->queue[OTUR_SLOT(idx)])
+#define OTUR_NEXT(idx)  (OTUR_CHUNK(idx)->next[OTUR_SLOT(idx)])
+#define OTUR_PREV(idx)  (OTUR_CHUNK(idx)->prev[OTUR_SLOT(idx)])
+#define OTUR_PID(idx)   (OTUR_CHUNK(idx)->pid[OTUR_SLOT(idx)])
+#define OTUR_STATE(idx) (OTUR_CHUNK(idx)->state[OTUR_SLOT(idx)])
+#define OTUR_NODE(idx)  (OTUR_CHUNK(idx)->node[OTUR_SLOT(idx)])
+#define OTUR_BORN(idx)  (OTUR_CHUNK(idx)->born[OTUR_SLOT(idx)])
+#define OTUR_DIED(idx)  (OTUR_CHUNK(idx)->died[OTUR_SLOT(idx)])
+#define OTUR_QUANTUM(idx) (OTUR_CHUNK(idx)->quantum[OTUR_SLOT(idx)])
+#define OTUR_BURST(idx)   (OTUR_CHUNK(idx)->burst[OTUR_SLOT(idx)])
+#define OTUR_USAGE(idx)   (OTUR_CHUNK(idx)->usage[OTUR_SLOT(idx)])
+#define OTUR_GANG(idx)    (OTUR_CHUNK(idx)->gang[OTUR_SLOT(idx)])
+#define OTUR_TENANT(idx)  (OTUR_CHUNK(idx)->tenant[OTUR_SLOT(idx)])
+#define OTUR_DEPS(idx)    (OTUR_CHUNK(idx)->deps[OTUR_SLOT(idx)])
+#define OTUR_PATH(idx)    (OTUR_CHUNK(idx)->path[OTUR_SLOT(idx)])
+#define OTUR_OUT(idx)     (OTUR_CHUNK(idx)->out[OTUR_SLOT(idx)])
+#define OTUR_IN(idx)      (OTUR_CHUNK(idx)->in[OTUR_SLOT(idx)])
+#define OTUR_PREDICT(idx) (OTUR_CHUNK(idx)->predict[OTUR_SLOT(idx)])
+#define OTUR_RAN(idx)     (OTUR_CHUNK(idx)->ran[OTUR_SLOT(idx)])
+#define OTUR_RSS(idx)     (OTUR_CHUNK(idx)->rss[OTUR_SLOT(idx)])
+#define OTUR_FIXED(idx)   (OTUR_CHUNK(idx)->fixed[OTUR_SLOT(idx)])
+#define OTUR_LEVEL(idx)   (OTUR_CHUNK(idx)->level[OTUR_SLOT(idx)])
+#define OTUR_BOOST(idx)   (OTUR_CHUNK(idx)->boost[OTUR_SLOT(idx)])
+#define OTUR_CPUS(idx)    (OTUR_CHUNK(idx)->cpus[OTUR_SLOT(idx)])
+#define OTUR_EDGE(edge)   (g_otur_table.edges[edge])
+
+#define OTUR_DEPS_FAILED    0xFFFF // A prerequisite failed: the process must be cancelled
+#define OTUR_DEPS_CANCELLED 0xFFFE // Handed out by otur_cancel, waiting to be killed
+
+// Prototypes
+uint32_t otur_table_alloc(struct process_node *node, pid_t pid);
+void otur_table_release(uint32_t idx);
+uint32_t otur_table_find(pid_t pid, uint32_t queue_id);
+uint32_t otur_table_queue_id();
+uint32_t otur_table_link(uint32_t prereq, uint32_t dependent);
+void otur_table_unlink(uint32_t idx);
+int otur_table_age(uint32_t queue_id, int starving_age);
+const char *otur_table_simd();
+uint32_t otur_table_now();
+
+#endif
@@ -0,0 +1,43 @@
+/* - otur_tenant.h (Part of the Otur Scheduler)
+ *
+ *   Tenants for the Otur Scheduler (fair share between the groups sharing one schedule)
+ *   Every process belongs to one tenant, tenant 0 ("default") unless it was assigned another.
+ *   Each tenant has a number of shares, and is charged the CPU time its processes use.
+ *   - otur_select first picks the most under-served tenant with a ready process (the least
+ *     recent usage per share), then the best process of that tenant by the usual Otur rules.
+ *   - Recent usage decays with every charge, so a tenant that was busy long ago isn't held back.
+ *   - Time can also be held against a tenant before it is measured (eg. for the slots its processes take
+ *     in one quantum), counted when picking until otur_tenant_release drops every hold.
+ *   - Tenants are never removed; otur_tenant_reset() drops them all (see otur_cleanup).
+ */
+#ifndef OTUR_TENANT_H
+#define OTUR_TENANT_H
+
+#include <stdint.h>
+#include "otur_intern.h"
+
+#define OTUR_MAX_TENANTS 64   // Tenants with a ready process are tracked in one 64-bit mask
+#define OTUR_TENANT_DECAY 6   // Each charge decays recent usage by 1/2^OTUR_TENANT_DECAY
+
+// One Tenant
+typedef struct otur_tenant {
+  Otur_str name;        // Interned name, OTUR_STR_NIL for the default tenant
+  uint32_t shares;      // Relative share of the CPUs
+  uint64_t recent;      // Decayed CPU time charged (usec), for picking the most under-served
+  uint64_t total;       // All CPU time charged (usec)
+  uint64_t held;        // CPU time held against it until its use is charged (usec, see otur_tenant_hold)
+} Otur_tenant_s;
+
+// Prototypes
+int otur_tenant(const char *name);
+int otur_tenant_shares(int tenant, uint32_t shares);
+const Otur_tenant_s *otur_tenant_info(int tenant);
+const char *otur_tenant_name(int tenant);
+int otur_tenant_count();
+void otur_tenant_charge(int tenant, uint32_t usec);
+void otur_tenant_hold(int tenant, uint32_t usec);
+void otur_tenant_release();
+int otur_tenant_pick(uint64_t ready);
+void otur_tenant_reset();
+
+#endif
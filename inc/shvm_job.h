@@ -0,0 +1,52 @@
+/* - shvm_job.h (StrawHat VM)
+ *
+ *   Job Library for StrawHat VM (link with -lshvm_job)
+ *   A process launched by shvm has a control page shared with it, so it can tell the Dispatcher
+ *   what it's doing instead of being found out by signals and /proc:
+ *   - shvm_yield() gives up the rest of its slice, and returns once it's given the next one.
+ *   - shvm_block() says it's about to block (parked in the Wait Queue at once) until shvm_unblock().
+ *   - shvm_progress() publishes how far it has got (see coop).
+ *   Every call maps the page the first time; anywhere else (not under shvm, or coop off) they do
+ *   nothing, and shvm_yield() is just sched_yield().  Suspending by signal still works either way.
+ *
+ *   The page itself is laid out here for shvm's side too (see vm_coop.h).
+ */
+#ifndef SHVM_JOB_H
+#define SHVM_JOB_H
+
+#include <stdint.h>
+#include <sys/types.h>
+
+#define SHVM_PAGE_MAGIC   0x53485650 // "SHVP"
+#define SHVM_PAGE_VERSION 1
+#define SHVM_PAGE_NAME    "/shvm-%d-%d" // shm_open name, from shvm's pid and the job's
+
+// What the job last said it's doing
+enum shvm_job_states { SHVM_JOB_RUNNING = 0, SHVM_JOB_YIELDED, SHVM_JOB_BLOCKED };
+
+/* The Control Page
+ * - event and slice are futex words: the job bumps event (and wakes shvm) whenever it changes state,
+ *   and shvm bumps slice (and wakes the job) whenever it gives the job a slice.
+ */
+typedef struct shvm_page {
+  uint32_t magic;       // SHVM_PAGE_MAGIC once shvm has set it up
+  uint32_t version;     // SHVM_PAGE_VERSION
+  uint32_t event;       // Bumped by the job (shvm may bump it to end its own wait)
+  uint32_t state;       // SHVM_JOB_*, written by the job
+  uint32_t slice;       // Bumped by shvm
+  uint32_t attached;    // 1 once the job has mapped the page
+  uint64_t slice_usec;  // Length of the slice it was last given, written by shvm
+  uint64_t progress;    // Whatever the job last published
+  uint64_t yields;      // Counted by the job
+  uint64_t blocks;
+} Shvm_page_s;
+
+// Prototypes
+int shvm_attach();
+void shvm_yield();
+void shvm_block();
+void shvm_unblock();
+void shvm_progress(uint64_t done);
+long shvm_slice_usec();
+
+#endif
@@ -0,0 +1,31 @@
+/* - vm_admit.h (StrawHat VM)
+ *
+ *   Admission Control for StrawHat VM
+ *   Caps how many processes of each class (critical, high, normal) may be live at once: forked and
+ *   not yet exited, whether on a CPU, ready, waiting or pending.  A launch past its class' limit is
+ *   never forked: it waits as a command line in the Admission Queue until there's room (the highest
+ *   class first, oldest first within it; see shell_admit_waiting), or with `admit reject`, is refused.
+ *   - At most ADMIT_QUEUE_SLOTS lines wait at once; past that, launches are refused either way.
+ *   - Limits and what happens past them can be changed at any time (see admit).
+ *   - Under memory pressure, launches other than critical ones can be held the same way (see vm_pressure.h).
+ */
+#ifndef VM_ADMIT_H
+#define VM_ADMIT_H
+
+#include <stddef.h>
+#include "vm_process.h"
+
+enum admit_classes { ADMIT_CRITICAL = 0, ADMIT_HIGH, ADMIT_NORMAL, ADMIT_CLASSES };
+enum admit_results { ADMIT_REFUSED = -1, ADMIT_WAITING = 0, ADMIT_NOW = 1 };
+
+// Prototypes
+int admit_class(int is_critical, int is_high);
+int admit_check(Process_data_s *proc);
+int admit_next(char *line, size_t size);
+int admit_waiting();
+void admit_set_limit(int class, int limit);
+void admit_set_refuse(int refuse);
+void admit_totals(long *queued, long *refused);
+void print_admit();
+
+#endif
@@ -0,0 +1,27 @@
+/* - vm_archive.h (StrawHat VM)
+ *
+ *   Exit Archive for StrawHat VM
+ *   When a Defunct process is auto-reaped (see autoreap), its node is dropped from the Schedule and
+ *   what's left of it is packed into a fixed ring of small records, so `reap <pid>` can still
+ *   report how it ended.  Once the ring is full, the oldest records are overwritten.
+ */
+#ifndef VM_ARCHIVE_H
+#define VM_ARCHIVE_H
+
+#include <stdint.h>
+#include <sys/types.h>
+
+// One archived process (13 bytes)
+typedef struct archive_record {
+  pid_t pid;
+  uint32_t born;     // Times on the otur_table_now() clock (ms)
+  uint32_t died;
+  uint8_t exit_code;
+} __attribute__((packed)) Archive_record_s;
+
+// Prototypes
+void archive_add(pid_t pid, int exit_code, uint32_t born, uint32_t died);
+int archive_find(pid_t pid, Archive_record_s *record);
+void archive_totals(long *archived, long *failed);
+
+#endif
@@ -0,0 +1,27 @@
+/* - vm_cgroup.h (StrawHat VM)
+ *
+ *   cgroup v2 Enforcement for StrawHat VM
+ *   Where a cgroup v2 hierarchy is writable, every process is moved into a cgroup of its own under a
+ *   subtree this shvm owns (shvm.<pid>, next to the shvm itself).  Suspending or resuming it is then one
+ *   write to its cgroup.freeze, which also catches anything it has forked, and its share of the CPUs
+ *   is its cpu.weight (when the cpu controller can be enabled there).
+ *   - Everything here returns -1 for a process without a cgroup, so the caller falls back to signals.
+ *   - Call with the schedule locked (see vm_cs.c); none of this is thread safe on its own.
+ */
+#ifndef VM_CGROUP_H
+#define VM_CGROUP_H
+
+#include <sys/types.h>
+
+// Prototypes
+int cgroup_initialize();
+void cgroup_cleanup();
+int cgroup_adopt(pid_t pid, int weight);
+int cgroup_freeze(pid_t pid, int frozen);
+int cgroup_set_weight(pid_t pid, int weight);
+char cgroup_run_state(pid_t pid);
+long long cgroup_cpu_usec(pid_t pid);
+void cgroup_release(pid_t pid);
+void print_cgroup();
+
+#endif
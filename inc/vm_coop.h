@@ -0,0 +1,35 @@
+/* - vm_coop.h (StrawHat VM)
+ *
+ *   Cooperating Processes for StrawHat VM
+ *   Every launch gets a control page in shared memory (laid out in shvm_job.h) that the process may
+ *   map with the job library, to yield the rest of its slice, say it's about to block, or publish its
+ *   progress.  The Dispatcher waits out a cooperating process' slice on a futex in its page instead of
+ *   the timer, so a yield or a block ends the slice at once rather than being found by the next probe.
+ *   - A process that never maps its page is timed and signalled exactly as before; so is every
+ *     process while the Dispatcher isn't waiting on it (eg. under the concurrent engine).
+ *   - Pages are opened and closed under the schedule lock; coop_wait is for the Dispatcher alone,
+ *     and coop_interrupt (from any thread) cuts it short, as does coop_exited (from a signal handler)
+ *     once the process waited on has exited.
+ */
+#ifndef VM_COOP_H
+#define VM_COOP_H
+
+#include <sys/types.h>
+
+// How a wait on a process' page ended
+enum coop_waits { COOP_RAN_OUT = 0, COOP_YIELDED, COOP_BLOCKED, COOP_WOKEN };
+
+// Prototypes
+int coop_open(pid_t pid);
+void coop_close(pid_t pid);
+void coop_slice(pid_t pid, long usec);
+void coop_resume(pid_t pid);
+int coop_wait(pid_t pid, long usec);
+int coop_state(pid_t pid);
+void coop_interrupt();
+void coop_exited(pid_t pid);
+void coop_set_enabled(int on);
+void print_coop(int list);
+void coop_stop();
+
+#endif
@@ -11,11 +11,14 @@
 #include <pthread.h>
 #include "vm_process.h"
 #include "otur_sched.h"
+#include "vm_snapshot.h"
 
 // Shared Globals (Condition Variables for Mutex)
 extern pthread_cond_t cs_cv;
 extern pthread_condattr_t cs_cvattr;
-extern pthread_mutex_t cs_cv_m;
+
+// Auto-Reap Limits (see cs_set_autoreap)
+enum autoreap_limits { AUTOREAP_OFF = 0, AUTOREAP_COUNT, AUTOREAP_AGE, AUTOREAP_MEM };
 
 // Prototypes
 void initialize_cs_system();
@@ -26,8 +29,18 @@ void cs_otur_terminated(pid_t pid, int exit_code);
 void cs_suspend(pid_t pid);
 void cs_resume(pid_t pid);
 void cs_reap(pid_t pid);
+int cs_reap_code(pid_t pid);
+void cs_wait(pid_t pid);
+int cs_recover();
+void cs_set_autoreap(int limit, long value);
+void print_autoreap();
+int cs_live_count();
+void cs_live_by_class(int live[]);
+int cs_is_running();
 void cs_exiting_process(int exit_code);
 void print_schedule();
+void cs_print_schedule();
+const Snapshot_s *cs_snapshot();
 void print_otur_queue(Otur_queue_s *queue);
 void print_process_node(Otur_process_s *node);
 void start_cs();
@@ -39,6 +52,14 @@ void handle_ctrlc();
 void toggle_cs();
 void print_cs_status();
 void set_run_usec(useconds_t time);
+void set_adaptive_quantum(int on);
+void cs_set_engine(int slots);
+void print_engine();
+void cs_set_policy(int policy);
+void print_policy();
+void cs_print_pressure();
+void cs_set_tenant(char *name, int shares);
+void print_tenants();
 useconds_t get_run_usec();
 void set_between_usec(useconds_t time);
 useconds_t get_between_usec();
@@ -0,0 +1,29 @@
+/* - vm_ctl.h (StrawHat VM)
+ *
+ *   Local Control Socket for StrawHat VM
+ *   Lets other local processes submit jobs and query the schedule over a Unix-domain socket.
+ *
+ *   Protocol: one request per line.  Every request gets exactly one response:
+ *     OK <n>       followed by n lines of data (n may be 0)
+ *     ERR <reason>
+ *   Requests:
+ *     SUBMIT <command line>       Launch one command.  Data: its PID (0 while it waits for admission).
+ *     BATCH <n>                   The next n lines are command lines.  Data: one PID (0 or -1) per line.
+ *     KILL <pid>                  Kill a Running or Ready process.
+ *     REAP [pid]                  Reap a Defunct process (default the first).  Data: its exit code.
+ *     STATS                       Data: "key value" lines with counts and settings.
+ *     SCHEDULE                    Data: "where pid flags age exit_code command" per process.
+ *   STATS answers from the schedule's summary and SCHEDULE from a copy of it (see vm_snapshot.h),
+ *   so neither holds up the Dispatcher; the "snapshot" stat is the schedule's version.
+ *     SET runtime|delaytime <usec>, SET debug on|off
+ *     START, STOP                 Start or Stop the CS System.
+ *     QUIT                        Close this connection.
+ */
+#ifndef VM_CTL_H
+#define VM_CTL_H
+
+// Prototypes
+int ctl_start(const char *path);
+void ctl_stop();
+
+#endif
@@ -0,0 +1,24 @@
+/* - vm_history.h (StrawHat VM)
+ *
+ *   Runtime History for StrawHat VM
+ *   Remembers how long each command takes, across restarts, in a memory-mapped file (HISTORY_PATH)
+ *   keyed by the command line (without the shell's own flags).  Every process is timed from launch,
+ *   and each one that finishes on its own with exit code 0 updates its command's running averages
+ *   of CPU and wall time (1/4 weight to the newest run).  The CPU average is what the Scheduler is
+ *   told a new run will need (see otur_predict and policy sjf).
+ *   - When the table is full, the command updated least recently is forgotten.
+ *   - Call with the schedule locked (see vm_cs.c); none of this is thread safe on its own.
+ */
+#ifndef VM_HISTORY_H
+#define VM_HISTORY_H
+
+#include <sys/types.h>
+
+// Prototypes
+int history_open(const char *path);
+long long history_start(pid_t pid, char **argv);
+void history_finish(pid_t pid, long long cpu_usec, int success);
+void print_history();
+void history_close();
+
+#endif
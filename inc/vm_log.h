@@ -0,0 +1,32 @@
+/* - vm_log.h (StrawHat VM)
+ *
+ *   Logging behind the PRINT_* macros in vm_support.h
+ *   - Levels below LOG_MIN_LEVEL (vm_settings.h) compile away; levels below g_log_level are
+ *     skipped at runtime before any formatting is done.  Debug also needs g_debug_mode.
+ *   - By default a message is written with a single stdio call on the calling thread.
+ *   - A thread that calls log_thread_async() instead formats into its own lock-free ring,
+ *     which a background writer drains in batched writev calls (see log_start).
+ *   - Colors are only added when stdout is a terminal.
+ */
+#ifndef VM_LOG_H
+#define VM_LOG_H
+
+// Log Levels (lowest to highest)
+#define LOG_DEBUG  0
+#define LOG_INFO   1
+#define LOG_STATUS 2
+#define LOG_WARN   3
+
+// Runtime level; messages below it are dropped without being formatted.
+extern int g_log_level;
+
+// Prototypes
+void vm_log(int level, const char *fmt, ...) __attribute__((format(printf, 2, 3)));
+void log_start();
+void log_stop();
+void log_flush();
+void log_thread_async();
+int log_level_from_string(const char *str);
+const char *log_level_name(int level);
+
+#endif
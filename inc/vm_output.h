@@ -0,0 +1,34 @@
+/* - vm_output.h (StrawHat VM)
+ *
+ *   Captured Output for StrawHat VM
+ *   Each process' stdout and stderr go into a pipe instead of the terminal, and a background thread
+ *   moves whatever arrives into that process' ring of OUTPUT_RING_BYTES in memory (see output, tail).
+ *   A full ring drops its oldest bytes, so a process never waits on a reader or on the terminal.
+ *   - Rings outlive their process until their slot is needed; at most OUTPUT_SLOTS are kept, and
+ *     the one finished longest ago goes first.  With every slot still being written, a new process
+ *     writes to the terminal as before.
+ *   - output_prepare and output_attach bracket a launch, under the shell's Launch Guard.
+ */
+#ifndef VM_OUTPUT_H
+#define VM_OUTPUT_H
+
+#include <stddef.h>
+#include <sys/types.h>
+
+// What is known about one process' output
+typedef struct output_info {
+  long long total;   // Bytes it has written
+  long long dropped; // Of those, overwritten before being shown
+  int writing;       // 1 until it (and everything it forked) has closed its end
+} Output_info_s;
+
+// Prototypes
+int output_start();
+int output_prepare();
+void output_attach(pid_t pid);
+long output_copy(pid_t pid, char *buf, size_t size, Output_info_s *info);
+void output_set_capture(int capture);
+void print_output();
+void output_stop();
+
+#endif
@@ -0,0 +1,37 @@
+/* - vm_persist.h (StrawHat VM)
+ *
+ *   Schedule Snapshot for StrawHat VM
+ *   Mirrors every process the Scheduler tracks into a memory-mapped file (PERSIST_PATH), updated
+ *   in place on each queue transition, so a later `shvm --recover` can rebuild the Ready and
+ *   Defunct Queues and re-adopt the processes that are still alive, without re-spawning anything.
+ *
+ *   Adopted processes are no longer our children: their exit codes can't be collected, so any that
+ *   finish after the restart are moved to the Defunct Queue with PERSIST_LOST_EXIT.
+ */
+#ifndef VM_PERSIST_H
+#define VM_PERSIST_H
+
+#include <sys/types.h>
+#include "otur_sched.h"
+
+// Where a process was when it was last recorded
+#define PERSIST_FREE    0 // Unused record
+#define PERSIST_CPU     1
+#define PERSIST_HIGH    2
+#define PERSIST_NORMAL  3
+#define PERSIST_DEFUNCT 4
+#define PERSIST_LISTS   5
+
+// Exit code given to adopted processes, whose real exit codes can't be collected
+#define PERSIST_LOST_EXIT 255
+
+// Prototypes
+int persist_open(const char *path, int recover);
+int persist_recover(Otur_schedule_s *schedule);
+void persist_track(Otur_process_s *node, int where);
+void persist_forget(pid_t pid);
+int persist_adopted(pid_t pid);
+int persist_alive(pid_t pid);
+void persist_close();
+
+#endif
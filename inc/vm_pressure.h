@@ -0,0 +1,31 @@
+/* - vm_pressure.h (StrawHat VM)
+ *
+ *   Memory Pressure for StrawHat VM
+ *   The Dispatcher samples the host's memory pressure (PSI, /proc/pressure/memory: the share of the
+ *   last 10 seconds some task was stalled on memory) every PRESSURE_SAMPLE_MSEC.  Past the threshold
+ *   the host is under pressure until it falls below the lower one, and while it is, each process'
+ *   resident set is sampled with it (/proc/<pid>/statm):
+ *   - processes of the large size or more are only resumed when nothing smaller is ready (see
+ *     otur_footprint), and the concurrent engine runs at most one of them at a time.
+ *   - optionally, launches other than critical ones wait in the Admission Queue (see vm_admit.h).
+ *   - Thresholds can be changed at any time (see pressure).  Without PSI, nothing is ever deferred.
+ */
+#ifndef VM_PRESSURE_H
+#define VM_PRESSURE_H
+
+#include <stdint.h>
+#include <sys/types.h>
+
+// Prototypes
+int pressure_sample();
+int pressure_active();
+int pressure_holds_admission();
+uint32_t pressure_large_kb();
+long pressure_rss_kb(pid_t pid);
+void pressure_set_enabled(int enabled);
+void pressure_set_threshold(double on_pct, double off_pct);
+void pressure_set_large(long kb);
+void pressure_set_hold(int hold);
+void print_pressure(int large_ready, long deferred);
+
+#endif
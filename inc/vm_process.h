@@ -9,6 +9,7 @@
 #ifndef VM_PROCESS_H
 #define VM_PROCESS_H
 
+#include <stdint.h>
 #include "vm_settings.h"
 
 // Internal struct to track Process Handling
@@ -22,6 +23,13 @@ typedef struct process_data {
   int is_high;              // 1 if the process is High Priority, 0 for Normal Priority
   pid_t pid;                // OS Generated, Guaranteed Unique
   struct process_data *next;// Singly Linked List
+  char gang[MAX_GANG_NAME]; // Gang to run with (-g name), empty for none (after next: the library's layout is unchanged)
+  char tenant[MAX_TENANT_NAME]; // Tenant it's charged to (-u name), empty for the default one
+  char name[MAX_JOB_NAME];  // Job name others can run after (-n name), empty for none
+  char after[MAX_AFTER][MAX_JOB_NAME]; // Job names or pids it runs after (-a job), empty when unused
+  uint32_t quantum_usec;    // Quantum for each of its slices (-q usec), 0 for the usual one
+  int level;                // Priority level (-p level, MIN_PRIORITY to MAX_PRIORITY), 0 for its queue's
+  uint64_t cpus;            // CPUs it may run on (-cpu list), one bit each, 0 for any
 } Process_data_s;
 
 // Prototypes
@@ -18,6 +18,12 @@
 // Turns Debug printing on (1) and off (0)
 #define DEFAULT_DEBUG 0
 
+// Logging: levels are 0 debug, 1 info, 2 status, 3 warn
+#define LOG_MIN_LEVEL     0 // Messages below this level are compiled out entirely
+#define DEFAULT_LOG_LEVEL 0 // Messages below this level are skipped at runtime (see loglevel)
+#define LOG_RING_SLOTS  256 // Messages each asynchronous thread may have waiting to be written
+#define LOG_MAX_RINGS     4 // Threads that may log asynchronously
+
 // Process-related Settings
 #define DEFAULT_PRIORITY 128   
 #define MIN_PRIORITY 1
@@ -29,11 +35,122 @@
 #define SLEEP_MIN_USEC    100000 //   100000 = 100ms
 #define SLEEP_MAX_USEC  10000000 // 10000000 = 10sec
 
+// Adaptive Quantum (1 on, 0 off): each process runs for about 1.5x its average CPU burst,
+// from SLEEP_MIN_USEC up to 4x the runtime, instead of always the runtime (see quantum).
+#define ADAPTIVE_QUANTUM 1
+// Levels ahead of DEFAULT_PRIORITY a process that uses none of its slices is picked at in its Ready Queue
+// (scaled down by the share it does use, see otur_learn).  Ages are left alone, so starving ones still go first.
+#define LEARN_BOOST_LEVELS 64
+
+// Launch Overrides (-q usec, -p level, -cpu list): a quantum, priority level and CPUs for one process
+#define LAUNCH_MIN_QUANTUM 10000 //    10000 = 10ms, the shortest -q (well past the block probe)
+#define LEVEL_NICE_SPAN       20 // Nice is 0 at DEFAULT_PRIORITY, -20 at MIN_PRIORITY and 19 at MAX_PRIORITY
+#define MAX_PIN_CPUS          64 // -cpu may name CPUs 0 to 63
+
+// Dispatch Engine: processes run at once (1 is serial, one at a time by stop/continue; see engine)
+#define ENGINE_SLOTS       1
+#define ENGINE_MAX_SLOTS  64
+// Nice values the concurrent engine runs each Otur priority at (Normal also runs as SCHED_BATCH)
+#define NICE_CRITICAL      0
+#define NICE_HIGH          5
+#define NICE_NORMAL       10
+
+// cgroup v2 Enforcement: suspend/resume through cgroup.freeze where writable (0 - signals only)
+#define USE_CGROUPS            1
+#define CGROUP_SLOTS        4096 // Most processes with a cgroup at once (the rest use signals)
+// cpu.weight the concurrent engine gives each Otur priority (IDLE: Normal ones while a critical one runs)
+#define WEIGHT_CRITICAL     1000
+#define WEIGHT_HIGH          200
+#define WEIGHT_NORMAL         50
+#define WEIGHT_IDLE            1
+
+// Gangs (-g name): processes selected, resumed and suspended together, past the engine slots if need be
+#define MAX_GANG_NAME 32 // Longest gang name, with its terminator
+
+// Tenants (-u name): groups sharing the CPUs by their shares, whatever their number of processes (see tenant)
+#define DEFAULT_TENANT_SHARES 100
+#define MAX_TENANT_NAME        32 // Longest tenant name, with its terminator
+
+// Dependencies (-n name, -a name or pid): a process waits in the Pending Queue until all it runs after succeed
+#define MAX_JOB_NAME 32  // Longest job name, with its terminator
+#define MAX_AFTER     4  // Most processes one process can run after
+#define JOB_NAMES   256  // Job names remembered (the oldest are forgotten first)
+
+// Shortest Job First (see policy): each command's CPU and wall time are remembered across runs in
+// HISTORY_PATH, and under sjf each Ready Queue runs the least predicted CPU time left first.
+#define DEFAULT_POLICY      0       // 0 - first come first served, 1 - shortest job first
+#define SJF_UNKNOWN_USEC    1000000 // CPU time assumed for a command never seen to finish
+#define HISTORY_PATH  ".shvm_history"
+#define HISTORY_SLOTS 4096 // Commands remembered (must be a power of two; the least recent go first)
+#define HISTORY_RUNS  4096 // Most processes timed at once (the rest aren't recorded)
+
+// Admission Control (see admit): most live processes of each class (0 for no limit).  Launches past
+// them wait unforked in the Admission Queue, up to ADMIT_QUEUE_SLOTS, or are refused (ADMIT_REFUSE 1).
+#define DEFAULT_ADMIT_CRITICAL 0
+#define DEFAULT_ADMIT_HIGH     0
+#define DEFAULT_ADMIT_NORMAL   0
+#define DEFAULT_ADMIT_REFUSE   0
+#define ADMIT_QUEUE_SLOTS   4096
+
+// Memory Pressure (see pressure): every PRESSURE_SAMPLE_MSEC the Dispatcher reads how much of the last
+// 10 sec the host stalled on memory (PSI).  From PRESSURE_ON_PCT until it falls below PRESSURE_OFF_PCT,
+// processes with PRESSURE_LARGE_KB or more resident only run when nothing smaller is ready, and with
+// PRESSURE_HOLD_ADMIT 1, launches other than critical ones wait in the Admission Queue.
+#define DEFAULT_PRESSURE         1 // 0 - ignore memory pressure, 1 - act on it
+#define PRESSURE_SAMPLE_MSEC  1000
+#define PRESSURE_ON_PCT       10.0
+#define PRESSURE_OFF_PCT       5.0
+#define PRESSURE_LARGE_KB   262144 // 262144 KB = 256 MB
+#define PRESSURE_HOLD_ADMIT      0
+
+// Launch Zygote (see zygote): launches take a stub process forked ahead by a small helper forked at
+// startup, instead of forking shvm.  Command paths are resolved once and kept in ZYGOTE_PATHS slots.
+#define DEFAULT_ZYGOTE 1  // 0 - fork shvm for every launch, 1 - use the zygote's stubs
+#define ZYGOTE_STUBS   4  // Stubs kept ready
+#define ZYGOTE_PATHS  64  // Commands whose paths are remembered
+
+// Captured Output (see output, tail): each process' stdout and stderr go to its own ring in memory
+// instead of the terminal.  A full ring drops its oldest bytes; the newest OUTPUT_SLOTS are kept.
+#define DEFAULT_CAPTURE       1 // 0 - processes write to the terminal, 1 - capture their output
+#define OUTPUT_RING_BYTES 65536 // Bytes kept per process
+#define OUTPUT_SLOTS        256 // Processes whose output is kept
+#define OUTPUT_TAIL_LINES    10 // Lines shown by tail without a count
+
+// Cooperating Processes (see coop): each launch gets a control page in shared memory, which a process
+// linked with the job library (shvm_job.h) uses to yield or block, ending its slice early.
+#define DEFAULT_COOP   1   // 0 - launches get no page, 1 - every launch gets one
+#define COOP_SLOTS   256   // Most pages out at once (later launches go without)
+
 // Time to wait between Context Switches before Running Next Process
 #define BETWEEN_USEC      1000000 //  1000000 =  1000ms = 1 sec
 #define BETWEEN_MIN_USEC   100000 //   100000 =   100ms = 0.1 sec
 #define BETWEEN_MAX_USEC 10000000 // 10000000 = 10000ms = 10 sec
 
+// How long into a quantum the Dispatcher checks whether the process is blocked (sleeping or on I/O).
+// Blocked processes wait off the Ready Queues, and are checked again in one batch each quantum.
+#define BLOCK_PROBE_USEC     2000 //     2000 =     2ms
+
+// How often the wait built-in checks whether processes have finished
+#define WAIT_POLL_USEC       1000 //     1000 =     1ms
+
+// Exits the SIGCHLD handler can hold for the Dispatcher to finish (see cs_otur_terminated).  Past them,
+// an exit is dropped, and the process is found gone (exit code 42) the next time it's selected.
+#define EXIT_SLOTS           4096
+
+// Schedule snapshot kept for shvm --recover (relative to the directory shvm is started in)
+#define PERSIST_PATH  ".shvm_state"
+#define PERSIST_SLOTS 65536 // Most processes the snapshot can track (must be a power of two)
+
+// Auto-Reap: Defunct processes past any of these limits (0 for none) are reaped automatically
+// into the Exit Archive, which keeps the pid, exit code and timing of the last ARCHIVE_SLOTS.
+#define DEFAULT_AUTOREAP_COUNT 4096 // Most processes kept in the Defunct Queue
+#define DEFAULT_AUTOREAP_AGE      0 // Seconds a process is kept after it exits
+#define DEFAULT_AUTOREAP_KB       0 // KB of memory the Defunct Queue may hold
+#define ARCHIVE_SLOTS         16384 // Processes remembered after being auto-reaped
+
+// Most clients connected to the control socket (shvm -s path) at once
+#define CTL_MAX_CLIENTS 16
+
 
 //////////////////////////////////////////////////////////////////////
 //  Do not modify anything below this line. 
@@ -9,7 +9,15 @@
 #ifndef VM_SHELL_H
 #define VM_SHELL_H
 
+#include <stdio.h>
+#include <sys/types.h>
+
 extern int g_debug_mode;
 void shell(); // Run the Virtual System with Shell Access
+void shell_batch(FILE *script); // Run the Virtual System from a script or pipe, then exit
+pid_t shell_launch(char *line); // Launch a command line from another thread, returns the PID (0 if it waits for admission)
+int shell_admit_waiting(); // Launch what waits for admission that there's now room for
+void shell_guard_launches(); // Make launches safe against SIGCHLD on other threads
+void shell_sigchld(); // Run the SIGCHLD handler for a SIGCHLD taken on a thread that blocks it
 
 #endif
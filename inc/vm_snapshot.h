@@ -0,0 +1,63 @@
+/* - vm_snapshot.h (StrawHat VM)
+ *
+ *   Schedule Snapshots for StrawHat VM
+ *   Whoever changes the schedule calls snapshot_changed as they unlock it, which only bumps the
+ *   version and keeps a summary (the count in each place and the pid on the CPU) current: no copying
+ *   and no allocation, so it's safe in the SIGCHLD handler and costs the same however many processes
+ *   there are.  Readers of the summary (STATS, status) never take the schedule lock.
+ *   - The full copy is made lazily: a reader that wants one (schedule, SCHEDULE on the control
+ *     socket) calls snapshot_publish with the schedule locked only if snapshot_stale says the latest
+ *     copy is older than the current version, then reads it without the lock.
+ *   - snapshot_get takes a reference to the latest copy and snapshot_put drops it.  A copy that has
+ *     been replaced is freed (or reused for a later one) once its last reader is done with it.
+ *   - A copy's version is the summary's version when it was made.
+ */
+#ifndef VM_SNAPSHOT_H
+#define VM_SNAPSHOT_H
+
+#include <time.h>
+#include "otur_sched.h"
+#include "vm_support.h"
+
+// Where a process was when the copy was taken
+enum snapshot_places { SNAP_CPU = 0, SNAP_ALSO, SNAP_HIGH, SNAP_NORMAL, SNAP_WAIT, SNAP_PENDING, SNAP_DEFUNCT,
+                       SNAP_PLACES };
+
+// Kept current on every change to the schedule (see snapshot_changed)
+typedef struct snapshot_summary {
+  unsigned long version;      // Changes to the schedule so far
+  int count[SNAP_PLACES];
+  pid_t on_cpu;               // 0 if none
+} Snapshot_summary_s;
+
+// One process in a copy (in order of place, then queue order)
+typedef struct snapshot_process {
+  int place;           // SNAP_*
+  Process_view_s view; // Its cmd and gang point into the copy's own strings
+} Snapshot_process_s;
+
+// One copy of the schedule
+typedef struct snapshot {
+  unsigned long version;
+  struct timespec taken;      // CLOCK_MONOTONIC
+  int refs;                   // Readers holding it, plus 1 while it's the latest
+  int count[SNAP_PLACES];
+  int total;
+  Snapshot_process_s *procs;
+  size_t procs_size;          // Room for this many
+  char *strings;
+  size_t strings_size;        // and this many bytes of commands and gang names
+} Snapshot_s;
+
+// Prototypes
+void snapshot_changed(Otur_schedule_s *schedule, Otur_process_s *on_cpu, int also_count);
+void snapshot_summary(Snapshot_summary_s *summary);
+int snapshot_stale();
+void snapshot_publish(Otur_schedule_s *schedule, Otur_process_s *on_cpu, Otur_process_s **also, int also_count);
+const Snapshot_s *snapshot_get();
+void snapshot_put(const Snapshot_s *snap);
+const char *snapshot_place_name(int place);
+void print_snapshot(const Snapshot_s *snap);
+void snapshot_free();
+
+#endif
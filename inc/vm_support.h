@@ -13,37 +13,53 @@
 #include "otur_sched.h"
 #include "vm.h"
 #include "vm_printing.h"
+#include "vm_log.h"
+
+// Size of the buffer needed by process_flags_string
+#define PROCESS_FLAGS_LEN 6
+
+// What is printed about a process, copied out of the schedule (see process_view)
+typedef struct process_view {
+  pid_t pid;
+  char flags[PROCESS_FLAGS_LEN]; // [H,U,R,D,C]
+  int age;
+  int exit_code;                 // -1 until it has terminated
+  uint32_t quantum;              // What the Scheduler has learned (see otur_learn)
+  unsigned short usage;
+  unsigned short path;
+  uint32_t predicted;
+  uint32_t fixed;                // Asked for at launch (see otur_override), 0 if not
+  int level;
+  uint64_t cpus;
+  const char *cmd;
+  const char *gang;              // NULL if it isn't in one
+} Process_view_s;
 
 // Adds the __FILE__ from current location before calling abort_error
 #define ABORT_ERROR(str) abort_error(str, __FILE__)
 
+// Logs str at the given level, skipping all formatting (and argument evaluation) if it's filtered out
+#define PRINT_AT(level, str, ...) do {                            \
+  if((level) >= LOG_MIN_LEVEL && (level) >= g_log_level) {        \
+    vm_log(level, str, ##__VA_ARGS__);                            \
+  }                                                               \
+} while(0)
+
 // Prints an Informational Message with printf-style formatting arguments
-#define PRINT_INFO(str, ...) do {               \
-  printf("  %s[Info ]%s ", GREEN, YELLOW);     \
-  printf(str, ##__VA_ARGS__);                   \
-  printf("%s\n", RST);                          \
-} while(0) 
+#define PRINT_INFO(str, ...) PRINT_AT(LOG_INFO, str, ##__VA_ARGS__)
 
 // If Debug is on, Prints a Debug Message with printf-style formatting arguments
-#define PRINT_DEBUG(str, ...) do {              \
-  printf(g_debug_mode?"  %s[DEBUG ]%s ":"", CYAN, YELLOW);      \
-  printf(g_debug_mode?str:"", ##__VA_ARGS__);                   \
-  printf(g_debug_mode?"%s\n":"", RST);                          \
-} while(0) 
+#define PRINT_DEBUG(str, ...) do {                                \
+  if(g_debug_mode) {                                              \
+    PRINT_AT(LOG_DEBUG, str, ##__VA_ARGS__);                      \
+  }                                                               \
+} while(0)
 
 // Prints a Status Message with printf-style formatting arguments
-#define PRINT_STATUS(str, ...) do {             \
-  printf("  %s[Status]%s ", YELLOW, YELLOW);    \
-  printf(str, ##__VA_ARGS__);                   \
-  printf("%s\n", RST);                          \
-} while(0) 
+#define PRINT_STATUS(str, ...) PRINT_AT(LOG_STATUS, str, ##__VA_ARGS__)
 
 // Prints a Warning Message with printf-style formatting arguments
-#define PRINT_WARNING(str, ...) do {            \
-  printf("  %s[Warn  ]%s ", MAGENTA, YELLOW);   \
-  printf(str, ##__VA_ARGS__);                   \
-  printf("%s\n", RST);                          \
-} while(0) 
+#define PRINT_WARNING(str, ...) PRINT_AT(LOG_WARN, str, ##__VA_ARGS__)
 
 // Prints a Message with Context, with printf-style formatting arguments
 #define MARK(str, ...) do {                    \
@@ -61,5 +77,12 @@ void print_otur_debug(Otur_schedule_s *schedule, Otur_process_s *on_cpu);
 void print_schedule(Otur_schedule_s *schedule, Otur_process_s *on_cpu);
 void print_otur_queue(Otur_queue_s *queue);
 void print_process_node(Otur_process_s *node);
+Process_view_s *process_view(Otur_process_s *node, Process_view_s *view);
+void print_process_view(const Process_view_s *view);
+char *process_flags_string(Otur_process_s *node, char *flags);
+int process_exit_code(Otur_process_s *node);
+char proc_run_state(pid_t pid);
+long long proc_cpu_usec(pid_t pid);
+int proc_set_sched(pid_t pid, int policy, int nice);
 
 #endif
@@ -0,0 +1,31 @@
+/* - vm_zygote.h (StrawHat VM)
+ *
+ *   Launch Zygote for StrawHat VM
+ *   A small helper forked at startup, before shvm has any threads, that keeps ZYGOTE_STUBS stub
+ *   processes forked ahead, each blocked on a socket until it's given a command to exec.  A launch hands
+ *   its command to an idle stub instead of forking shvm, and the zygote forks a new stub afterwards.
+ *   - Stubs are forked with CLONE_PARENT, so they're shvm's own children: SIGCHLD and exit codes work
+ *     exactly as for a process forked by create_process.
+ *   - create_process is in the Process System library, so its fork() is interposed at link time
+ *     (-Wl,--wrap=fork): zygote_create_process arms the next fork with the command, and __wrap_fork
+ *     answers it with a stub's pid.  Any other fork, or any problem with the zygote, forks as before.
+ *   - A captured launch's output fd is passed along (SCM_RIGHTS) for the stub to make its stdout and stderr.
+ *   - Command paths are resolved once, in the library's order (as given, then /usr/bin), and cached.
+ *   - The zygote and its idle stubs are reaped by zygote_reap, ahead of the Process System's SIGCHLD handler.
+ *   - Call under the shell's Launch Guard; none of this is thread safe on its own.
+ */
+#ifndef VM_ZYGOTE_H
+#define VM_ZYGOTE_H
+
+#include <sys/types.h>
+#include "vm_process.h"
+
+// Prototypes
+int zygote_start();
+void zygote_create_process(Process_data_s *proc, int out);
+void zygote_set_enabled(int enabled);
+int zygote_reap();
+void print_zygote();
+void zygote_stop();
+
+#endif
@@ -0,0 +1,160 @@
+/* Standard Library Includes */
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+/* Local Includes */
+#include "otur_intern.h"
+
+/* One interned string.  Entries with no references are chained on the free list through hnext. */
+typedef struct intern_entry {
+    char *str;
+    uint32_t hash;
+    uint32_t refs;
+    uint32_t hnext; /* next entry in the same bucket (or on the free list) */
+} Intern_entry_s;
+
+/* The Table */
+static Intern_entry_s *entries = NULL;
+static uint32_t capacity = 0;     /* entries allocated */
+static uint32_t used = 0;         /* entries ever handed out (high water mark) */
+static uint32_t live = 0;         /* entries holding a string now */
+static uint32_t free_head = OTUR_STR_NIL;
+static uint32_t *buckets = NULL;
+static uint32_t bucket_count = 0; /* power of two */
+
+/* Local Prototypes */
+static uint32_t intern_hash(const char *str);
+static int intern_grow();
+
+/* Finds (or adds) str in the table and takes a reference to it.
+ * Returns the handle, or OTUR_STR_NIL on any error.
+ */
+Otur_str otur_intern(const char *str) {
+    if (str == NULL) {
+        return OTUR_STR_NIL;
+    }
+    uint32_t hash = intern_hash(str);
+
+    /* the common case: it's already here, so no allocation or copy at all */
+    if (bucket_count != 0) {
+        for (uint32_t idx = buckets[hash & (bucket_count - 1)]; idx != OTUR_STR_NIL; idx = entries[idx].hnext) {
+            if (entries[idx].hash == hash && strcmp(entries[idx].str, str) == 0) {
+                entries[idx].refs++;
+                return idx;
+            }
+        }
+    }
+
+    if ((live + 1 > bucket_count || (free_head == OTUR_STR_NIL && used == capacity)) && intern_grow() == -1) {
+        return OTUR_STR_NIL;
+    }
+    char *copy = strdup(str);
+    if (copy == NULL) {
+        return OTUR_STR_NIL;
+    }
+
+    uint32_t idx = free_head;
+    if (idx != OTUR_STR_NIL) { /* reuse a released entry first */
+        free_head = entries[idx].hnext;
+    } else {
+        idx = used++;
+    }
+    entries[idx].str = copy;
+    entries[idx].hash = hash;
+    entries[idx].refs = 1;
+    entries[idx].hnext = buckets[hash & (bucket_count - 1)];
+    buckets[hash & (bucket_count - 1)] = idx;
+    live++;
+    return idx;
+}
+
+/* Drops a reference, freeing the string with the last one. */
+void otur_intern_release(Otur_str handle) {
+    if (handle == OTUR_STR_NIL || handle >= used || entries[handle].refs == 0) {
+        return;
+    }
+    if (--entries[handle].refs > 0) {
+        return;
+    }
+
+    /* unlink it from its bucket */
+    uint32_t *link = &buckets[entries[handle].hash & (bucket_count - 1)];
+    while (*link != handle) {
+        link = &entries[*link].hnext;
+    }
+    *link = entries[handle].hnext;
+
+    free(entries[handle].str);
+    entries[handle].str = NULL;
+    entries[handle].hnext = free_head;
+    free_head = handle;
+    live--;
+}
+
+/* Returns the string behind a handle ("" for OTUR_STR_NIL) */
+const char *otur_intern_str(Otur_str handle) {
+    if (handle == OTUR_STR_NIL || handle >= used || entries[handle].str == NULL) {
+        return "";
+    }
+    return entries[handle].str;
+}
+
+/* Returns the number of distinct strings in the table */
+uint32_t otur_intern_count() {
+    return live;
+}
+
+/* Frees the table itself, if nothing is interned any more. */
+void otur_intern_trim() {
+    if (live != 0) {
+        return;
+    }
+    free(entries);
+    free(buckets);
+    entries = NULL;
+    buckets = NULL;
+    capacity = used = bucket_count = 0;
+    free_head = OTUR_STR_NIL;
+}
+
+/* FNV-1a hash of a string */
+static uint32_t intern_hash(const char *str) {
+    uint32_t hash = 2166136261u;
+    for (; *str; str++) {
+        hash = (hash ^ (unsigned char)*str) * 16777619u;
+    }
+    return hash;
+}
+
+/* Doubles the entries and buckets, rehashing every live string.
+ * Returns 0 on success or -1 on any error.
+ */
+static int intern_grow() {
+    uint32_t new_capacity = capacity ? capacity * 2 : 64;
+    Intern_entry_s *new_entries = realloc(entries, sizeof(Intern_entry_s) * new_capacity);
+    if (new_entries == NULL) {
+        return -1;
+    }
+    entries = new_entries;
+    capacity = new_capacity;
+
+    uint32_t *new_buckets = malloc(sizeof(uint32_t) * new_capacity);
+    if (new_buckets == NULL) {
+        return -1;
+    }
+    for (uint32_t i = 0; i < new_capacity; i++) {
+        new_buckets[i] = OTUR_STR_NIL;
+    }
+    free(buckets);
+    buckets = new_buckets;
+    bucket_count = new_capacity;
+    for (uint32_t idx = 0; idx < used; idx++) {
+        if (entries[idx].str != NULL) {
+            uint32_t bucket = entries[idx].hash & (bucket_count - 1);
+            entries[idx].hnext = buckets[bucket];
+            buckets[bucket] = idx;
+        }
+    }
+    return 0;
+}
@@ -17,83 +17,258 @@
 
 /* Feel free to create any helper functions you like! */
 
-/*** Otur Library API Functions to Complete ***/
-
-/* Initializes the Otur_schedule_s Struct and all of the Otur_queue_s Structs
- * Follow the project documentation for this function.
- * Returns a pointer to the new Otur_schedule_s or NULL on any error.
- * - Hint: What does malloc return on an error?
- */
-Otur_schedule_s *otur_initialize() {
-    Otur_schedule_s *schedule = malloc(sizeof(Otur_schedule_s)); /* Initialize schedule */
-    Otur_process_s *temp = NULL;
-    if (schedule == NULL) { /* check if the initialization is fail then return null */
+/* Queue helpers: every list links Process Table slots by index (see otur_table.h) */
+
+/* helper function that adds a slot to the end of a queue */
+static void add_to_queue(Otur_queue_s *queue, uint32_t idx) {
+    OTUR_QUEUE(idx) = queue->id;
+    OTUR_NEXT(idx) = OTUR_NIL;
+    OTUR_PREV(idx) = queue->tail;
+    if (queue->tail == OTUR_NIL) {
+        queue->head = idx;
+    } else {
+        OTUR_NEXT(queue->tail) = idx;
+    }
+    queue->tail = idx;
+    queue->count++; /* increment the count after add */
+}
 
+/* helper function that unlinks a slot from the queue holding it (O(1) with the prev links) */
+static Otur_process_s *remove_from_queue(Otur_queue_s *queue, uint32_t idx) {
+    if (idx == OTUR_NIL || OTUR_QUEUE(idx) != queue->id) {
         return NULL;
     }
+    uint32_t prev = OTUR_PREV(idx);
+    uint32_t next = OTUR_NEXT(idx);
+    if (prev == OTUR_NIL) {
+        queue->head = next;
+    } else {
+        OTUR_NEXT(prev) = next;
+    }
+    if (next == OTUR_NIL) {
+        queue->tail = prev;
+    } else {
+        OTUR_PREV(next) = prev;
+    }
+    queue->count--;
+    OTUR_QUEUE(idx) = 0;
+    OTUR_NEXT(idx) = OTUR_NIL;
+    OTUR_PREV(idx) = OTUR_NIL;
+    return OTUR_NODE(idx);
+}
 
-
-    schedule->ready_queue_normal = malloc(sizeof(Otur_queue_s)); /* initialize normal queue */
-    if (schedule->ready_queue_normal == NULL) { /* check if the initialization is fail then return null */
-        free(schedule); /* free the schedule if it is fail*/
+/* helper function that sets up an empty queue */
+static Otur_queue_s *new_queue() {
+    Otur_queue_s *queue = malloc(sizeof(Otur_queue_s));
+    if (queue == NULL) {
         return NULL;
     }
+    queue->count = 0;
+    queue->head = OTUR_NIL;
+    queue->tail = OTUR_NIL;
+    queue->id = otur_table_queue_id();
+    return queue;
+}
 
+/* helper function that releases every node in a queue, then the queue itself */
+static void free_queue(Otur_queue_s *queue) {
+    while (queue->head != OTUR_NIL) {
+        Otur_process_s *node = remove_from_queue(queue, queue->head);
+        otur_intern_release(OTUR_GANG(node->idx));
+        otur_table_release(node->idx);
+        otur_intern_release(node->cmd);
+        free(node);
+    }
+    free(queue);
+}
 
-    schedule->ready_queue_high = malloc(sizeof(Otur_queue_s)); /*Initialize high queue */
-    if (schedule->ready_queue_high == NULL) {
-        temp = schedule->ready_queue_normal->head;
-        while (temp!= NULL){ /* if the initialization fail then free everything from normal queu as well as the schedule */
-            temp = schedule->ready_queue_normal->head;
-            schedule->ready_queue_normal->head = temp->next;
-            free(temp->cmd);
-            free(temp);
+/* helper function that moves every gang mate of a promoted slot from the normal queue to the high one,
+ * so a gang ages as one.  Returns how many of those moved were starving themselves. */
+static int promote_gang(Otur_schedule_s *schedule, uint32_t idx) {
+    Otur_str gang = OTUR_GANG(idx);
+    int starving = 0;
+    if (gang == OTUR_STR_NIL) {
+        return 0;
+    }
+    Otur_queue_s *normal = schedule->ready_queue_normal;
+    for (uint32_t mate = normal->head; mate != OTUR_NIL;) {
+        uint32_t next = OTUR_NEXT(mate);
+        if (OTUR_GANG(mate) == gang) {
+            starving += (OTUR_AGE(mate) >= STARVING_AGE);
+            remove_from_queue(normal, mate);
+            add_to_queue(schedule->ready_queue_high, mate);
         }
-        free(schedule->ready_queue_normal);
-        free(schedule);
-        return NULL;
+        mate = next;
     }
+    return starving;
+}
 
+/* helper function that returns the tenants with a ready process (bit i set for tenant i) */
+static uint64_t ready_tenants(Otur_schedule_s *schedule) {
+    uint64_t all = (otur_tenant_count() == 64) ? ~0ull : (1ull << otur_tenant_count()) - 1;
+    uint64_t ready = 0;
+    Otur_queue_s *queues[] = { schedule->ready_queue_high, schedule->ready_queue_normal };
+    for (int q = 0; q < 2; q++) {
+        for (uint32_t idx = queues[q]->head; idx != OTUR_NIL && ready != all; idx = OTUR_NEXT(idx)) {
+            ready |= 1ull << OTUR_TENANT(idx);
+        }
+    }
+    return ready;
+}
+
+/* helper function that returns the CPU time a slot is predicted to still need (usec), down to 0 as it
+ * reaches its prediction: a command never seen to finish is assumed to need SJF_UNKNOWN_USEC.  One past
+ * its prediction is re-predicted to need twice what it has run, and ranks behind every slot still within
+ * its own (those have at most UINT32_MAX left), so a bad guess never jumps it ahead of a good one */
+static uint64_t remaining(uint32_t idx) {
+    uint64_t predict = OTUR_PREDICT(idx) ? OTUR_PREDICT(idx) : SJF_UNKNOWN_USEC;
+    uint64_t ran = OTUR_RAN(idx);
+    if (ran <= predict) {
+        return predict - ran;
+    }
+    return ((uint64_t)UINT32_MAX + 1) + ran; /* ran * 2 - ran left */
+}
+
+/* helper function that returns the level a slot is picked by: its own (see otur_override), DEFAULT_PRIORITY
+ * less its learned boost (see otur_learn) without one, or 0 (ahead of every level) once it's starving */
+static int pick_level(uint32_t idx) {
+    if (OTUR_AGE(idx) >= STARVING_AGE) {
+        return 0;
+    }
+    return OTUR_LEVEL(idx) ? OTUR_LEVEL(idx) : DEFAULT_PRIORITY - OTUR_BOOST(idx);
+}
 
-    schedule->defunct_queue = malloc(sizeof(Otur_queue_s)); /*Initialize defunct queue */
-    if (schedule->defunct_queue == NULL) {
-        /*if the initialization fail then free everything from both normal and high queue */
-        temp = schedule->ready_queue_normal->head;
-        while (temp!= NULL){
-            temp = schedule->ready_queue_normal->head;
-            schedule->ready_queue_normal->head = temp->next;
-            free(temp->cmd);
-            free(temp);
+/* helper function that picks the process to run from a ready queue (of the given tenant, or any if -1):
+ * - passing over any with a footprint of defer_kb or more (if non-zero), counted in skipped
+ * - while any process has a priority level or a learned boost, the first of those with the lowest (see pick_level)
+ * - while there are dependencies, the first of those on the longest chain of waiting processes
+ * - then under OTUR_POLICY_SJF, the first starving one, or else the one with the least CPU time left
+ * - otherwise the head */
+static uint32_t pick_process(Otur_queue_s *queue, int tenant, int policy, uint32_t defer_kb, long *skipped) {
+    int by_level = (g_otur_table.leveled > 0 || g_otur_table.boosted > 0);
+    int by_path = (g_otur_table.edge_live > 0);
+    int by_time = (policy == OTUR_POLICY_SJF);
+    uint32_t best = OTUR_NIL;
+    uint64_t best_left = 0;
+    for (uint32_t idx = queue->head; idx != OTUR_NIL; idx = OTUR_NEXT(idx)) {
+        if (tenant != -1 && OTUR_TENANT(idx) != tenant) {
+            continue;
         }
-        free(schedule->ready_queue_normal);
-        temp = schedule->ready_queue_high->head;
-        while (temp!= NULL){
-            temp = schedule->ready_queue_high->head;
-            schedule->ready_queue_high->head = temp->next;
-            free(temp->cmd);
-            free(temp);
+        if (defer_kb && OTUR_RSS(idx) >= defer_kb) {
+            (*skipped)++;
+            continue;
+        }
+        if (best != OTUR_NIL && by_level && pick_level(idx) != pick_level(best)) {
+            if (pick_level(idx) < pick_level(best)) {
+                best = idx;
+                best_left = by_time ? remaining(idx) : 0;
+            }
+            continue;
+        }
+        if (best != OTUR_NIL && by_path && OTUR_PATH(idx) != OTUR_PATH(best)) {
+            if (OTUR_PATH(idx) > OTUR_PATH(best)) {
+                best = idx;
+                best_left = by_time ? remaining(idx) : 0;
+            }
+            continue;
+        }
+        if (best == OTUR_NIL) {
+            best = idx;
+            best_left = by_time ? remaining(idx) : 0;
+        } else if (by_time && OTUR_AGE(best) < STARVING_AGE) { /* aging: a starving one keeps its place */
+            uint64_t left = remaining(idx);
+            if (OTUR_AGE(idx) >= STARVING_AGE || left < best_left) {
+                best = idx;
+                best_left = left;
+            }
+        }
+        if (!by_level && !by_path && !by_time) {
+            break;
         }
-        free(schedule->ready_queue_high);
-        free(schedule);
-        return NULL;
     }
+    return best;
+}
 
-    /* set all of the head and tail as well as count of each queue to proper values */
-    schedule->ready_queue_normal->head = NULL;
-    schedule->ready_queue_normal->tail = NULL;
-    schedule->ready_queue_normal->count = 0;
+/* helper function that picks the smallest footprint in a ready queue (of the given tenant, or any if -1) */
+static uint32_t pick_smallest(Otur_queue_s *queue, int tenant) {
+    uint32_t best = OTUR_NIL;
+    for (uint32_t idx = queue->head; idx != OTUR_NIL; idx = OTUR_NEXT(idx)) {
+        if ((tenant == -1 || OTUR_TENANT(idx) == tenant) && (best == OTUR_NIL || OTUR_RSS(idx) < OTUR_RSS(best))) {
+            best = idx;
+        }
+    }
+    return best;
+}
 
+/* helper function that lengthens the chain behind a slot to path, and so on up through what it waits on */
+static void raise_path(uint32_t idx, uint32_t path) {
+    if (path > 0xFFFF || OTUR_PATH(idx) >= path) {
+        return;
+    }
+    OTUR_PATH(idx) = path;
+    for (uint32_t edge = OTUR_IN(idx); edge != OTUR_NIL; edge = OTUR_EDGE(edge).next_in) {
+        raise_path(OTUR_EDGE(edge).prereq, path + 1);
+    }
+}
 
-    schedule->ready_queue_high->head = NULL;
-    schedule->ready_queue_high->tail = NULL;
-    schedule->ready_queue_high->count = 0;
+/* helper function that settles everything waiting on a slot that just exited: with a success, the ones
+ * waiting on nothing else are released into the Ready Queues, otherwise they are all failed */
+static void settle_dependents(Otur_schedule_s *schedule, uint32_t idx, int success) {
+    success = success && OTUR_DEPS(idx) < OTUR_DEPS_CANCELLED; /* however a cancelled process ended */
+    for (uint32_t edge = OTUR_OUT(idx); edge != OTUR_NIL; edge = OTUR_EDGE(edge).next_out) {
+        uint32_t dependent = OTUR_EDGE(edge).dependent;
+        if (OTUR_DEPS(dependent) >= OTUR_DEPS_CANCELLED) {
+            continue; /* already failed */
+        }
+        if (!success) {
+            OTUR_DEPS(dependent) = OTUR_DEPS_FAILED;
+        } else if (--OTUR_DEPS(dependent) == 0 && OTUR_QUEUE(dependent) == schedule->pending_queue->id) {
+            otur_enqueue(schedule, remove_from_queue(schedule->pending_queue, dependent));
+        }
+    }
+    otur_table_unlink(idx);
+}
 
+/* helper function that marks a selected process as running */
+static Otur_process_s *run_process(Otur_process_s *process) {
+    OTUR_AGE(process->idx) = 0; /* set its age to 0 */
+    otur_transition(process, 0, OTUR_READY); /* it keeps its ready (R) flag while it has the CPU */
+    return process;
+}
 
-    schedule->defunct_queue->head = NULL;
-    schedule->defunct_queue->tail = NULL;
-    schedule->defunct_queue->count = 0;
+/*** Otur Library API Functions to Complete ***/
 
+/* Initializes the Otur_schedule_s Struct and all of the Otur_queue_s Structs
+ * Follow the project documentation for this function.
+ * Returns a pointer to the new Otur_schedule_s or NULL on any error.
+ * - Hint: What does malloc return on an error?
+ */
+Otur_schedule_s *otur_initialize() {
+    Otur_schedule_s *schedule = malloc(sizeof(Otur_schedule_s)); /* Initialize schedule */
+    if (schedule == NULL) { /* check if the initialization is fail then return null */
+        return NULL;
+    }
 
+    /* each queue gets its own id in the Process Table */
+    schedule->ready_queue_high = new_queue();
+    schedule->ready_queue_normal = new_queue();
+    schedule->defunct_queue = new_queue();
+    schedule->wait_queue = new_queue();
+    schedule->pending_queue = new_queue();
+    if (schedule->ready_queue_high == NULL || schedule->ready_queue_normal == NULL || schedule->defunct_queue == NULL ||
+        schedule->wait_queue == NULL || schedule->pending_queue == NULL) {
+        free(schedule->ready_queue_high); /* none of them hold any nodes yet */
+        free(schedule->ready_queue_normal);
+        free(schedule->defunct_queue);
+        free(schedule->wait_queue);
+        free(schedule->pending_queue);
+        free(schedule);
+        return NULL;
+    }
+    schedule->policy = DEFAULT_POLICY;
+    schedule->defer_kb = 0;
+    schedule->defer_hold = 0;
+    schedule->deferred = 0;
     return schedule;
 }
 
@@ -110,37 +285,28 @@ Otur_process_s *otur_invoke(pid_t pid, int is_high, int is_critical, char *comma
         return NULL;
     }
 
-
     process->pid = pid; /* set the pid of the process to the input pid */
-
-
-    process->state |= (1 << 13); /* set the state of the process to ready state by shifting it left 13 spot */
-
-
-    if (is_critical != 0) { /* check if critial is true then set it to 1 else set it to 0 */
-        process->state |= (1 << 11);
-    } else {
-        process->state &= ~(1 << 11);
-    }
-
-
-    if (is_high != 0 || is_critical != 0) { /* check if high or critical is true then set high bit to 1 else set it to 0 */
-        process->state |= (1 << 15);
-    } else {
-        process->state &= ~(1 << 15);
+    process->cmd = otur_intern(command); /* shares the command with every other process running it */
+    if (process->cmd == OTUR_STR_NIL) { /* if the allocation fail then free it and return null */
+        free(process);
+        return NULL;
     }
 
-
-    process->state = ((process->state >> 8) << 8); /* set all the lower 8 bits to 0 */
-    process->age = 0; /* set the age to 0 */
-    process->cmd = malloc(sizeof(char) * (strlen(command) + 1)); /* allocating memory for cmd */
-    if(process->cmd == NULL) { /* if the allocation fail then free it and return null */
+    process->idx = otur_table_alloc(process, pid); /* a slot in the Process Table, with age 0 */
+    if (process->idx == OTUR_NIL) {
+        otur_intern_release(process->cmd);
         free(process);
         return NULL;
     }
-    strncpy(process->cmd, command, strlen(command) + 1); /* copy the command to cmd using strncpy for security */
-    process->next = NULL;
 
+    uint32_t state = OTUR_READY; /* ready, with all the lower 8 bits (exit code) 0 */
+    if (is_critical != 0) { /* critical processes are always high too */
+        state |= OTUR_CRITICAL | OTUR_HIGH;
+    }
+    if (is_high != 0) {
+        state |= OTUR_HIGH;
+    }
+    __atomic_store_n(&OTUR_STATE(process->idx), state, __ATOMIC_RELEASE); /* built whole, then published */
 
     return process;
 }
@@ -151,31 +317,19 @@ Otur_process_s *otur_invoke(pid_t pid, int is_high, int is_critical, char *comma
  * - Do not create a new process to insert, insert the SAME process passed in.
  * Returns a 0 on success or a -1 on any error.
  */
-void add_to_queue(Otur_queue_s *queue, Otur_process_s *process) { /* helper function that add a process into a queue */
-    if (queue->head == NULL) {
-        queue->head = process;
-        queue->tail = process;
-    } else {
-        queue->tail->next = process;
-        queue->tail = process;
-    }
-    queue->count++; /* increment the count after add */
-}
-
-
 int otur_enqueue(Otur_schedule_s *schedule, Otur_process_s *process) {
     if (process == NULL || schedule == NULL) {
         return -1;
     }
-    process->state |= 0x7000; /* set all 3 state flags to be 1 */
-    process->state ^= 0x5000; /* use xor to make running and defunct to be 0 */
-
+    /* ready again: not running, defunct or blocked any more */
+    uint32_t state = otur_transition(process, OTUR_RUNNING | OTUR_DEFUNCT | OTUR_BLOCKED, OTUR_READY);
 
-    if (process->state & ((1 << 15) | (1 << 11))) { /*check if high or critical is 1 then insert in it to reaady high */
-        add_to_queue(schedule->ready_queue_high, process);
+    if (OTUR_DEPS(process->idx) != 0) { /* still waiting on another process to finish */
+        add_to_queue(schedule->pending_queue, process->idx);
+    } else if (state & (OTUR_HIGH | OTUR_CRITICAL)) { /*check if high or critical is 1 then insert in it to reaady high */
+        add_to_queue(schedule->ready_queue_high, process->idx);
     } else {
-        add_to_queue(schedule->ready_queue_normal, process); /* if not then insert in ready normal */
-
+        add_to_queue(schedule->ready_queue_normal, process->idx); /* if not then insert in ready normal */
     }
     return 0;
 }
@@ -192,79 +346,53 @@ int otur_count(Otur_queue_s *queue) {
     return queue->count; /* return the count of the input queue */
 }
 
-/* helper remove function that remove a process from input queue */
-Otur_process_s *remove_function(Otur_queue_s *queue, Otur_process_s *process) {
-    Otur_process_s *temp = queue->head;
-    Otur_process_s *temp2 = NULL;
-    if (temp == NULL) {
-        return NULL;
-    }
-    if (temp == process) {
-        queue->head = temp->next;
-        queue->count--;
-        temp->next = NULL;
-        return temp;
-    }
-    while (temp->next != NULL) {
-        if (temp->next == process) {
-            queue->count--;
-            temp2 = temp->next;
-            temp->next = temp->next->next;
-            temp2->next = NULL;
-            return temp2;
-        }
-        temp = temp->next;
-    }
-    return NULL;
-}
-
 
 /* Selects the best process to run from the Ready Queue (singly linked list).
  * Follow the project documentation for this function.
  * Returns a pointer to the process selected or NULL if none available or on any errors.
  * - Do not create a new process to return, return a pointer to the SAME process selected.
+ * - While schedule->defer_kb is set, processes that large wait for anything smaller that is ready.
  */
 Otur_process_s *otur_select(Otur_schedule_s *schedule) {
-    Otur_process_s *temp = NULL;
-    Otur_process_s *temp2 = NULL;
-
-
     if (schedule == NULL) {
         return NULL;
     }
 
+    Otur_queue_s *high = schedule->ready_queue_high;
+    Otur_queue_s *normal = schedule->ready_queue_normal;
+    for (uint32_t idx = high->head; idx != OTUR_NIL; idx = OTUR_NEXT(idx)) { /* critical processes go first */
+        if (__atomic_load_n(&OTUR_STATE(idx), __ATOMIC_ACQUIRE) & OTUR_CRITICAL) {
+            return run_process(remove_from_queue(high, idx));
+        }
+    }
 
-    if (schedule->ready_queue_high != NULL) {
-        temp = schedule->ready_queue_high->head; /* set the temp to the head of queue high */
+    /* with tenants, the most under-served one with a ready process goes next, by the same rules */
+    int tenant = (otur_tenant_count() > 1) ? otur_tenant_pick(ready_tenants(schedule)) : -1;
 
-        while (temp != NULL) { /* loop through the queue */
-            if (temp->state & (1 << 13)) { /* check if there are critical processes */
-                temp2 = remove_function(schedule->ready_queue_high, temp); /* remove it from the queue */
-                temp2->age = 0; /* set its age to 0 */
-                temp2->state |= 0x2000; /* set the running state to 1 */
-                temp2->next = NULL; /* set the pointer to next node to be null */
-                return temp2; /* return the node */
-            }
-            temp = temp->next;
-        }
-        if (schedule->ready_queue_high->head != NULL) { /* do the same as the above but only remove the head */
-            temp2 = remove_function(schedule->ready_queue_high, schedule->ready_queue_high->head);
-            if (temp2 != NULL) {
-                temp2->age = 0;
-                temp2->state |= 0x2000;
-                temp2->next = NULL;
-                return temp2;
-            }
+    long skipped = 0;
+    uint32_t idx = pick_process(high, tenant, schedule->policy, schedule->defer_kb, &skipped); /* then the high queue */
+    if (idx != OTUR_NIL) {
+        schedule->deferred += (skipped > 0);
+        return run_process(remove_from_queue(high, idx));
+    }
+    idx = pick_process(normal, tenant, schedule->policy, schedule->defer_kb, &skipped); /* and only then the normal queue */
+    if (idx != OTUR_NIL) {
+        schedule->deferred += (skipped > 0);
+        return run_process(remove_from_queue(normal, idx));
+    }
+    if (skipped > 0 && !schedule->defer_hold) { /* only large ones are ready: the smallest of them, high first */
+        idx = pick_smallest(high, tenant);
+        if (idx != OTUR_NIL) {
+            return run_process(remove_from_queue(high, idx));
         }
-    } else if (schedule->ready_queue_normal != NULL) { /* if there are none then do the same in normal queue */
-        temp2 = remove_function(schedule->ready_queue_normal, schedule->ready_queue_normal->head);
-        if (temp2 != NULL) {
-            temp2->age = 0;
-            temp2->state |= 0x2000;
-            temp2->next = NULL;
-            return temp2;
+        idx = pick_smallest(normal, tenant);
+        if (idx != OTUR_NIL) {
+            return run_process(remove_from_queue(normal, idx));
         }
     }
+    if (skipped > 0) {
+        schedule->deferred++;
+    }
     return NULL; /* return null if both are empty */
 }
 
@@ -274,26 +402,37 @@ Otur_process_s *otur_select(Otur_schedule_s *schedule) {
  * Follow the project documentation for this function.
  * Returns a 0 on success or a -1 on any error.
  */
-
-
 int otur_promote(Otur_schedule_s *schedule) {
     if (schedule == NULL || schedule->ready_queue_normal == NULL || schedule->ready_queue_high == NULL) {
         return -1;
     }
-    Otur_process_s *temp = schedule->ready_queue_normal->head; /* set the temp to the head of normal queue */
-    Otur_process_s *temp2 = NULL;
-    if (temp == NULL) {
+    Otur_queue_s *normal = schedule->ready_queue_normal;
+    if (normal->count == 0) {
         return 0;
     }
-    while (temp != NULL) {
-        temp->age++; /* increase the age by 1 */
-        Otur_process_s *next = temp->next; /* create a pointer that keep track of the node ahead */
-        if (temp->age >= STARVING_AGE) { /* check if the current node is greater or equal to starving age*/
-            temp2 = remove_function(schedule->ready_queue_normal, temp); /* remove the current node from the queue */
-            temp2->next = NULL;
-            add_to_queue(schedule->ready_queue_high, temp2); /* add it to queue high */
+
+    /* one vectorized pass over the table ages the whole queue and counts the starving */
+    int starving = otur_table_age(normal->id, STARVING_AGE);
+
+    /* ages only grow while waiting and new nodes join at the tail (age 0), so the starving
+     * ones are always at the front: move them over in order */
+    while (starving > 0 && normal->head != OTUR_NIL && OTUR_AGE(normal->head) >= STARVING_AGE) {
+        uint32_t idx = normal->head;
+        remove_from_queue(normal, idx);
+        add_to_queue(schedule->ready_queue_high, idx); /* add it to queue high */
+        starving -= 1 + promote_gang(schedule, idx); /* its gang goes up with it */
+    }
+    /* only an age set from outside (otur_set_age, eg. a recovered process) can break that order, so
+     * anything still starving past the prefix is one of those: sweep the rest for it */
+    for (uint32_t idx = normal->head; starving > 0 && idx != OTUR_NIL;) {
+        uint32_t next = OTUR_NEXT(idx);
+        if (OTUR_AGE(idx) >= STARVING_AGE) {
+            remove_from_queue(normal, idx);
+            add_to_queue(schedule->ready_queue_high, idx);
+            starving -= 1 + promote_gang(schedule, idx);
+            next = normal->head; /* its gang may have taken next with it: start over */
         }
-        temp = next; /* set it to the pointer ahead of it to continue the search */
+        idx = next;
     }
     return 0;
 }
@@ -308,19 +447,12 @@ int otur_exited(Otur_schedule_s *schedule, Otur_process_s *process, int exit_cod
     if (schedule == NULL || process == NULL) {
         return -1;
     }
-    process->state |= (1 << 12); /* set the defunct to 1 */
-    process->state &= ~0xFF;/* set the lower 8 bits to 0 */
+    /* defunct, with the exit code in the lower 8 bits, in one step */
+    otur_transition(process, OTUR_EXIT_MASK | OTUR_BLOCKED, OTUR_DEFUNCT | (exit_code & OTUR_EXIT_MASK));
+    OTUR_DIED(process->idx) = otur_table_now(); /* when it went defunct */
 
-    process->state |= (exit_code & 0xFF); /* Set the state bits used for exit_code to the value of the exit_code passed in.*/
-
-    if (schedule->defunct_queue->head == NULL) { /* insert it at the end of defunct queue */
-        schedule->defunct_queue->head = process;
-        schedule->defunct_queue->tail = process;
-    } else {
-        schedule->defunct_queue->tail->next = process;
-        schedule->defunct_queue->tail = process;
-    }
-    schedule->defunct_queue->count++;
+    add_to_queue(schedule->defunct_queue, process->idx); /* insert it at the end of defunct queue */
+    settle_dependents(schedule, process->idx, exit_code == 0); /* a success releases what waits on it */
     return 0;
 }
 
@@ -332,49 +464,283 @@ int otur_exited(Otur_schedule_s *schedule, Otur_process_s *process, int exit_cod
  * Follow the project documentation for this function.
  * Returns a 0 on success or a -1 on any error (eg. process not found).
  */
-Otur_process_s *remove_from_queue(Otur_queue_s *queue, pid_t pid) { /* helper remove function that take input of queue and pid number */
-    Otur_process_s *temp = queue->head;
-    Otur_process_s *prev = NULL;
-
-    while (temp != NULL) {
-        if (temp->pid == pid) {
-            if (prev == NULL) {
-                queue->head = temp->next;
-            } else {
-                prev->next = temp->next;
+int otur_killed(Otur_schedule_s *schedule, pid_t pid, int exit_code) {
+    if (schedule == NULL) {
+        return -1;
+    }
+
+    /* the pid hash finds the slot directly; the queue id says which list it's on */
+    Otur_process_s *process = remove_from_queue(schedule->ready_queue_high,
+                                                 otur_table_find(pid, schedule->ready_queue_high->id));
+    if (process == NULL) { /* if there is none then remove it from the normal queue instead */
+        process = remove_from_queue(schedule->ready_queue_normal,
+                                    otur_table_find(pid, schedule->ready_queue_normal->id));
+    }
+    if (process == NULL) { /* or it may have been blocked */
+        process = remove_from_queue(schedule->wait_queue, otur_table_find(pid, schedule->wait_queue->id));
+    }
+    if (process == NULL) { /* or still waiting on another process */
+        process = remove_from_queue(schedule->pending_queue, otur_table_find(pid, schedule->pending_queue->id));
+    }
+
+    if (process == NULL) { /* if there is none in both then return -1 */
+        return -1;
+    }
+
+    if (OTUR_DEPS(process->idx) >= OTUR_DEPS_CANCELLED) { /* it never ran: a process it ran after failed */
+        exit_code = OTUR_EXIT_CANCELLED;
+    }
+    /* only defunct (not running, ready or blocked), with the exit code in the lower 8 bits, in one step */
+    otur_transition(process, OTUR_RUNNING | OTUR_READY | OTUR_BLOCKED | OTUR_EXIT_MASK,
+                    OTUR_DEFUNCT | (exit_code & OTUR_EXIT_MASK));
+    OTUR_DIED(process->idx) = otur_table_now(); /* when it went defunct */
+
+    add_to_queue(schedule->defunct_queue, process->idx); /* add it in to the defunct queue */
+    settle_dependents(schedule, process->idx, exit_code == 0);
+
+    return 0;
+}
+
+/* This is called when a process that was just Running turned out to be blocked (sleeping or waiting on I/O).
+ * Put the given node into the Wait Queue, where otur_select won't see it, until otur_unblock.
+ * - It's flagged blocked; its other flags and age are left alone, so it goes back to the same Ready Queue later.
+ * Returns a 0 on success or a -1 on any error.
+ */
+int otur_block(Otur_schedule_s *schedule, Otur_process_s *process) {
+    if (schedule == NULL || process == NULL) {
+        return -1;
+    }
+    otur_transition(process, 0, OTUR_BLOCKED);
+    add_to_queue(schedule->wait_queue, process->idx);
+    return 0;
+}
+
+/* This is called when a blocked process can run again.
+ * Move the process with matching pid from the Wait Queue back into its Ready Queue.
+ * Returns a 0 on success or a -1 on any error (eg. process not waiting).
+ */
+int otur_unblock(Otur_schedule_s *schedule, pid_t pid) {
+    if (schedule == NULL) {
+        return -1;
+    }
+    Otur_process_s *process = remove_from_queue(schedule->wait_queue, otur_table_find(pid, schedule->wait_queue->id));
+    if (process == NULL) {
+        return -1;
+    }
+    return otur_enqueue(schedule, process);
+}
+
+/* Puts a process into the named gang (replacing any gang it was in).
+ * - Gang members are selected together (see otur_select_gang) and promoted together (see otur_promote),
+ *   so a pipeline or a client and its server get the CPU at the same time.
+ * Returns a 0 on success or a -1 on any error.
+ */
+int otur_join(Otur_process_s *process, const char *gang) {
+    if (process == NULL || gang == NULL || gang[0] == '\0') {
+        return -1;
+    }
+    Otur_str id = otur_intern(gang); /* one name per gang, shared like the commands */
+    if (id == OTUR_STR_NIL) {
+        return -1;
+    }
+    otur_intern_release(OTUR_GANG(process->idx));
+    OTUR_GANG(process->idx) = id;
+    otur_transition(process, 0, OTUR_GROUP);
+    return 0;
+}
+
+/* This is called right after otur_select picked leader, to run its whole gang with it.
+ * Removes up to max other ready members of the leader's gang (High Queue first, then Normal)
+ * and marks them running, as otur_select does.  Blocked members are left in the Wait Queue.
+ * Returns the number of members put into members (0 if the leader is in no gang) or -1 on any error.
+ */
+int otur_select_gang(Otur_schedule_s *schedule, Otur_process_s *leader, Otur_process_s **members, int max) {
+    if (schedule == NULL || leader == NULL || (members == NULL && max > 0)) {
+        return -1;
+    }
+    Otur_str gang = OTUR_GANG(leader->idx);
+    if (gang == OTUR_STR_NIL) {
+        return 0;
+    }
+
+    Otur_queue_s *queues[] = { schedule->ready_queue_high, schedule->ready_queue_normal };
+    int count = 0;
+    for (int q = 0; q < 2; q++) {
+        for (uint32_t idx = queues[q]->head; idx != OTUR_NIL && count < max;) {
+            uint32_t next = OTUR_NEXT(idx);
+            if (OTUR_GANG(idx) == gang) {
+                members[count++] = run_process(remove_from_queue(queues[q], idx));
             }
-            queue->count--;
-            temp->next = NULL;
-            return temp;
+            idx = next;
         }
-        prev = temp;
-        temp = temp->next;
     }
-    return NULL;
+    return count;
 }
 
-int otur_killed(Otur_schedule_s *schedule, pid_t pid, int exit_code) {
-    if (schedule == NULL) {
+/* Makes a new process (not enqueued yet) wait for the process with pid prereq to exit successfully.
+ * - otur_enqueue keeps it in the Pending Queue until every prerequisite has, then it goes to its
+ *   Ready Queue.  Processes with a long chain waiting on them are selected first (see otur_select).
+ * - If prereq has already failed, or there is no such process, the new process is failed instead:
+ *   otur_cancel will hand it out.
+ * Returns 1 if it now waits on prereq, 0 if prereq has already exited successfully, or -1 if the new
+ *   process was failed or on any error.
+ */
+int otur_depend(Otur_schedule_s *schedule, Otur_process_s *process, pid_t prereq) {
+    if (schedule == NULL || process == NULL) {
         return -1;
     }
+    uint32_t idx = otur_table_find(prereq, schedule->defunct_queue->id);
+    if (idx != OTUR_NIL && (__atomic_load_n(&OTUR_STATE(idx), __ATOMIC_ACQUIRE) & OTUR_EXIT_MASK) == 0) {
+        return 0;
+    }
 
-    Otur_process_s *process = remove_from_queue(schedule->ready_queue_high, pid); /* try to remove a process with specific pid from queue high */
-    if (process == NULL) { /* if there is none then remove it from the normal queue instead */
-        process = remove_from_queue(schedule->ready_queue_normal, pid);
+    /* ready, blocked, waiting itself, or else on the CPU (in no queue) */
+    uint32_t ids[] = { schedule->ready_queue_high->id, schedule->ready_queue_normal->id, schedule->wait_queue->id,
+                       schedule->pending_queue->id, 0 };
+    for (int i = 0; idx == OTUR_NIL && i < 5; i++) {
+        idx = otur_table_find(prereq, ids[i]);
+        idx = (idx == process->idx) ? OTUR_NIL : idx;
+    }
+    if (idx == OTUR_NIL || OTUR_QUEUE(idx) == schedule->defunct_queue->id || OTUR_DEPS(idx) >= OTUR_DEPS_CANCELLED ||
+        OTUR_DEPS(process->idx) >= OTUR_DEPS_CANCELLED - 1 || otur_table_link(idx, process->idx) == OTUR_NIL) {
+        otur_table_unlink(process->idx);
+        OTUR_DEPS(process->idx) = OTUR_DEPS_FAILED;
+        return -1;
+    }
+    OTUR_DEPS(process->idx)++;
+    raise_path(idx, OTUR_PATH(process->idx) + 1);
+    return 1;
+}
+
+/* Hands out (up to max of) the Pending processes whose prerequisites failed, so they can be killed.
+ * - They stay in the Pending Queue, and are never handed out again, until otur_killed.
+ * Returns the number of processes put into cancelled, or -1 on any error.
+ */
+int otur_cancel(Otur_schedule_s *schedule, Otur_process_s **cancelled, int max) {
+    if (schedule == NULL || (cancelled == NULL && max > 0)) {
+        return -1;
     }
+    int count = 0;
+    for (uint32_t idx = schedule->pending_queue->head; idx != OTUR_NIL && count < max; idx = OTUR_NEXT(idx)) {
+        if (OTUR_DEPS(idx) == OTUR_DEPS_FAILED) {
+            OTUR_DEPS(idx) = OTUR_DEPS_CANCELLED;
+            cancelled[count++] = OTUR_NODE(idx);
+        }
+    }
+    return count;
+}
 
-    if (process == NULL) { /* if there is none in both then return -1 */
+/* Moves a process to a tenant (see otur_tenant), whose share it is selected by from then on.
+ * Returns a 0 on success or a -1 on any error (eg. no such tenant).
+ */
+int otur_assign(Otur_process_s *process, int tenant) {
+    if (process == NULL || otur_tenant_info(tenant) == NULL) {
+        return -1;
+    }
+    OTUR_TENANT(process->idx) = tenant;
+    return 0;
+}
+
+/* This is called with the CPU time a process used, to charge it to the process' tenant and count it
+ * against what it's predicted to need.
+ * Returns a 0 on success or a -1 on any error.
+ */
+int otur_charge(Otur_process_s *process, uint32_t used_usec) {
+    if (process == NULL) {
+        return -1;
+    }
+    otur_tenant_charge(OTUR_TENANT(process->idx), used_usec);
+    uint32_t ran = OTUR_RAN(process->idx);
+    OTUR_RAN(process->idx) = (ran + used_usec < ran) ? UINT32_MAX : ran + used_usec; /* saturates */
+    return 0;
+}
+
+/* Sets how much CPU time a process is predicted to need for its whole run (usec), eg. from earlier
+ * runs of the same command.  0 means unknown.  Used by OTUR_POLICY_SJF.
+ * Returns a 0 on success or a -1 on any error.
+ */
+int otur_predict(Otur_process_s *process, uint64_t usec) {
+    if (process == NULL) {
+        return -1;
+    }
+    OTUR_PREDICT(process->idx) = usec > UINT32_MAX ? UINT32_MAX : (uint32_t)usec;
+    return 0;
+}
+
+/* Sets how much memory a process was last seen holding (KB), eg. its resident set.  0 means unknown.
+ * Used while schedule->defer_kb is set (see otur_select).
+ * Returns a 0 on success or a -1 on any error.
+ */
+int otur_footprint(Otur_process_s *process, uint64_t kb) {
+    if (process == NULL) {
         return -1;
     }
+    OTUR_RSS(process->idx) = kb > UINT32_MAX ? UINT32_MAX : (uint32_t)kb;
+    return 0;
+}
 
-    process->state |= 0x7000; /* set all 3 flags to 1 */
-    process->state ^= 0x6000; /* use xor to set defunct to 1 */
+/* Sets what a process asked for at launch, for every dispatch of it to honour:
+ * - quantum_usec: how long each of its slices is, whatever otur_learn makes of it.  0 for none.
+ * - level: its priority level, MIN_PRIORITY (most urgent) to MAX_PRIORITY (least).  0 for none, which
+ *   ranks as DEFAULT_PRIORITY.  otur_select picks the lowest level in a Ready Queue first.
+ * Returns a 0 on success or a -1 on any error (eg. a level out of range).
+ */
+int otur_override(Otur_process_s *process, uint32_t quantum_usec, int level) {
+    if (process == NULL || (level != 0 && (level < MIN_PRIORITY || level > MAX_PRIORITY))) {
+        return -1;
+    }
+    g_otur_table.leveled += (level != 0) - (OTUR_LEVEL(process->idx) != 0);
+    OTUR_FIXED(process->idx) = quantum_usec;
+    OTUR_LEVEL(process->idx) = (uint8_t)level;
+    return 0;
+}
 
-    process->state &= ~0xFF; /* set the lower 8 bits to 0 */
-    process->state |= (exit_code & 0xFF); /*Set the state bits used for exit_code to the value of the exit_code passed in*/
+/* Sets the CPUs a process may run on, one bit per CPU (CPU 0 is bit 0), and flags it pinned.
+ * - 0 lets it run on any of them again.
+ * Returns a 0 on success or a -1 on any error.
+ */
+int otur_pin(Otur_process_s *process, uint64_t cpus) {
+    if (process == NULL) {
+        return -1;
+    }
+    OTUR_CPUS(process->idx) = cpus;
+    if (cpus != 0) {
+        otur_transition(process, 0, OTUR_PINNED);
+    } else {
+        otur_transition(process, OTUR_PINNED, 0);
+    }
+    return 0;
+}
 
-    add_to_queue(schedule->defunct_queue, process); /* add it in to the defunct queue */
+/* This is called after a process has had its slice, with how much CPU it actually used in it.
+ * Updates its running averages (1/4 weight to the newest slice) and from them:
+ * - its quantum: half again its average burst, kept within min_quantum..max_quantum, so
+ *   CPU hogs switch less often and short bursts give the CPU back sooner.
+ * - its boost: the less of its slices it uses, the more levels (up to LEARN_BOOST_LEVELS) ahead of
+ *   DEFAULT_PRIORITY it is picked at in its Ready Queue, so interactive processes run sooner.  Its
+ *   age is left alone, so a starving process is still picked (and promoted) before any of them.
+ * Returns a 0 on success or a -1 on any error.
+ */
+int otur_learn(Otur_process_s *process, uint32_t used_usec, uint32_t slice_usec, uint32_t min_quantum, uint32_t max_quantum) {
+    if (process == NULL || slice_usec == 0) {
+        return -1;
+    }
+    uint32_t idx = process->idx;
+    uint32_t usage = used_usec >= slice_usec ? 1000 : (uint32_t)((uint64_t)used_usec * 1000 / slice_usec);
 
+    if (OTUR_USAGE(idx) == OTUR_USAGE_UNKNOWN) { /* first slice: nothing to average with yet */
+        OTUR_BURST(idx) = used_usec;
+        OTUR_USAGE(idx) = usage;
+    } else {
+        OTUR_BURST(idx) = (int64_t)OTUR_BURST(idx) + ((int64_t)used_usec - (int64_t)OTUR_BURST(idx)) / 4;
+        OTUR_USAGE(idx) = (int32_t)OTUR_USAGE(idx) + ((int32_t)usage - (int32_t)OTUR_USAGE(idx)) / 4;
+    }
+
+    uint64_t quantum = (uint64_t)OTUR_BURST(idx) * 3 / 2;
+    OTUR_QUANTUM(idx) = quantum < min_quantum ? min_quantum : (quantum > max_quantum ? max_quantum : quantum);
+    uint32_t boost = (1000 - OTUR_USAGE(idx)) * LEARN_BOOST_LEVELS / 1000;
+    g_otur_table.boosted += (boost != 0) - (OTUR_BOOST(idx) != 0);
+    OTUR_BOOST(idx) = boost;
     return 0;
 }
 
@@ -383,36 +749,24 @@ int otur_killed(Otur_schedule_s *schedule, pid_t pid, int exit_code) {
  * Follow the project documentation for this function.
  * Returns the process' exit code on success or a -1 if no such process or on any error.
  */
-
 int otur_reap(Otur_schedule_s *schedule, pid_t pid) {
     if (schedule == NULL) {
         return -1;
     }
 
-    Otur_process_s *temp = schedule->defunct_queue->head; /* set the temp to head of defunct queue */
-    unsigned short exit_code;
-
-    if (pid == 0) { /* check if the pid parameter is 0 then remove the head */
-        if (temp == NULL) {
-            return -1;
-        }
-        schedule->defunct_queue->head = temp->next;
-        temp->next = NULL;
-        exit_code = ((temp->state) &=(0x00FF));
-        schedule->defunct_queue->count--;
-        free(temp -> cmd);
-        free(temp);
-        return exit_code;
-    }else{
-        Otur_process_s  *node = remove_from_queue(schedule->defunct_queue, pid); /* if not then remove the node with the pid */
-        if (node == NULL) {
-            return -1;
-        }
-        exit_code = ((node->state) &=(0x00FF)); /* get the exit code */
-        free(node -> cmd); /* free the node cmd */
-        free(node); /* free the node */
-        return exit_code; /* return the exit code */
+    Otur_queue_s *defunct = schedule->defunct_queue;
+    uint32_t idx = (pid == 0) ? defunct->head : otur_table_find(pid, defunct->id); /* pid 0 reaps the head */
+    Otur_process_s *node = remove_from_queue(defunct, idx);
+    if (node == NULL) {
+        return -1;
     }
+
+    int exit_code = otur_state(node) & OTUR_EXIT_MASK; /* get the exit code */
+    otur_intern_release(OTUR_GANG(idx)); /* and its gang's name */
+    otur_table_release(idx);
+    otur_intern_release(node->cmd); /* drop its reference to the command */
+    free(node); /* free the node */
+    return exit_code; /* return the exit code */
 }
 
 
@@ -422,38 +776,13 @@ int otur_reap(Otur_schedule_s *schedule, pid_t pid) {
  * Returns void.
  */
 void otur_cleanup(Otur_schedule_s *schedule) {
-    Otur_process_s *temp = NULL;
-    Otur_process_s *temp2 = NULL;
-
-    /*Free the nodes in the ready_queue_high*/
-    temp = schedule->ready_queue_high->head;
-    while (temp != NULL) {
-        temp2 = temp;
-        temp = temp->next;
-        free(temp2->cmd);
-        free(temp2);
-    }
-    free(schedule->ready_queue_high);
-
-    /* Free the nodes in the ready_queue_normal */
-    temp = schedule->ready_queue_normal->head;
-    while (temp != NULL) {
-        temp2 = temp;
-        temp = temp->next;
-        free(temp2->cmd);
-        free(temp2);
-    }
-    free(schedule->ready_queue_normal);
-
-    /* Free the nodes in the defunct_queue */
-    temp = schedule->defunct_queue->head;
-    while (temp != NULL) {
-        temp2 = temp;
-        temp = temp->next;
-        free(temp2->cmd);
-        free(temp2);
-    }
-    free(schedule->defunct_queue);
+    free_queue(schedule->ready_queue_high);
+    free_queue(schedule->ready_queue_normal);
+    free_queue(schedule->defunct_queue);
+    free_queue(schedule->wait_queue);
+    free_queue(schedule->pending_queue);
+    otur_tenant_reset(); /* tenants belong to the schedule too */
+    otur_intern_trim(); /* the intern table goes too, once no schedule holds any commands */
 
     /* Finally, free the schedule itself */
     free(schedule);
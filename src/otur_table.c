@@ -0,0 +1,356 @@
+/* Standard Library Includes */
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <time.h>
+/* Unix System Includes */
+#include <sys/types.h>
+/* Vector Extensions */
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define OTUR_X86 1
+#else
+#define OTUR_X86 0
+#endif
+/* Local Includes */
+#include "otur_table.h"
+#include "otur_intern.h"
+
+/* The one Process Table shared by every schedule */
+Otur_table_s g_otur_table = { .free_head = OTUR_NIL, .edge_free = OTUR_NIL };
+
+/* Which aging pass this CPU gets (see otur_table_simd) */
+enum simd_levels { SIMD_UNKNOWN = -1, SIMD_SCALAR = 0, SIMD_SSE2, SIMD_AVX2 };
+static int simd_level = SIMD_UNKNOWN;
+
+/* Local Prototypes */
+static uint32_t hash_bucket(pid_t pid);
+static int grow_buckets();
+static void drop_edge(uint32_t *head, uint32_t edge, int in_list);
+static int age_scalar(int32_t *age, const uint32_t *queue, uint32_t count, uint32_t queue_id, int starving_age);
+#if OTUR_X86
+static int age_sse2(int32_t *age, const uint32_t *queue, uint32_t count, uint32_t queue_id, int starving_age);
+static int age_avx2(int32_t *age, const uint32_t *queue, uint32_t count, uint32_t queue_id, int starving_age);
+#endif
+
+/* Hands out a slot for a new process and indexes it by pid.
+ * - The slot starts out in no queue, with a state and age of 0.
+ * Returns the slot index, or OTUR_NIL on any error.
+ */
+uint32_t otur_table_alloc(struct process_node *node, pid_t pid) {
+    Otur_table_s *table = &g_otur_table;
+    uint32_t idx = table->free_head;
+
+    if ((table->live + 1) * 2 > table->bucket_count && grow_buckets() == -1) {
+        return OTUR_NIL;
+    }
+
+    if (idx != OTUR_NIL) { /* reuse a released slot first */
+        table->free_head = OTUR_NEXT(idx);
+    } else {
+        idx = table->used;
+        if ((idx >> OTUR_CHUNK_BITS) >= OTUR_MAX_CHUNKS) {
+            return OTUR_NIL;
+        }
+        if (OTUR_SLOT(idx) == 0) { /* first slot of a new chunk */
+            Otur_chunk_s *chunk = NULL;
+            if (posix_memalign((void **)&chunk, 32, sizeof(Otur_chunk_s)) != 0) {
+                return OTUR_NIL;
+            }
+            memset(chunk->queue, 0, sizeof(chunk->queue)); /* slots past used must never match a queue */
+            table->chunks[idx >> OTUR_CHUNK_BITS] = chunk;
+        }
+        table->used++;
+    }
+
+    OTUR_AGE(idx) = 0;
+    OTUR_QUEUE(idx) = 0;
+    OTUR_NEXT(idx) = OTUR_NIL;
+    OTUR_PREV(idx) = OTUR_NIL;
+    OTUR_PID(idx) = pid;
+    __atomic_store_n(&OTUR_STATE(idx), 0, __ATOMIC_RELEASE);
+    OTUR_NODE(idx) = node;
+    OTUR_BORN(idx) = otur_table_now();
+    OTUR_DIED(idx) = 0;
+    OTUR_QUANTUM(idx) = 0;
+    OTUR_BURST(idx) = 0;
+    OTUR_USAGE(idx) = OTUR_USAGE_UNKNOWN;
+    OTUR_GANG(idx) = OTUR_STR_NIL;
+    OTUR_TENANT(idx) = 0;
+    OTUR_DEPS(idx) = 0;
+    OTUR_PATH(idx) = 0;
+    OTUR_OUT(idx) = OTUR_NIL;
+    OTUR_IN(idx) = OTUR_NIL;
+    OTUR_PREDICT(idx) = 0;
+    OTUR_RAN(idx) = 0;
+    OTUR_RSS(idx) = 0;
+    OTUR_FIXED(idx) = 0;
+    OTUR_LEVEL(idx) = 0;
+    OTUR_BOOST(idx) = 0;
+    OTUR_CPUS(idx) = 0;
+
+    uint32_t bucket = hash_bucket(pid);
+    OTUR_CHUNK(idx)->hnext[OTUR_SLOT(idx)] = table->buckets[bucket];
+    table->buckets[bucket] = idx;
+    table->live++;
+    return idx;
+}
+
+/* Returns a slot to the free list.  It must not be in any queue. */
+void otur_table_release(uint32_t idx) {
+    Otur_table_s *table = &g_otur_table;
+    if (idx == OTUR_NIL) {
+        return;
+    }
+    otur_table_unlink(idx); /* normally done when it exited */
+
+    /* unlink it from its hash chain */
+    uint32_t *link = &table->buckets[hash_bucket(OTUR_PID(idx))];
+    while (*link != OTUR_NIL && *link != idx) {
+        link = &OTUR_CHUNK(*link)->hnext[OTUR_SLOT(*link)];
+    }
+    if (*link == idx) {
+        *link = OTUR_CHUNK(idx)->hnext[OTUR_SLOT(idx)];
+    }
+
+    if (OTUR_LEVEL(idx) != 0) {
+        table->leveled--;
+    }
+    if (OTUR_BOOST(idx) != 0) {
+        table->boosted--;
+    }
+    OTUR_QUEUE(idx) = 0;
+    OTUR_NODE(idx) = NULL;
+    OTUR_NEXT(idx) = table->free_head;
+    table->free_head = idx;
+    table->live--;
+}
+
+/* Finds the slot of the process with this pid in the given queue.
+ * - Different schedules may reuse a pid, so the queue is part of the key.
+ * Returns the slot index, or OTUR_NIL if there is none.
+ */
+uint32_t otur_table_find(pid_t pid, uint32_t queue_id) {
+    if (g_otur_table.bucket_count == 0) {
+        return OTUR_NIL;
+    }
+    uint32_t idx = g_otur_table.buckets[hash_bucket(pid)];
+    while (idx != OTUR_NIL) {
+        if (OTUR_PID(idx) == pid && OTUR_QUEUE(idx) == queue_id) {
+            return idx;
+        }
+        idx = OTUR_CHUNK(idx)->hnext[OTUR_SLOT(idx)];
+    }
+    return OTUR_NIL;
+}
+
+/* Returns a new, never used, queue id (0 means "in no queue") */
+uint32_t otur_table_queue_id() {
+    return ++g_otur_table.last_queue_id;
+}
+
+/* Records that dependent waits for prereq (both handed out slots), on both of their edge lists.
+ * Returns the new edge, or OTUR_NIL on any error.
+ */
+uint32_t otur_table_link(uint32_t prereq, uint32_t dependent) {
+    Otur_table_s *table = &g_otur_table;
+    uint32_t edge = table->edge_free;
+
+    if (edge != OTUR_NIL) { /* reuse a released edge first */
+        table->edge_free = table->edges[edge].next_out;
+    } else {
+        if (table->edge_used == table->edge_capacity) {
+            uint32_t capacity = table->edge_capacity ? table->edge_capacity * 2 : 64;
+            Otur_edge_s *edges = realloc(table->edges, sizeof(Otur_edge_s) * capacity);
+            if (edges == NULL) {
+                return OTUR_NIL;
+            }
+            table->edges = edges;
+            table->edge_capacity = capacity;
+        }
+        edge = table->edge_used++;
+    }
+
+    table->edges[edge] = (Otur_edge_s){ .prereq = prereq, .dependent = dependent,
+                                        .next_out = OTUR_OUT(prereq), .next_in = OTUR_IN(dependent) };
+    OTUR_OUT(prereq) = edge;
+    OTUR_IN(dependent) = edge;
+    table->edge_live++;
+    return edge;
+}
+
+/* Releases every edge to or from a slot, taking each off the other end's list too. */
+void otur_table_unlink(uint32_t idx) {
+    Otur_table_s *table = &g_otur_table;
+    while (OTUR_OUT(idx) != OTUR_NIL) {
+        uint32_t edge = OTUR_OUT(idx);
+        OTUR_OUT(idx) = table->edges[edge].next_out;
+        drop_edge(&OTUR_IN(table->edges[edge].dependent), edge, 1);
+        table->edges[edge].next_out = table->edge_free;
+        table->edge_free = edge;
+        table->edge_live--;
+    }
+    while (OTUR_IN(idx) != OTUR_NIL) {
+        uint32_t edge = OTUR_IN(idx);
+        OTUR_IN(idx) = table->edges[edge].next_in;
+        drop_edge(&OTUR_OUT(table->edges[edge].prereq), edge, 0);
+        table->edges[edge].next_out = table->edge_free;
+        table->edge_free = edge;
+        table->edge_live--;
+    }
+}
+
+/* Ages every process in the given queue by one, in a single pass over the table.
+ * Returns the number of those processes now at or over starving_age.
+ */
+int otur_table_age(uint32_t queue_id, int starving_age) {
+    Otur_table_s *table = &g_otur_table;
+    int starving = 0;
+
+    if (simd_level == SIMD_UNKNOWN) {
+        otur_table_simd();
+    }
+
+    for (uint32_t base = 0; base < table->used; base += OTUR_CHUNK_SIZE) {
+        Otur_chunk_s *chunk = table->chunks[base >> OTUR_CHUNK_BITS];
+        uint32_t count = table->used - base < OTUR_CHUNK_SIZE ? table->used - base : OTUR_CHUNK_SIZE;
+#if OTUR_X86
+        if (simd_level == SIMD_AVX2) {
+            starving += age_avx2(chunk->age, chunk->queue, count, queue_id, starving_age);
+            continue;
+        }
+        if (simd_level == SIMD_SSE2) {
+            starving += age_sse2(chunk->age, chunk->queue, count, queue_id, starving_age);
+            continue;
+        }
+#endif
+        starving += age_scalar(chunk->age, chunk->queue, count, queue_id, starving_age);
+    }
+    return starving;
+}
+
+/* Picks the aging pass for this CPU (once) and returns its name: avx2, sse2 or scalar */
+const char *otur_table_simd() {
+    static const char *names[] = { "scalar", "sse2", "avx2" };
+    if (simd_level == SIMD_UNKNOWN) {
+        simd_level = SIMD_SCALAR;
+#if OTUR_X86
+        __builtin_cpu_init();
+        if (__builtin_cpu_supports("avx2")) {
+            simd_level = SIMD_AVX2;
+        } else if (__builtin_cpu_supports("sse2")) {
+            simd_level = SIMD_SSE2;
+        }
+#endif
+    }
+    return names[simd_level];
+}
+
+/* Returns the milliseconds since the table's clock was first read (monotonic, wraps after 49 days) */
+uint32_t otur_table_now() {
+    static struct timespec epoch = {0};
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    if (epoch.tv_sec == 0 && epoch.tv_nsec == 0) {
+        epoch = now;
+    }
+    return (uint32_t)((now.tv_sec - epoch.tv_sec) * 1000 + (now.tv_nsec - epoch.tv_nsec) / 1000000);
+}
+
+/* Multiplicative hash of a pid into a bucket */
+static uint32_t hash_bucket(pid_t pid) {
+    return ((uint32_t)pid * 2654435761u) & (g_otur_table.bucket_count - 1);
+}
+
+/* Doubles the bucket array and rehashes every live slot.
+ * Returns 0 on success or -1 on any error.
+ */
+static int grow_buckets() {
+    Otur_table_s *table = &g_otur_table;
+    uint32_t count = table->bucket_count ? table->bucket_count * 2 : 64;
+    uint32_t *buckets = malloc(sizeof(uint32_t) * count);
+    if (buckets == NULL) {
+        return -1;
+    }
+    for (uint32_t i = 0; i < count; i++) {
+        buckets[i] = OTUR_NIL;
+    }
+
+    free(table->buckets);
+    table->buckets = buckets;
+    table->bucket_count = count;
+    for (uint32_t idx = 0; idx < table->used; idx++) {
+        if (OTUR_NODE(idx) != NULL) {
+            uint32_t bucket = hash_bucket(OTUR_PID(idx));
+            OTUR_CHUNK(idx)->hnext[OTUR_SLOT(idx)] = buckets[bucket];
+            buckets[bucket] = idx;
+        }
+    }
+    return 0;
+}
+
+/* Takes an edge off the in list or the out list that starts at head */
+static void drop_edge(uint32_t *head, uint32_t edge, int in_list) {
+    while (*head != OTUR_NIL && *head != edge) {
+        head = in_list ? &g_otur_table.edges[*head].next_in : &g_otur_table.edges[*head].next_out;
+    }
+    if (*head == edge) {
+        *head = in_list ? g_otur_table.edges[edge].next_in : g_otur_table.edges[edge].next_out;
+    }
+}
+
+/* Aging pass, one slot at a time (also finishes off the vector passes) */
+static int age_scalar(int32_t *age, const uint32_t *queue, uint32_t count, uint32_t queue_id, int starving_age) {
+    int starving = 0;
+    for (uint32_t i = 0; i < count; i++) {
+        if (queue[i] == queue_id) {
+            age[i]++;
+            starving += (age[i] >= starving_age);
+        }
+    }
+    return starving;
+}
+
+#if OTUR_X86
+/* Aging pass, 4 slots at a time.
+ * - Member lanes of the compare are -1, so subtracting it ages exactly the members; the others are
+ *   written back unchanged, which is safe since the table is only ever changed under the schedule lock.
+ */
+static int age_sse2(int32_t *age, const uint32_t *queue, uint32_t count, uint32_t queue_id, int starving_age) {
+    __m128i id = _mm_set1_epi32((int)queue_id);
+    __m128i limit = _mm_set1_epi32(starving_age - 1);
+    int starving = 0;
+    uint32_t i = 0;
+
+    for (; i + 4 <= count; i += 4) {
+        __m128i member = _mm_cmpeq_epi32(_mm_load_si128((const __m128i *)(queue + i)), id);
+        __m128i aged = _mm_sub_epi32(_mm_load_si128((const __m128i *)(age + i)), member);
+        _mm_store_si128((__m128i *)(age + i), aged);
+        __m128i starved = _mm_and_si128(_mm_cmpgt_epi32(aged, limit), member);
+        starving += __builtin_popcount(_mm_movemask_ps(_mm_castsi128_ps(starved)));
+    }
+    return starving + age_scalar(age + i, queue + i, count - i, queue_id, starving_age);
+}
+
+/* Aging pass, 8 slots at a time, storing only the lanes that are in the queue. */
+__attribute__((target("avx2")))
+static int age_avx2(int32_t *age, const uint32_t *queue, uint32_t count, uint32_t queue_id, int starving_age) {
+    __m256i id = _mm256_set1_epi32((int)queue_id);
+    __m256i limit = _mm256_set1_epi32(starving_age - 1);
+    int starving = 0;
+    uint32_t i = 0;
+
+    for (; i + 8 <= count; i += 8) {
+        __m256i member = _mm256_cmpeq_epi32(_mm256_load_si256((const __m256i *)(queue + i)), id);
+        if (_mm256_testz_si256(member, member)) {
+            continue; /* nobody from this queue in these 8 slots */
+        }
+        __m256i aged = _mm256_sub_epi32(_mm256_load_si256((const __m256i *)(age + i)), member); /* member lanes are -1 */
+        _mm256_maskstore_epi32((int *)(age + i), member, aged);
+        __m256i starved = _mm256_and_si256(_mm256_cmpgt_epi32(aged, limit), member);
+        starving += __builtin_popcount(_mm256_movemask_ps(_mm256_castsi256_ps(starved)));
+    }
+    return starving + age_scalar(age + i, queue + i, count - i, queue_id, starving_age);
+}
+#endif
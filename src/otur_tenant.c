@@ -0,0 +1,135 @@
+/* Standard Library Includes */
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+/* Local Includes */
+#include "otur_tenant.h"
+#include "vm_settings.h"
+
+/* The Tenants (tenant 0 is always there) */
+static Otur_tenant_s tenants[OTUR_MAX_TENANTS] = { { .name = OTUR_STR_NIL, .shares = DEFAULT_TENANT_SHARES } };
+static int tenant_count = 1;
+
+/* Finds (or adds, with DEFAULT_TENANT_SHARES) the tenant with this name.
+ * - "default" (or an empty name) is tenant 0.
+ * Returns the tenant's id, or -1 if there's no room for another or on any error.
+ */
+int otur_tenant(const char *name) {
+    if (name == NULL) {
+        return -1;
+    }
+    if (name[0] == '\0' || strcmp(name, "default") == 0) {
+        return 0;
+    }
+    for (int i = 1; i < tenant_count; i++) {
+        if (strcmp(otur_intern_str(tenants[i].name), name) == 0) {
+            return i;
+        }
+    }
+    if (tenant_count == OTUR_MAX_TENANTS) {
+        return -1;
+    }
+
+    Otur_str id = otur_intern(name);
+    if (id == OTUR_STR_NIL) {
+        return -1;
+    }
+    tenants[tenant_count] = (Otur_tenant_s){ .name = id, .shares = DEFAULT_TENANT_SHARES };
+    return tenant_count++;
+}
+
+/* Sets a tenant's shares (at least 1).
+ * Returns a 0 on success or a -1 on any error.
+ */
+int otur_tenant_shares(int tenant, uint32_t shares) {
+    if (tenant < 0 || tenant >= tenant_count || shares == 0) {
+        return -1;
+    }
+    tenants[tenant].shares = shares;
+    return 0;
+}
+
+/* Returns the tenant with this id, or NULL if there is none */
+const Otur_tenant_s *otur_tenant_info(int tenant) {
+    if (tenant < 0 || tenant >= tenant_count) {
+        return NULL;
+    }
+    return &tenants[tenant];
+}
+
+/* Returns the name of the tenant with this id ("" if there is none) */
+const char *otur_tenant_name(int tenant) {
+    if (tenant == 0) {
+        return "default";
+    }
+    if (tenant < 0 || tenant >= tenant_count) {
+        return "";
+    }
+    return otur_intern_str(tenants[tenant].name);
+}
+
+/* Returns the number of tenants, counting the default one */
+int otur_tenant_count() {
+    return tenant_count;
+}
+
+/* Charges a tenant for CPU time its processes used, after decaying everyone's recent usage. */
+void otur_tenant_charge(int tenant, uint32_t usec) {
+    if (tenant < 0 || tenant >= tenant_count) {
+        return;
+    }
+    for (int i = 0; i < tenant_count; i++) {
+        tenants[i].recent -= tenants[i].recent >> OTUR_TENANT_DECAY;
+    }
+    tenants[tenant].recent += usec;
+    tenants[tenant].total += usec;
+}
+
+/* Holds CPU time against a tenant that its processes are about to use, but that can only be charged
+ * once it's measured: it counts as recent usage when picking, until otur_tenant_release. */
+void otur_tenant_hold(int tenant, uint32_t usec) {
+    if (tenant < 0 || tenant >= tenant_count) {
+        return;
+    }
+    tenants[tenant].held += usec;
+}
+
+/* Drops every tenant's hold, eg. once the use it stood for has been charged */
+void otur_tenant_release() {
+    for (int i = 0; i < tenant_count; i++) {
+        tenants[i].held = 0;
+    }
+}
+
+/* Picks the most under-served of the tenants in ready (bit i set for tenant i): the least recent
+ * usage (and time held) per share, the lowest id on a tie.
+ * Returns its id, or -1 if ready is empty.
+ */
+int otur_tenant_pick(uint64_t ready) {
+    int best = -1;
+    uint64_t best_used = 0;
+    for (; ready != 0; ready &= ready - 1) {
+        int i = __builtin_ctzll(ready);
+        if (i >= tenant_count) {
+            break;
+        }
+        /* used_i / shares_i < used_best / shares_best, without dividing */
+        uint64_t used = tenants[i].recent + tenants[i].held;
+        if (best == -1 || (unsigned __int128)used * tenants[best].shares <
+                          (unsigned __int128)best_used * tenants[i].shares) {
+            best = i;
+            best_used = used;
+        }
+    }
+    return best;
+}
+
+/* Drops every tenant but the default one, and resets its shares and usage. */
+void otur_tenant_reset() {
+    for (int i = 1; i < tenant_count; i++) {
+        otur_intern_release(tenants[i].name);
+    }
+    tenants[0] = (Otur_tenant_s){ .name = OTUR_STR_NIL, .shares = DEFAULT_TENANT_SHARES };
+    tenant_count = 1;
+}
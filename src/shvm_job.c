@@ -0,0 +1,122 @@
+#define _GNU_SOURCE // syscall
+/* Standard Library Includes */
+#include <stdio.h>
+#include <stdint.h>
+#include <errno.h>
+#include <time.h>
+/* Linux System API Includes */
+#include <unistd.h>
+#include <fcntl.h>
+#include <sched.h>
+#include <pthread.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <linux/futex.h>
+/* StrawHat VM Includes */
+#include "shvm_job.h"
+
+/* Local Definitions */
+#define YIELD_CHECK_SEC 1 // How often a yielded job checks that shvm is still there
+
+/* The Control Page, mapped once by whichever call comes first */
+static pthread_once_t attach_once = PTHREAD_ONCE_INIT;
+static Shvm_page_s *page = NULL;
+static pid_t shvm_pid = 0;
+
+/* Local Prototypes */
+static void attach_page();
+static void notify(uint32_t state);
+static long futex(uint32_t *word, int op, uint32_t value, const struct timespec *timeout);
+
+/* Maps this process' control page, if it was launched by shvm (every other call does this too).
+ * Returns 0 if it's running under shvm, or -1 if not (the other calls then do nothing).
+ */
+int shvm_attach() {
+  pthread_once(&attach_once, attach_page);
+  return (page == NULL) ? -1 : 0;
+}
+
+/* Gives up the rest of this slice, and returns once shvm gives it the next one */
+void shvm_yield() {
+  if(shvm_attach() == -1) {
+    sched_yield();
+    return;
+  }
+  uint32_t slice = __atomic_load_n(&page->slice, __ATOMIC_ACQUIRE);
+  __atomic_add_fetch(&page->yields, 1, __ATOMIC_RELAXED);
+  notify(SHVM_JOB_YIELDED);
+
+  // Suspended meanwhile or not, shvm bumps slice as it resumes it.
+  struct timespec check = { YIELD_CHECK_SEC, 0 };
+  while(__atomic_load_n(&page->slice, __ATOMIC_ACQUIRE) == slice && getppid() == shvm_pid) {
+    futex(&page->slice, FUTEX_WAIT, slice, &check);
+  }
+  __atomic_store_n(&page->state, SHVM_JOB_RUNNING, __ATOMIC_RELEASE);
+}
+
+/* Says this process is about to block (eg. on I/O), so shvm parks it instead of giving it slices */
+void shvm_block() {
+  if(shvm_attach() == -1) {
+    return;
+  }
+  __atomic_add_fetch(&page->blocks, 1, __ATOMIC_RELAXED);
+  notify(SHVM_JOB_BLOCKED);
+}
+
+/* Says this process is done blocking, and can use its slices again */
+void shvm_unblock() {
+  if(shvm_attach() == -1) {
+    return;
+  }
+  notify(SHVM_JOB_RUNNING);
+}
+
+/* Publishes how far this process has got, in whatever units it likes */
+void shvm_progress(uint64_t done) {
+  if(shvm_attach() == -1) {
+    return;
+  }
+  __atomic_store_n(&page->progress, done, __ATOMIC_RELEASE);
+}
+
+/* Returns the length (usec) of the slice shvm last gave this process, or -1 if not under shvm */
+long shvm_slice_usec() {
+  if(shvm_attach() == -1) {
+    return -1;
+  }
+  return (long)__atomic_load_n(&page->slice_usec, __ATOMIC_ACQUIRE);
+}
+
+/* Maps the page shvm set up for this process (shvm is its parent, whether or not it came from a stub) */
+static void attach_page() {
+  char name[64];
+  shvm_pid = getppid();
+  snprintf(name, sizeof(name), SHVM_PAGE_NAME, (int)shvm_pid, (int)getpid());
+  int fd = shm_open(name, O_RDWR | O_CLOEXEC, 0);
+  if(fd == -1) {
+    return;
+  }
+  Shvm_page_s *map = mmap(NULL, sizeof(Shvm_page_s), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+  close(fd);
+  if(map == MAP_FAILED) {
+    return;
+  }
+  if(__atomic_load_n(&map->magic, __ATOMIC_ACQUIRE) != SHVM_PAGE_MAGIC || map->version != SHVM_PAGE_VERSION) {
+    munmap(map, sizeof(Shvm_page_s));
+    return;
+  }
+  __atomic_store_n(&map->attached, 1, __ATOMIC_RELEASE);
+  page = map;
+}
+
+/* Records a new state, then wakes shvm if it's waiting on this process */
+static void notify(uint32_t state) {
+  __atomic_store_n(&page->state, state, __ATOMIC_RELEASE);
+  __atomic_add_fetch(&page->event, 1, __ATOMIC_RELEASE);
+  futex(&page->event, FUTEX_WAKE, 1, NULL);
+}
+
+/* The futex system call (shared, not private: the words are in a page shared with shvm) */
+static long futex(uint32_t *word, int op, uint32_t value, const struct timespec *timeout) {
+  return syscall(SYS_futex, word, op, value, timeout, NULL, 0);
+}
@@ -3,6 +3,8 @@
 #include <stdlib.h>
 #include <string.h>
 #include <errno.h>
+/* Linux System API Includes */
+#include <pthread.h>
 /* Local Includes */
 #include "otur_sched.h" // Your schedule for the functions you're testing.
 #include "vm_support.h" // Gives ABORT_ERROR, PRINT_WARNING, PRINT_STATUS, PRINT_DEBUG commands
@@ -19,6 +21,17 @@ void test_otur_select();
 void test_otur_promote();
 void test_otur_exited();
 void test_otur_reap();
+void test_otur_table_age();
+void test_otur_intern();
+void test_otur_block();
+void test_otur_learn();
+void test_otur_gang();
+void test_otur_tenant();
+void test_otur_depend();
+void test_otur_sjf();
+void test_otur_footprint();
+void test_otur_state();
+void test_otur_override();
 static void test_queue_initialized(Otur_queue_s *queue);
 
 /* This is an EXAMPLE tester file, change anything you like!
@@ -51,6 +64,29 @@ int main() {
   test_otur_exited();
   PRINT_STATUS("Test 7: Testing otur_reap");
   test_otur_reap();
+  PRINT_STATUS("Test 8: Testing the Process Table age scan");
+  test_otur_table_age();
+  PRINT_STATUS("Test 9: Testing the command intern table");
+  test_otur_intern();
+  PRINT_STATUS("Test 10: Testing otur_block and otur_unblock");
+  test_otur_block();
+
+  PRINT_STATUS("Test 11: Testing otur_learn");
+  test_otur_learn();
+  PRINT_STATUS("Test 12: Testing gangs (otur_join, otur_select_gang)");
+  test_otur_gang();
+  PRINT_STATUS("Test 13: Testing tenants (otur_tenant, otur_assign, otur_charge, otur_tenant_hold)");
+  test_otur_tenant();
+  PRINT_STATUS("Test 14: Testing dependencies (otur_depend, otur_cancel)");
+  test_otur_depend();
+  PRINT_STATUS("Test 15: Testing shortest job first (otur_predict, OTUR_POLICY_SJF)");
+  test_otur_sjf();
+  PRINT_STATUS("Test 16: Testing memory footprints (otur_footprint, defer_kb)");
+  test_otur_footprint();
+  PRINT_STATUS("Test 17: Testing the state word (otur_transition, blocked and group flags)");
+  test_otur_state();
+  PRINT_STATUS("Test 18: Testing launch overrides (otur_override, otur_pin)");
+  test_otur_override();
 
   // You would add more calls to testing helper functions that you like.
   // Then when done, you can print a nice message an then return.
@@ -114,9 +150,9 @@ static void test_queue_initialized(Otur_queue_s *queue) {
     ABORT_ERROR("...tried to test a NULL queue!");
   }
 
-  // Check that the head pointer is NULL.
-  if(queue->head != NULL) {
-    ABORT_ERROR("...the Queue doesn't have a NULL head pointer!");
+  // Check that the head slot is empty.
+  if(queue->head != OTUR_NIL) {
+    ABORT_ERROR("...the Queue doesn't have an empty head slot!");
   }
   // Check that the count is 0.
   if(queue->count != 0) {
@@ -126,7 +162,7 @@ static void test_queue_initialized(Otur_queue_s *queue) {
 
 void test_otur_invoke() {
   Otur_process_s *node1 = otur_invoke(1, 0, 0, "Node 1");
-  printf("PID: %d, Age: %d, CMD: %s, State %hx\n", node1->pid, node1->age, node1->cmd, node1->state);
+  printf("PID: %d, Age: %d, CMD: %s, State %hx\n", node1->pid, otur_age(node1), otur_cmd(node1), otur_state(node1));
 }
 
 // Helper functions
@@ -146,29 +182,29 @@ Otur_schedule_s *createSchedule() {
 }
 
 void printHigh(Otur_schedule_s *schedule) {
-    Otur_process_s *current = schedule->ready_queue_high->head;
+    Otur_process_s *current = otur_first(schedule->ready_queue_high);
     printf("Ready Queue (High) [%d]:\n", schedule->ready_queue_high->count);
     while (current != NULL) {
-        printf("%s (State: %hx, Age: %hx)\n", current->cmd, current->state, current->age);
-        current = current->next;
+        printf("%s (State: %hx, Age: %hx)\n", otur_cmd(current), otur_state(current), otur_age(current));
+        current = otur_next(current);
     }
 }
 
 void printNormal(Otur_schedule_s *schedule) {
-    Otur_process_s *current = schedule->ready_queue_normal->head;
+    Otur_process_s *current = otur_first(schedule->ready_queue_normal);
     printf("Ready Queue (Normal) [%d]:\n", schedule->ready_queue_normal->count);
     while (current != NULL) {
-        printf("%s (State: %hx, Age: %hx)\n", current->cmd, current->state, current->age);
-        current = current->next;
+        printf("%s (State: %hx, Age: %hx)\n", otur_cmd(current), otur_state(current), otur_age(current));
+        current = otur_next(current);
     }
 }
 
 void printDefunct(Otur_schedule_s *schedule) {
-    Otur_process_s *current = schedule->defunct_queue->head;
+    Otur_process_s *current = otur_first(schedule->defunct_queue);
     printf("Defunct Queue[%d]:\n", schedule->defunct_queue->count);
     while (current != NULL) {
-        printf("%s (State: %hx, Age: %hx)\n", current->cmd, current->state, current->age);
-        current = current->next;
+        printf("%s (State: %hx, Age: %hx)\n", otur_cmd(current), otur_state(current), otur_age(current));
+        current = otur_next(current);
     }
 }
 
@@ -272,3 +308,548 @@ void test_otur_reap() {
     printDefunct(schedule);
     printf("\n");
 }
+
+/* Ages a large Normal Queue sharing the table with another schedule, checking that
+ * every node is promoted in order on the STARVING_AGE'th pass, and nobody else is aged.
+ */
+void test_otur_table_age() {
+    Otur_schedule_s *schedule = otur_initialize();
+    Otur_schedule_s *other = otur_initialize();
+    int nodes = 10000, i;
+
+    printf("Aging pass: %s\n", otur_table_simd());
+    for (i = 0; i < nodes; i++) { /* interleave the two schedules' slots in the table */
+        otur_enqueue(schedule, otur_invoke(i + 1, 0, 0, "aging"));
+        otur_enqueue(other, otur_invoke(i + 1, 0, 0, "other"));
+    }
+    for (i = 1; i < STARVING_AGE; i++) {
+        otur_promote(schedule);
+    }
+    if (schedule->ready_queue_high->count != 0 || otur_age(otur_first(schedule->ready_queue_normal)) != STARVING_AGE - 1) {
+        ABORT_ERROR("...nodes were promoted before they were starving!");
+    }
+    otur_promote(schedule);
+    printf("After %d promotes: High %d, Normal %d, Other Normal %d (Age %d)\n", STARVING_AGE,
+           otur_count(schedule->ready_queue_high), otur_count(schedule->ready_queue_normal),
+           otur_count(other->ready_queue_normal), otur_age(otur_last(other->ready_queue_normal)));
+
+    i = 1;
+    for (Otur_process_s *current = otur_first(schedule->ready_queue_high); current != NULL; current = otur_next(current)) {
+        if (current->pid != i++) {
+            ABORT_ERROR("...promoted nodes are out of order!");
+        }
+    }
+    if (i != nodes + 1 || otur_age(otur_last(other->ready_queue_normal)) != 0) {
+        ABORT_ERROR("...the age scan touched the wrong nodes!");
+    }
+    otur_killed(other, nodes / 2, 9); /* found through the pid hash, not the first schedule's node */
+    printf("otur_killed(%d): Other Defunct %d, First High %d\n", nodes / 2,
+           otur_count(other->defunct_queue), otur_count(schedule->ready_queue_high));
+    otur_cleanup(schedule);
+    otur_cleanup(other);
+}
+
+/* Checks that processes running the same command share one interned copy of it,
+ * and that it's only freed along with the last of them.
+ */
+void test_otur_intern() {
+    Otur_schedule_s *schedule = otur_initialize();
+    uint32_t before = otur_intern_count();
+    Otur_process_s *node1 = otur_invoke(1, 0, 0, "shared command");
+    Otur_process_s *node2 = otur_invoke(2, 0, 0, "shared command");
+    Otur_process_s *node3 = otur_invoke(3, 0, 0, "own command");
+
+    printf("Handles: %u %u %u, Strings: %u new\n", node1->cmd, node2->cmd, node3->cmd, otur_intern_count() - before);
+    if (node1->cmd != node2->cmd || node1->cmd == node3->cmd || otur_intern_count() - before != 2) {
+        ABORT_ERROR("...identical commands were not shared!");
+    }
+
+    otur_enqueue(schedule, node1);
+    otur_enqueue(schedule, node2);
+    otur_enqueue(schedule, node3);
+    otur_exited(schedule, otur_select(schedule), 0);
+    otur_reap(schedule, 1);
+    printf("After reaping PID 1: %s (Strings: %u new)\n", otur_cmd(node2), otur_intern_count() - before);
+    if (strcmp(otur_cmd(node2), "shared command") != 0 || otur_intern_count() - before != 2) {
+        ABORT_ERROR("...a shared command was freed while still in use!");
+    }
+    otur_cleanup(schedule);
+    printf("After otur_cleanup: %u new\n", otur_intern_count() - before);
+}
+
+void printWait(Otur_schedule_s *schedule) {
+    Otur_process_s *current = otur_first(schedule->wait_queue);
+    printf("Wait Queue [%d]:\n", schedule->wait_queue->count);
+    while (current != NULL) {
+        printf("%s (State: %hx, Age: %hx)\n", otur_cmd(current), otur_state(current), otur_age(current));
+        current = otur_next(current);
+    }
+}
+
+/* Blocks two selected processes, then checks that select skips them, that unblock returns
+ * them to their own Ready Queue, and that a blocked process can still be killed.
+ */
+void test_otur_block() {
+    Otur_schedule_s *schedule = createSchedule();
+
+    otur_block(schedule, otur_select(schedule)); /* node 2 (critical) */
+    otur_block(schedule, otur_select(schedule)); /* node 1 (high) */
+    printf("After blocking two:\n");
+    printHigh(schedule);
+    printNormal(schedule);
+    printWait(schedule);
+
+    Otur_process_s *next = otur_select(schedule);
+    printf("Select while blocked: %s\n", next ? otur_cmd(next) : "(none)");
+    if (next == NULL || next->pid != 3) {
+        ABORT_ERROR("...otur_select didn't skip the blocked processes!");
+    }
+    otur_enqueue(schedule, next);
+
+    if (otur_unblock(schedule, 1) != 0 || otur_unblock(schedule, 1) != -1) {
+        ABORT_ERROR("...otur_unblock didn't move node 1 exactly once!");
+    }
+    if (otur_killed(schedule, 2, 9) != 0) {
+        ABORT_ERROR("...otur_killed couldn't find a blocked process!");
+    }
+    printf("After unblocking node 1 and killing node 2:\n");
+    printHigh(schedule);
+    printNormal(schedule);
+    printWait(schedule);
+    printDefunct(schedule);
+    otur_cleanup(schedule);
+}
+
+/* Runs a CPU hog and an interactive process through a few slices each, then checks that
+ * their quanta stay within the limits and that the interactive one is picked first, while
+ * ages (and so promotion) are left to the waiting alone.
+ */
+void test_otur_learn() {
+    Otur_schedule_s *schedule = otur_initialize();
+    Otur_process_s *hog = otur_invoke(1, 0, 0, "hog");
+    Otur_process_s *interactive = otur_invoke(2, 0, 0, "interactive");
+
+    if (otur_quantum(hog) != 0 || otur_usage(hog) != OTUR_USAGE_UNKNOWN) {
+        ABORT_ERROR("...a new process already has a learned quantum!");
+    }
+    for (int i = 0; i < 8; i++) {
+        otur_learn(hog, 250000, 250000, 100000, 1000000);        /* uses all of every slice */
+        otur_learn(interactive, 5000, 250000, 100000, 1000000);  /* gives the CPU back right away */
+    }
+    otur_enqueue(schedule, hog);
+    otur_enqueue(schedule, interactive);
+    printf("Hog: Quantum %u usec, CPU %u/1000, Boost %d\n", otur_quantum(hog), otur_usage(hog), otur_boost(hog));
+    printf("Interactive: Quantum %u usec, CPU %u/1000, Boost %d\n", otur_quantum(interactive), otur_usage(interactive), otur_boost(interactive));
+    if (otur_quantum(hog) != 375000 || otur_quantum(interactive) != 100000) {
+        ABORT_ERROR("...quanta weren't learned or clamped to the minimum!");
+    }
+    if (otur_boost(interactive) <= otur_boost(hog) || otur_age(interactive) != 0 || otur_age(hog) != 0) {
+        ABORT_ERROR("...the interactive process didn't get its boost, or learning changed an age!");
+    }
+
+    /* the hog, ahead in the queue, still waits for the interactive one until it's starving */
+    otur_promote(schedule);
+    if (otur_select(schedule) != interactive) {
+        ABORT_ERROR("...the interactive process wasn't picked ahead of the hog!");
+    }
+    for (int i = 0; i < STARVING_AGE; i++) {
+        otur_promote(schedule);
+    }
+    if (otur_first(schedule->ready_queue_high) != hog) {
+        ABORT_ERROR("...the hog wasn't promoted once it starved!");
+    }
+    otur_enqueue(schedule, interactive);
+
+    otur_learn(hog, 4000000, 4000000, 100000, 1000000);
+    printf("Hog after a 4 sec burst: Quantum %u usec\n", otur_quantum(hog));
+    if (otur_quantum(hog) != 1000000 || otur_learn(hog, 0, 0, 100000, 1000000) != -1) {
+        ABORT_ERROR("...quantum wasn't clamped to the maximum, or an empty slice was accepted!");
+    }
+    otur_cleanup(schedule);
+}
+
+void test_otur_gang() {
+    uint32_t before = otur_intern_count();
+    Otur_schedule_s *schedule = otur_initialize();
+    Otur_process_s *loner = otur_invoke(1, 0, 0, "loner");
+    Otur_process_s *server = otur_invoke(2, 1, 0, "server");
+    Otur_process_s *client = otur_invoke(3, 0, 0, "client");
+    Otur_process_s *worker = otur_invoke(4, 0, 0, "worker");
+
+    if (otur_gang(loner) != OTUR_STR_NIL || otur_join(server, "web") != 0 || otur_join(client, "web") != 0 ||
+        otur_join(worker, "web") != 0 || otur_join(loner, "") != -1) {
+        ABORT_ERROR("...otur_join didn't put the right processes in the gang!");
+    }
+    if (otur_gang(server) != otur_gang(client) || strcmp(otur_gang_name(worker), "web") != 0) {
+        ABORT_ERROR("...gang mates don't share the gang name!");
+    }
+    otur_enqueue(schedule, loner);
+    otur_enqueue(schedule, server);
+    otur_enqueue(schedule, client);
+    otur_enqueue(schedule, worker);
+
+    /* the worker is promoted with the client when it starves, even though it is still young */
+    otur_set_age(client, STARVING_AGE - 1);
+    otur_promote(schedule);
+    if (otur_count(schedule->ready_queue_high) != 3 || otur_first(schedule->ready_queue_normal) != loner) {
+        ABORT_ERROR("...the gang wasn't promoted together!");
+    }
+
+    Otur_process_s *leader = otur_select(schedule);
+    Otur_process_s *members[4] = {NULL};
+    int count = otur_select_gang(schedule, leader, members, 4);
+    printf("Gang %s: leader PID %d with %d members\n", otur_gang_name(leader), leader->pid, count);
+    if (leader != server || count != 2 || members[0] != client || members[1] != worker) {
+        ABORT_ERROR("...otur_select_gang didn't pick the client and the worker!");
+    }
+    if (!(otur_state(worker) & (1 << 13)) || otur_age(worker) != 0 || otur_select_gang(schedule, loner, members, 4) != 0) {
+        ABORT_ERROR("...gang members weren't marked running, or a process in no gang had members!");
+    }
+    otur_exited(schedule, client, 0);
+    otur_reap(schedule, 3);
+    otur_enqueue(schedule, server);
+    otur_enqueue(schedule, worker);
+    otur_cleanup(schedule);
+    if (otur_intern_count() != before) {
+        ABORT_ERROR("...the gang name wasn't released with its members!");
+    }
+}
+
+void test_otur_tenant() {
+    uint32_t before = otur_intern_count();
+    Otur_schedule_s *schedule = otur_initialize();
+    int batch = otur_tenant("batch");
+    int web = otur_tenant("web");
+    if (batch != 1 || web != 2 || otur_tenant("batch") != batch || otur_tenant("default") != 0 ||
+        otur_tenant_shares(web, 0) != -1 || strcmp(otur_tenant_name(web), "web") != 0) {
+        ABORT_ERROR("...tenants weren't found or added properly!");
+    }
+
+    /* batch floods the queue first, web comes after */
+    Otur_process_s *nodes[5];
+    for (int i = 0; i < 5; i++) {
+        nodes[i] = otur_invoke(i + 1, 0, 0, "job");
+        otur_assign(nodes[i], i < 4 ? batch : web);
+        otur_enqueue(schedule, nodes[i]);
+    }
+    if (otur_assign(nodes[0], 9) != -1 || otur_tenant_of(nodes[4]) != web) {
+        ABORT_ERROR("...otur_assign accepted a tenant that doesn't exist!");
+    }
+
+    /* web gets three times the share: after batch's first slice, it runs until it has used 3x as much */
+    otur_tenant_shares(web, 3 * DEFAULT_TENANT_SHARES);
+    int order[6] = {0};
+    for (int i = 0; i < 6; i++) {
+        Otur_process_s *node = otur_select(schedule);
+        order[i] = otur_tenant_of(node);
+        otur_charge(node, 100000);
+        otur_enqueue(schedule, node);
+    }
+    printf("Tenants selected: %d %d %d %d %d %d\n", order[0], order[1], order[2], order[3], order[4], order[5]);
+    if (order[0] != batch || order[1] != web || order[2] != web || order[3] != web || order[4] != batch) {
+        ABORT_ERROR("...tenants weren't selected by their shares!");
+    }
+    if (otur_tenant_info(web)->total != 400000 || otur_tenant_info(batch)->total != 200000) {
+        ABORT_ERROR("...usage wasn't charged to the tenants!");
+    }
+
+    /* time held against a tenant counts when picking, but isn't charged, and goes with the release */
+    uint64_t both = (1ull << batch) | (1ull << web);
+    int before_hold = otur_tenant_pick(both);
+    int other = (before_hold == web) ? batch : web;
+    otur_tenant_hold(before_hold, 10000000);
+    if (otur_tenant_pick(both) != other || otur_tenant_info(before_hold)->total != (before_hold == web ? 400000 : 200000)) {
+        ABORT_ERROR("...a hold wasn't counted when picking, or was charged!");
+    }
+    otur_tenant_release();
+    if (otur_tenant_pick(both) != before_hold) {
+        ABORT_ERROR("...a hold outlived otur_tenant_release!");
+    }
+
+    otur_cleanup(schedule);
+    if (otur_tenant_count() != 1 || otur_intern_count() != before) {
+        ABORT_ERROR("...tenants weren't dropped with the schedule!");
+    }
+}
+
+void test_otur_depend() {
+    Otur_schedule_s *schedule = otur_initialize();
+    Otur_process_s *a = otur_invoke(101, 0, 0, "stage a");
+    Otur_process_s *b = otur_invoke(102, 0, 0, "stage b");
+    Otur_process_s *c = otur_invoke(103, 0, 0, "stage c");
+    Otur_process_s *d = otur_invoke(104, 0, 0, "other");
+    Otur_process_s *e = otur_invoke(105, 0, 0, "report");
+    otur_enqueue(schedule, d);
+    otur_enqueue(schedule, a);
+
+    /* a -> b -> c, and a -> e (pids no other test leaves behind) */
+    if (otur_depend(schedule, b, 101) != 1 || otur_depend(schedule, c, 102) != 1 || otur_depend(schedule, e, 101) != 1) {
+        ABORT_ERROR("...otur_depend didn't add the dependencies!");
+    }
+    otur_enqueue(schedule, b);
+    otur_enqueue(schedule, c);
+    otur_enqueue(schedule, e);
+    printf("Paths: a %u, b %u, c %u, Pending: %d\n", otur_path(a), otur_path(b), otur_path(c),
+           otur_count(schedule->pending_queue));
+    if (otur_path(a) != 2 || otur_path(b) != 1 || otur_path(c) != 0 || otur_count(schedule->pending_queue) != 3) {
+        ABORT_ERROR("...the dependents weren't held, or the chains weren't measured!");
+    }
+
+    /* the head of the chain goes first, even behind an older process */
+    if (otur_select(schedule) != a) {
+        ABORT_ERROR("...the process on the longest chain wasn't selected first!");
+    }
+    otur_exited(schedule, a, 0);
+    if (otur_count(schedule->pending_queue) != 1 || otur_select(schedule) != b) {
+        ABORT_ERROR("...a success didn't release b and e, or b wasn't next!");
+    }
+
+    /* b fails: c can never run, so it's handed out once to be killed */
+    Otur_process_s *cancelled[4] = {NULL};
+    otur_exited(schedule, b, 1);
+    if (otur_cancel(schedule, cancelled, 4) != 1 || cancelled[0] != c || otur_cancel(schedule, cancelled, 4) != 0) {
+        ABORT_ERROR("...c wasn't cancelled exactly once after b failed!");
+    }
+    Otur_process_s *late = otur_invoke(106, 0, 0, "late");
+    if (otur_depend(schedule, late, 102) != -1 || otur_depend(schedule, late, 999) != -1 || otur_deps(late) != OTUR_DEPS_FAILED) {
+        ABORT_ERROR("...a process could run after one that failed!");
+    }
+    otur_enqueue(schedule, late);
+    if (otur_killed(schedule, 103, 0) != 0 || otur_killed(schedule, 106, 0) != 0 || g_otur_table.edge_live != 0 ||
+        (otur_state(c) & 0xFF) != OTUR_EXIT_CANCELLED) {
+        ABORT_ERROR("...cancelled processes weren't found in the Pending Queue, or edges were left behind!");
+    }
+    otur_cleanup(schedule);
+}
+
+void test_otur_sjf() {
+    Otur_schedule_s *schedule = otur_initialize();
+    Otur_process_s *slow = otur_invoke(201, 0, 0, "slow");
+    Otur_process_s *fresh = otur_invoke(202, 0, 0, "never seen");
+    Otur_process_s *quick = otur_invoke(203, 0, 0, "quick");
+    Otur_process_s *medium = otur_invoke(204, 0, 0, "medium");
+    otur_predict(slow, 5 * SJF_UNKNOWN_USEC);
+    otur_predict(quick, SJF_UNKNOWN_USEC / 5);
+    otur_predict(medium, SJF_UNKNOWN_USEC / 2);
+    if (otur_predict(NULL, 1) != -1 || otur_predicted(quick) != SJF_UNKNOWN_USEC / 5 || otur_predicted(fresh) != 0) {
+        ABORT_ERROR("...otur_predict didn't set the predictions!");
+    }
+    Otur_process_s *nodes[] = { slow, fresh, quick, medium };
+    for (int i = 0; i < 4; i++) {
+        otur_enqueue(schedule, nodes[i]);
+    }
+
+    /* first come first served by default */
+    if (schedule->policy != OTUR_POLICY_FIFO || otur_select(schedule) != slow) {
+        ABORT_ERROR("...the default policy didn't select the head!");
+    }
+    otur_enqueue(schedule, slow);
+
+    /* then the least time left first: quick keeps the CPU while it still has the least left */
+    schedule->policy = OTUR_POLICY_SJF;
+    if (otur_select(schedule) != quick) {
+        ABORT_ERROR("...the shortest job wasn't selected first!");
+    }
+    otur_charge(quick, SJF_UNKNOWN_USEC / 10);
+    otur_enqueue(schedule, quick);
+    if (otur_ran(quick) != SJF_UNKNOWN_USEC / 10 || otur_select(schedule) != quick) {
+        ABORT_ERROR("...the job with the least time left wasn't selected!");
+    }
+    /* far past its prediction, it loses its place */
+    otur_charge(quick, 3 * SJF_UNKNOWN_USEC);
+    otur_enqueue(schedule, quick);
+    if (otur_select(schedule) != medium) {
+        ABORT_ERROR("...a job past its prediction kept its place!");
+    }
+    otur_exited(schedule, medium, 0);
+
+    /* one just at its prediction has nothing left, but one just past it goes behind every job within its own */
+    Otur_process_s *done = otur_invoke(205, 0, 0, "done");
+    Otur_process_s *over = otur_invoke(206, 0, 0, "over");
+    otur_predict(done, SJF_UNKNOWN_USEC / 5);
+    otur_predict(over, SJF_UNKNOWN_USEC / 5);
+    otur_charge(done, SJF_UNKNOWN_USEC / 5);
+    otur_charge(over, SJF_UNKNOWN_USEC / 5 + 1);
+    otur_enqueue(schedule, over);
+    otur_enqueue(schedule, done);
+    if (otur_select(schedule) != done) {
+        ABORT_ERROR("...a job at its prediction wasn't selected first!");
+    }
+    otur_exited(schedule, done, 0);
+
+    /* aging: a starving job goes first, however long it is */
+    otur_set_age(slow, STARVING_AGE);
+    Otur_process_s *order[4] = { otur_select(schedule), otur_select(schedule), otur_select(schedule), otur_select(schedule) };
+    printf("SJF order: %s, %s, %s, %s\n", otur_cmd(order[0]), otur_cmd(order[1]), otur_cmd(order[2]), otur_cmd(order[3]));
+    if (order[0] != slow || order[1] != fresh || order[2] != over || order[3] != quick) {
+        ABORT_ERROR("...a starving job wasn't selected first, or the rest weren't by time left (overruns last)!");
+    }
+    otur_exited(schedule, slow, 0);
+    otur_exited(schedule, fresh, 0);
+    otur_exited(schedule, over, 0);
+    otur_exited(schedule, quick, 0);
+    otur_cleanup(schedule);
+}
+
+void test_otur_footprint() {
+    Otur_schedule_s *schedule = otur_initialize();
+    Otur_process_s *big = otur_invoke(301, 0, 0, "big");
+    Otur_process_s *huge = otur_invoke(302, 0, 0, "huge");
+    Otur_process_s *small = otur_invoke(303, 0, 0, "small");
+    otur_footprint(big, 512 * 1024);
+    otur_footprint(huge, 2048 * 1024);
+    otur_footprint(small, 4 * 1024);
+    if (otur_footprint(NULL, 1) != -1 || otur_rss(big) != 512 * 1024) {
+        ABORT_ERROR("...otur_footprint didn't set the footprint!");
+    }
+    Otur_process_s *nodes[] = { huge, big, small };
+    for (int i = 0; i < 3; i++) {
+        otur_enqueue(schedule, nodes[i]);
+    }
+
+    /* without pressure, footprints change nothing */
+    if (otur_select(schedule) != huge || schedule->deferred != 0) {
+        ABORT_ERROR("...a footprint mattered without defer_kb!");
+    }
+    otur_enqueue(schedule, huge);
+
+    /* under pressure, the small one goes first, then the smallest of the large ones */
+    schedule->defer_kb = 256 * 1024;
+    Otur_process_s *order[3] = { otur_select(schedule), otur_select(schedule), otur_select(schedule) };
+    printf("Footprint order: %s, %s, %s\n", otur_cmd(order[0]), otur_cmd(order[1]), otur_cmd(order[2]));
+    if (order[0] != small || order[1] != big || order[2] != huge || schedule->deferred != 1) {
+        ABORT_ERROR("...a large process wasn't deferred for a smaller one!");
+    }
+
+    /* holding, the large ones aren't selected at all */
+    otur_enqueue(schedule, big);
+    schedule->defer_hold = 1;
+    if (otur_select(schedule) != NULL || schedule->deferred != 2) {
+        ABORT_ERROR("...a large process was selected while they were held!");
+    }
+    otur_exited(schedule, small, 0);
+    otur_exited(schedule, huge, 0);
+    otur_cleanup(schedule);
+}
+
+/* Sets and clears one flag over and over, for test_otur_state */
+static void *flip_flag(void *arg) {
+    Otur_process_s *node = ((void **)arg)[0];
+    uint32_t flag = *(uint32_t *)((void **)arg)[1];
+    for (int i = 0; i < 100000; i++) {
+        otur_transition(node, 0, flag);
+        otur_transition(node, flag, 0);
+    }
+    return NULL;
+}
+
+/* Local function to test the state word's transitions from otur_sched.h and otur_sched.c */
+void test_otur_state() {
+    Otur_schedule_s *schedule = otur_initialize();
+    Otur_process_s *node = otur_invoke(401, 0, 1, "state");
+    if (otur_state(node) != (OTUR_READY | OTUR_CRITICAL | OTUR_HIGH)) {
+        ABORT_ERROR("...a critical process didn't start out ready, critical and high!");
+    }
+
+    /* blocked while in the Wait Queue, and only then */
+    otur_enqueue(schedule, node);
+    otur_block(schedule, otur_select(schedule));
+    if (!(otur_state(node) & OTUR_BLOCKED)) {
+        ABORT_ERROR("...otur_block didn't flag the process blocked!");
+    }
+    otur_unblock(schedule, 401);
+    if (otur_state(node) & OTUR_BLOCKED) {
+        ABORT_ERROR("...otur_unblock left the process flagged blocked!");
+    }
+    otur_join(node, "pair");
+    if (!(otur_state(node) & OTUR_GROUP)) {
+        ABORT_ERROR("...otur_join didn't flag the process as in a group!");
+    }
+
+    /* threads flipping different flags of the same word never lose each other's changes */
+    uint32_t flags[2] = { OTUR_PINNED, OTUR_BLOCKED };
+    void *args[2][2] = { { node, &flags[0] }, { node, &flags[1] } };
+    pthread_t threads[2];
+    for (int i = 0; i < 2; i++) {
+        pthread_create(&threads[i], NULL, flip_flag, args[i]);
+    }
+    for (int i = 0; i < 2; i++) {
+        pthread_join(threads[i], NULL);
+    }
+    uint32_t expect = OTUR_READY | OTUR_CRITICAL | OTUR_HIGH | OTUR_GROUP;
+    printf("State after the threads: %x (expected %x)\n", otur_state(node), expect);
+    if (otur_state(node) != expect) {
+        ABORT_ERROR("...a concurrent transition was lost!");
+    }
+
+    /* killed: defunct only (not ready or running), with the exit code */
+    otur_killed(schedule, 401, 9);
+    if ((otur_state(node) & (OTUR_READY | OTUR_RUNNING | OTUR_DEFUNCT | OTUR_EXIT_MASK)) != (OTUR_DEFUNCT | 9)) {
+        ABORT_ERROR("...otur_killed didn't leave the process defunct with its exit code!");
+    }
+    if (otur_reap(schedule, 401) != 9) {
+        ABORT_ERROR("...otur_reap didn't return the exit code from the state word!");
+    }
+    otur_cleanup(schedule);
+}
+
+/* Local function to test otur_override and otur_pin from otur_sched.c */
+void test_otur_override() {
+    Otur_schedule_s *schedule = otur_initialize();
+    Otur_process_s *node = otur_invoke(501, 0, 0, "probe");
+    if (otur_fixed_quantum(node) != 0 || otur_level(node) != 0 || otur_cpus(node) != 0) {
+        ABORT_ERROR("...a new process started out with overrides!");
+    }
+    if (otur_override(node, 20000, 0) == -1 || otur_override(node, 20000, MAX_PRIORITY + 1) != -1 ||
+        otur_override(NULL, 0, 0) != -1 || otur_override(node, 20000, 3) == -1) {
+        ABORT_ERROR("...otur_override didn't check its level!");
+    }
+    if (otur_fixed_quantum(node) != 20000 || otur_level(node) != 3) {
+        ABORT_ERROR("...otur_override didn't keep the quantum and level!");
+    }
+
+    /* learning doesn't touch what was asked for */
+    otur_learn(node, 5000, 20000, 10000, 1000000);
+    if (otur_fixed_quantum(node) != 20000) {
+        ABORT_ERROR("...otur_learn changed a fixed quantum!");
+    }
+
+    /* pinning sets the flag, unpinning clears it */
+    otur_pin(node, 0x5);
+    if (otur_cpus(node) != 0x5 || !(otur_state(node) & OTUR_PINNED)) {
+        ABORT_ERROR("...otur_pin didn't pin the process!");
+    }
+    otur_pin(node, 0);
+    if (otur_state(node) & OTUR_PINNED) {
+        ABORT_ERROR("...otur_pin(0) left the process pinned!");
+    }
+    otur_enqueue(schedule, node);
+    otur_killed(schedule, 501, 0);
+
+    /* a lower level is selected first, whatever the queue order; no level ranks as DEFAULT_PRIORITY */
+    Otur_process_s *batch = otur_invoke(502, 0, 0, "batch");
+    Otur_process_s *plain = otur_invoke(503, 0, 0, "plain");
+    Otur_process_s *probe = otur_invoke(504, 0, 0, "probe");
+    otur_override(batch, 0, MAX_PRIORITY);
+    otur_override(probe, 0, MIN_PRIORITY);
+    otur_enqueue(schedule, batch);
+    otur_enqueue(schedule, plain);
+    otur_enqueue(schedule, probe);
+    Otur_process_s *order[3] = { otur_select(schedule), otur_select(schedule), otur_select(schedule) };
+    printf("Level order: %s, %s, %s\n", otur_cmd(order[0]), otur_cmd(order[1]), otur_cmd(order[2]));
+    if (order[0] != probe || order[1] != plain || order[2] != batch) {
+        ABORT_ERROR("...a lower priority level wasn't selected first!");
+    }
+
+    /* a starving process goes ahead of any level */
+    otur_enqueue(schedule, probe);
+    otur_enqueue(schedule, batch);
+    otur_set_age(batch, STARVING_AGE);
+    if (otur_select(schedule) != batch) {
+        ABORT_ERROR("...a starving process waited behind a lower level!");
+    }
+    otur_exited(schedule, batch, 0);
+    otur_exited(schedule, plain, 0);
+    otur_killed(schedule, 504, 0);
+    otur_cleanup(schedule);
+}
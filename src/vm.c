@@ -1,18 +1,26 @@
 /* Standard Library Includes */
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
+#include <errno.h>
 /* Linux System API Includes */
 #include <signal.h>
 #include <unistd.h>
 #include <sys/types.h>
 #include <sys/wait.h>
 #include <sys/time.h>
+#include <pthread.h>
 /* Project Includes */
 #include "vm_support.h"
 #include "vm_shell.h"
 #include "vm_process.h"
 #include "vm_printing.h"
 #include "vm_cs.h"
+#include "vm_ctl.h"
+#include "vm_persist.h"
+#include "vm_history.h"
+#include "vm_zygote.h"
+#include "vm_output.h"
 
 /* Project Globals */
 int g_debug_mode = DEFAULT_DEBUG; // Default is to start at Debug OFF.
@@ -24,34 +32,94 @@ void hnd_sigsegv(int sig) {
   ABORT_ERROR("Segmentation Fault Detected!\n");
 }
 
-/* Handler for Ctrl-C entered by the User (Toggle the CS System) */
-void hnd_sigint(int sig) {
-  // This is faster than using 'start' and 'stop'
-  handle_ctrlc(); // Toggles the Context Switch System on and off. 
-}
-
 /* Cleans up all threads and created processes.
  * - Registered with atexit
  */
 void vm_cleanup() {
   PRINT_STATUS("Cleaning up SHVM environment.");
   cs_cleanup();  // Shuts down and cleans up the CS system fully.
+  persist_close(); // The snapshot file stays behind for --recover
+  history_close(); // So does the runtime history, for the next shvm
 
   PRINT_STATUS("Deallocating all Processes.");
   deallocate_process_system();
+  output_stop();
+
+  // Last, so no exit of the zygote or its stubs reaches the Process System's SIGCHLD handler
+  signal(SIGCHLD, SIG_DFL);
+  zygote_stop();
+}
+
+/* Prints the command line usage for SHVM */
+void print_usage(char *name) {
+  printf("Usage: %s [-b [script]] [-s socket] [--recover]\n", name);
+  printf("  -b script   Batch Mode: run the commands in script with no prompts, then exit.\n");
+  printf("              Exits 1 if any process exited non-zero or was refused a launch, else 0.\n");
+  printf("  -b or -b -  Batch Mode reading the commands from stdin (eg. a pipe).\n");
+  printf("  -s socket   Accept control requests on the Unix-domain socket at this path.\n");
+  printf("  --recover   Rebuild the schedule left in %s by an earlier run, adopting live processes.\n", PERSIST_PATH);
 }
 
 /* Set up the main VM environment, then drop to a user shell.
  * Returns 0 on Succesful completion of the program.
  */
-int main() {
-  // Registers functions to be called on Ctrl-C (SIGINT) or Segfault
+int main(int argc, char *argv[]) {
+  FILE *script = NULL; // Non-NULL when running in Batch Mode
+  char *ctl_path = NULL; // Non-NULL when the control socket is enabled
+  int recover = 0; // 1 to rebuild the schedule from the snapshot
+
+  // Check for command line options
+  for(int i = 1; i < argc; i++) {
+    if(strcmp(argv[i], "-b") == 0) {
+      // Batch Mode reads stdin unless given a script file
+      if(i + 1 < argc && strcmp(argv[i + 1], "-") != 0) {
+        script = fopen(argv[++i], "r");
+        if(script == NULL) {
+          fprintf(stderr, "Could not open batch script %s: %s\n", argv[i], strerror(errno));
+          return EXIT_FAILURE;
+        }
+      }
+      else {
+        if(i + 1 < argc) {
+          i++; // Skip the -
+        }
+        script = stdin;
+      }
+    }
+    else if(strcmp(argv[i], "-s") == 0 && i + 1 < argc) {
+      ctl_path = argv[++i];
+    }
+    else if(strcmp(argv[i], "--recover") == 0) {
+      recover = 1;
+    }
+    else {
+      print_usage(argv[0]);
+      return EXIT_FAILURE;
+    }
+  }
+
+  // Fork the launch zygote while shvm is still small and has no threads or handlers of its own
+  zygote_start();
+
+  // Registers a function to be called on Segfault
   register_signal(SIGSEGV, hnd_sigsegv);
-  register_signal(SIGINT, hnd_sigint);
+
+  // Ctrl-C toggles the CS System, but as an event the Dispatcher reads (see vm_cs.c), not in a handler.
+  // Blocked here, before any thread exists, so it stays blocked in all of them.
+  sigset_t mask;
+  sigemptyset(&mask);
+  sigaddset(&mask, SIGINT);
+  pthread_sigmask(SIG_BLOCK, &mask, NULL);
 
   // Print our nice intro banner art!
   // - Art is defined in vm_support.c
-  print_strawHat_banner();
+  if(script == NULL) {
+    print_strawHat_banner();
+  }
+
+  // Start the log writer first, so it is the last thing shut down at exit.
+  log_start();
+  atexit(log_stop);
 
   // Registers a function to be called on exit.  
   atexit(vm_cleanup);
@@ -59,10 +127,35 @@ int main() {
   // Begin Running the Context Switch Threading System
   initialize_cs_system();
 
+  // Mirror the schedule to disk, picking up where an earlier run left off if asked.
+  if(persist_open(PERSIST_PATH, recover) == 0 && recover) {
+    if(cs_recover() == -1) {
+      ABORT_ERROR("Could not recover the schedule snapshot.");
+    }
+  }
+
+  // Remember how long commands take, across runs (see policy sjf)
+  history_open(HISTORY_PATH);
+
+  // Keep each process' output in memory instead of interleaving it on the terminal
+  output_start();
+
   // Set up main VM Environment to handle and track Jobs
   initialize_process_system(); 
+  shell_guard_launches(); // Jobs may be launched from more than one thread
+
+  // Optionally accept requests from other local processes
+  if(ctl_path != NULL) {
+    if(ctl_start(ctl_path) == -1) {
+      ABORT_ERROR("Could not start the control socket.");
+    }
+    atexit(ctl_stop); // Runs before vm_cleanup, so requests are finished first
+  }
 
-  // Enter the user shell
+  // Enter the user shell (or run the batch script)
+  if(script != NULL) {
+    shell_batch(script);
+  }
   shell();
 
   // All exits from this program will call an atexit
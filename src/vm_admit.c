@@ -0,0 +1,223 @@
+/* Standard Library Includes */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+/* Linux System API Includes */
+#include <unistd.h>
+#include <sys/types.h>
+#include <pthread.h>
+/* StrawHat VM Includes */
+#include "vm.h"
+#include "vm_admit.h"
+#include "vm_cs.h"
+#include "vm_pressure.h"
+#include "vm_support.h"
+#include "vm_settings.h"
+
+/* One launch waiting for room */
+typedef struct admit_entry {
+  char line[MAX_CMD_LINE];
+  int next;           // Next in the same class (or on the free list), -1 at the end
+} Admit_entry_s;
+
+/* Waiting launches of one class, oldest first */
+typedef struct admit_list {
+  int head;
+  int tail;
+  int count;
+} Admit_list_s;
+
+/* Admission State
+ * - Launches are already serialized by the shell's Launch Guard, admit_m only keeps the Admission
+ *   Queue and the limits consistent for the threads that show or change them.
+ */
+static pthread_mutex_t admit_m = PTHREAD_MUTEX_INITIALIZER;
+static Admit_entry_s entries[ADMIT_QUEUE_SLOTS];
+static Admit_list_s lists[ADMIT_CLASSES] = { {-1, -1, 0}, {-1, -1, 0}, {-1, -1, 0} };
+static int free_head = 0;
+static int initialized = 0;
+static int limits[ADMIT_CLASSES] = { DEFAULT_ADMIT_CRITICAL, DEFAULT_ADMIT_HIGH, DEFAULT_ADMIT_NORMAL };
+static int refuse = DEFAULT_ADMIT_REFUSE; // 1 refuses launches past the limits instead of queueing them
+static long total_queued = 0;  // Launches that had to wait
+static long total_refused = 0; // Launches refused
+static long total_held = 0;    // Of those, the ones held for memory pressure
+static char *class_names[ADMIT_CLASSES] = { "critical", "high", "normal" };
+
+/* Local Prototypes */
+static void push_entry(int class, const char *line);
+static void pop_entry(int class, char *line, size_t size);
+
+/* Returns the class of a process with these flags */
+int admit_class(int is_critical, int is_high) {
+  return is_critical ? ADMIT_CRITICAL : (is_high ? ADMIT_HIGH : ADMIT_NORMAL);
+}
+
+/* Decides whether a launch may be forked now.  Call under the Launch Guard, so nothing else is
+ *   launched between this and the fork.
+ * - Under memory pressure, with launches held (see vm_pressure.h), only critical ones go now.
+ * Returns ADMIT_NOW, ADMIT_WAITING (its line is now in the Admission Queue) or ADMIT_REFUSED.
+ */
+int admit_check(Process_data_s *proc) {
+  int class = admit_class(proc->is_critical, proc->is_high);
+  pthread_mutex_lock(&admit_m);
+  int limit = limits[class];
+  int ahead = lists[class].count;
+  pthread_mutex_unlock(&admit_m);
+
+  int held = (class != ADMIT_CRITICAL && pressure_holds_admission());
+  int live[ADMIT_CLASSES] = {0};
+  if(limit > 0) {
+    cs_live_by_class(live);
+  }
+  // Never ahead of the ones already waiting in its class
+  if(!held && (limit == 0 || (live[class] < limit && ahead == 0))) {
+    return ADMIT_NOW;
+  }
+
+  pthread_mutex_lock(&admit_m);
+  int result = (refuse || free_head == -1) ? ADMIT_REFUSED : ADMIT_WAITING;
+  if(result == ADMIT_WAITING) {
+    push_entry(class, proc->input_orig);
+    total_queued++;
+  }
+  else {
+    total_refused++;
+  }
+  total_held += held;
+  int waiting = lists[class].count;
+  pthread_mutex_unlock(&admit_m);
+
+  if(held && result == ADMIT_WAITING) {
+    PRINT_STATUS("Process %s is waiting for memory pressure to ease (%d %s processes waiting)",
+        proc->input_orig, waiting, class_names[class]);
+  }
+  else if(held) {
+    PRINT_WARNING("Process %s refused: the host is under memory pressure%s",
+        proc->input_orig, refuse ? "" : ", and the Admission Queue is full");
+  }
+  else if(result == ADMIT_WAITING) {
+    PRINT_STATUS("Process %s is waiting to be admitted (%d %s processes live, at most %d; %d waiting)",
+        proc->input_orig, live[class], class_names[class], limit, waiting);
+  }
+  else {
+    PRINT_WARNING("Process %s refused: %d %s processes live, at most %d%s",
+        proc->input_orig, live[class], class_names[class], limit, refuse ? "" : ", and the Admission Queue is full");
+  }
+  return result;
+}
+
+/* Takes the next waiting launch there's now room for: the highest class first, oldest first.
+ * Returns 1 with its command line in line, or 0 if none can go yet.
+ */
+int admit_next(char *line, size_t size) {
+  if(admit_waiting() == 0) {
+    return 0;
+  }
+  int live[ADMIT_CLASSES] = {0};
+  cs_live_by_class(live);
+  int held = pressure_holds_admission();
+
+  int found = 0;
+  pthread_mutex_lock(&admit_m);
+  for(int class = 0; class < ADMIT_CLASSES && !found; class++) {
+    if(held && class != ADMIT_CRITICAL) {
+      break;
+    }
+    if(lists[class].count > 0 && (limits[class] == 0 || live[class] < limits[class])) {
+      pop_entry(class, line, size);
+      found = 1;
+    }
+  }
+  pthread_mutex_unlock(&admit_m);
+  return found;
+}
+
+/* Returns the number of launches waiting in the Admission Queue */
+int admit_waiting() {
+  pthread_mutex_lock(&admit_m);
+  int waiting = lists[ADMIT_CRITICAL].count + lists[ADMIT_HIGH].count + lists[ADMIT_NORMAL].count;
+  pthread_mutex_unlock(&admit_m);
+  return waiting;
+}
+
+/* Sets the most live processes of a class (0 for no limit) */
+void admit_set_limit(int class, int limit) {
+  if(class < 0 || class >= ADMIT_CLASSES || limit < 0) {
+    return;
+  }
+  pthread_mutex_lock(&admit_m);
+  limits[class] = limit;
+  pthread_mutex_unlock(&admit_m);
+}
+
+/* Sets what happens to launches past the limits: refused (1) or queued until there's room (0) */
+void admit_set_refuse(int on) {
+  pthread_mutex_lock(&admit_m);
+  refuse = on;
+  pthread_mutex_unlock(&admit_m);
+}
+
+/* Gets how many launches have had to wait, and how many were refused */
+void admit_totals(long *queued, long *refused) {
+  pthread_mutex_lock(&admit_m);
+  *queued = total_queued;
+  *refused = total_refused;
+  pthread_mutex_unlock(&admit_m);
+}
+
+/* Prints the limits, what's live and waiting in each class, and how many launches waited or were refused */
+void print_admit() {
+  int live[ADMIT_CLASSES] = {0};
+  cs_live_by_class(live);
+
+  pthread_mutex_lock(&admit_m);
+  PRINT_STATUS("Admission: past the limits, launches %s (%ld have waited, %ld refused; %ld of them for memory pressure)",
+      refuse ? "are refused" : "wait unforked", total_queued, total_refused, total_held);
+  for(int class = 0; class < ADMIT_CLASSES; class++) {
+    char limit[16] = "none";
+    if(limits[class] > 0) {
+      snprintf(limit, sizeof(limit), "%d", limits[class]);
+    }
+    PRINT_STATUS("     %-8s Live: %5d, Limit: %5s, Waiting: %5d", class_names[class], live[class], limit,
+        lists[class].count);
+  }
+  pthread_mutex_unlock(&admit_m);
+}
+
+/* Appends a line to a class' list (admit_m held, and an entry free) */
+static void push_entry(int class, const char *line) {
+  if(!initialized) {
+    for(int i = 0; i < ADMIT_QUEUE_SLOTS; i++) {
+      entries[i].next = (i + 1 < ADMIT_QUEUE_SLOTS) ? i + 1 : -1;
+    }
+    initialized = 1;
+  }
+  int index = free_head;
+  free_head = entries[index].next;
+  snprintf(entries[index].line, sizeof(entries[index].line), "%s", line);
+  entries[index].next = -1;
+
+  Admit_list_s *list = &lists[class];
+  if(list->tail == -1) {
+    list->head = index;
+  }
+  else {
+    entries[list->tail].next = index;
+  }
+  list->tail = index;
+  list->count++;
+}
+
+/* Takes the oldest line off a class' list (admit_m held, and the list not empty) */
+static void pop_entry(int class, char *line, size_t size) {
+  Admit_list_s *list = &lists[class];
+  int index = list->head;
+  list->head = entries[index].next;
+  if(list->head == -1) {
+    list->tail = -1;
+  }
+  list->count--;
+  snprintf(line, size, "%s", entries[index].line);
+  entries[index].next = free_head;
+  free_head = index;
+}
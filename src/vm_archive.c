@@ -0,0 +1,108 @@
+/* Standard Library Includes */
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+/* Linux System API Includes */
+#include <sys/types.h>
+/* StrawHat VM Includes */
+#include "vm_archive.h"
+#include "vm_settings.h"
+
+/* Local Definitions */
+#define ARCHIVE_NIL     0xFFFFFFFFu
+#define ARCHIVE_BUCKETS (ARCHIVE_SLOTS * 2)
+
+/* Archive State
+ * - records is a ring: next is the slot the next record goes in, once count reaches ARCHIVE_SLOTS
+ *   it starts overwriting the oldest.
+ * - Every slot in use is on one pid hash chain (buckets -> hnext), newest first.
+ * - Only touched while the CS System is stopped or from the Dispatcher, so it needs no lock.
+ */
+static Archive_record_s records[ARCHIVE_SLOTS];
+static uint32_t hnext[ARCHIVE_SLOTS];
+static uint32_t buckets[ARCHIVE_BUCKETS];
+static uint32_t next = 0;
+static uint32_t count = 0;
+static long total_archived = 0;
+static long total_failed = 0;
+
+/* Local Prototypes */
+static uint32_t archive_bucket(pid_t pid);
+static void archive_unlink(uint32_t slot);
+
+/* Packs a reaped process into the archive, evicting the oldest record if it's full. */
+void archive_add(pid_t pid, int exit_code, uint32_t born, uint32_t died) {
+  if(count == 0 && next == 0) {
+    for(int i = 0; i < ARCHIVE_BUCKETS; i++) {
+      buckets[i] = ARCHIVE_NIL;
+    }
+  }
+
+  uint32_t slot = next;
+  if(count == ARCHIVE_SLOTS) {
+    archive_unlink(slot); // Overwriting the oldest record
+  }
+  else {
+    count++;
+  }
+  next = (next + 1) % ARCHIVE_SLOTS;
+
+  records[slot].pid = pid;
+  records[slot].born = born;
+  records[slot].died = died;
+  records[slot].exit_code = exit_code & 0xFF;
+
+  uint32_t bucket = archive_bucket(pid);
+  hnext[slot] = buckets[bucket];
+  buckets[bucket] = slot;
+
+  total_archived++;
+  if(exit_code != 0) {
+    total_failed++;
+  }
+}
+
+/* Looks up the most recent record for pid and copies it into record.
+ * Returns 0 if found, or -1 if pid was never archived (or has been overwritten).
+ */
+int archive_find(pid_t pid, Archive_record_s *record) {
+  if(count == 0) {
+    return -1;
+  }
+  for(uint32_t slot = buckets[archive_bucket(pid)]; slot != ARCHIVE_NIL; slot = hnext[slot]) {
+    if(records[slot].pid == pid) {
+      if(record) {
+        *record = records[slot];
+      }
+      return 0;
+    }
+  }
+  return -1;
+}
+
+/* Reports how many processes have ever been archived, and how many of those had non-zero exits. */
+void archive_totals(long *archived, long *failed) {
+  if(archived) {
+    *archived = total_archived;
+  }
+  if(failed) {
+    *failed = total_failed;
+  }
+}
+
+/* Multiplicative hash of a pid into a bucket */
+static uint32_t archive_bucket(pid_t pid) {
+  return ((uint32_t)pid * 2654435761u) % ARCHIVE_BUCKETS;
+}
+
+/* Removes a slot from its hash chain (it's always the last one there, being the oldest) */
+static void archive_unlink(uint32_t slot) {
+  uint32_t *link = &buckets[archive_bucket(records[slot].pid)];
+  while(*link != ARCHIVE_NIL && *link != slot) {
+    link = &hnext[*link];
+  }
+  if(*link == slot) {
+    *link = hnext[slot];
+  }
+}
@@ -0,0 +1,377 @@
+/* Standard Library Includes */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+/* Linux System API Includes */
+#include <signal.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+/* StrawHat VM Includes */
+#include "vm.h"
+#include "vm_cgroup.h"
+#include "vm_support.h"
+#include "vm_settings.h"
+
+/* One process with a cgroup of its own */
+typedef struct cgroup_entry {
+  pid_t pid;
+  int freeze_fd;  // cgroup.freeze, kept open so a switch is a single write
+  int weight_fd;  // cpu.weight, or -1 without the cpu controller
+  int frozen;     // What was last written, so repeats cost nothing
+  int execd;      // 0 until it's known to be past the library's pre-exec stop
+  int weight;
+  int next;       // Next entry in the same hash bucket (or on the free list)
+} Cgroup_entry_s;
+
+static char root[MAX_PATH + 32] = ""; // Our subtree, empty while cgroups aren't in use
+static char parent[MAX_PATH] = "";    // The cgroup the shvm itself is in
+static char self_exe[MAX_PATH] = "";  // What a child runs until it has exec'd
+static Cgroup_entry_s entries[CGROUP_SLOTS];
+static int buckets[CGROUP_SLOTS];  // pid -> entry index
+static int free_head = -1;
+static int live = 0;
+
+/* Local Prototypes */
+static int find_entry(pid_t pid);
+static void remove_cgroup(pid_t pid);
+static int write_file(const char *path, const char *str);
+static int write_fd(int fd, const char *str);
+static int find_hierarchy(char *path, size_t size);
+static int has_execd(pid_t pid);
+
+/* Creates this shvm's subtree, if there's a writable cgroup v2 hierarchy to put it in.
+ * Returns 0 if processes will get cgroups, or -1 if everything falls back to signals.
+ */
+int cgroup_initialize() {
+  for(int i = 0; i < CGROUP_SLOTS; i++) {
+    buckets[i] = -1;
+    entries[i].next = (i + 1 < CGROUP_SLOTS) ? i + 1 : -1;
+  }
+  free_head = 0;
+
+#if USE_CGROUPS
+  char path[MAX_PATH * 2];
+  if(find_hierarchy(parent, sizeof(parent)) == -1) {
+    return -1;
+  }
+  ssize_t len = readlink("/proc/self/exe", self_exe, sizeof(self_exe) - 1);
+  self_exe[len > 0 ? len : 0] = '\0';
+  snprintf(root, sizeof(root), "%s/shvm.%d", parent, getpid());
+  snprintf(path, sizeof(path), "%s/cgroup.freeze", root);
+  if((mkdir(root, 0755) == -1 && errno != EEXIST) || access(path, W_OK) == -1) {
+    rmdir(root);
+    root[0] = '\0'; // No freezer (before Linux 5.2) is no use
+    return -1;
+  }
+
+  // cpu.weight needs the cpu controller enabled all the way down; without it, nice values are used.
+  snprintf(path, sizeof(path), "%s/cgroup.subtree_control", parent);
+  write_file(path, "+cpu");
+  snprintf(path, sizeof(path), "%s/cgroup.subtree_control", root);
+  write_file(path, "+cpu");
+  return 0;
+#else
+  return -1;
+#endif
+}
+
+/* Hands every process left back to the cgroup the shvm started in, and removes the subtree.
+ * - A frozen process is left stopped (SIGTSTP), as it would be without cgroups.
+ */
+void cgroup_cleanup() {
+  if(root[0] == '\0') {
+    return;
+  }
+  for(int bucket = 0; bucket < CGROUP_SLOTS; bucket++) {
+    while(buckets[bucket] != -1) {
+      Cgroup_entry_s *entry = &entries[buckets[bucket]];
+      if(entry->frozen) {
+        kill(entry->pid, SIGTSTP);
+      }
+      cgroup_release(entry->pid);
+    }
+  }
+  rmdir(root);
+  root[0] = '\0';
+}
+
+/* Moves a newly created process into a cgroup of its own, with the given cpu.weight.
+ * - Until it has exec'd, it's still held by signals: create_process stops it (SIGSTOP) and it stops itself
+ *   (SIGTSTP), in either order, so only SIGCONT can be sure to get it through (see cgroup_freeze).
+ * Returns 0 on success or -1 if it stays on signals.
+ */
+int cgroup_adopt(pid_t pid, int weight) {
+  if(root[0] == '\0' || free_head == -1) {
+    return -1;
+  }
+
+  char path[MAX_PATH * 2];
+  char pid_str[16];
+  snprintf(pid_str, sizeof(pid_str), "%d", pid);
+  snprintf(path, sizeof(path), "%s/%d", root, pid);
+  if(mkdir(path, 0755) == -1 && errno != EEXIST) {
+    return -1;
+  }
+  snprintf(path, sizeof(path), "%s/%d/cgroup.procs", root, pid);
+  if(write_file(path, pid_str) == -1) {
+    remove_cgroup(pid);
+    return -1;
+  }
+  snprintf(path, sizeof(path), "%s/%d/cgroup.freeze", root, pid);
+  int freeze_fd = open(path, O_WRONLY | O_CLOEXEC);
+  if(freeze_fd == -1) {
+    remove_cgroup(pid);
+    return -1;
+  }
+
+  int index = free_head;
+  Cgroup_entry_s *entry = &entries[index];
+  free_head = entry->next;
+  snprintf(path, sizeof(path), "%s/%d/cpu.weight", root, pid);
+  *entry = (Cgroup_entry_s){ .pid = pid, .freeze_fd = freeze_fd, .weight_fd = open(path, O_WRONLY | O_CLOEXEC),
+                             .frozen = 0, .execd = 0, .weight = 0, .next = buckets[pid % CGROUP_SLOTS] };
+  buckets[pid % CGROUP_SLOTS] = index;
+  live++;
+  cgroup_set_weight(pid, weight);
+  return 0;
+}
+
+/* Freezes (1) or thaws (0) a process and everything it has forked.
+ * - Before it has exec'd, it's signalled instead.  Whether it has is checked as it's resumed (while
+ *   it's stopped), so it's never left frozen with a stop signal still to come, or stopped but thawed.
+ * Returns 0 on success, or -1 if the caller has to signal it instead.
+ */
+int cgroup_freeze(pid_t pid, int frozen) {
+  int index = find_entry(pid);
+  if(index == -1) {
+    return -1;
+  }
+  Cgroup_entry_s *entry = &entries[index];
+  if(!entry->execd) {
+    entry->execd = !frozen && has_execd(pid); // This SIGCONT is its last
+    return -1;
+  }
+  if(entry->frozen != frozen) {
+    if(write_fd(entry->freeze_fd, frozen ? "1" : "0") == -1) {
+      return -1;
+    }
+    entry->frozen = frozen;
+  }
+  return 0;
+}
+
+/* Sets a process' cpu.weight (1 to 10000, 100 is the kernel's default).
+ * Returns 0 on success, or -1 if there's no cpu controller for it (use nice instead).
+ */
+int cgroup_set_weight(pid_t pid, int weight) {
+  int index = find_entry(pid);
+  if(index == -1 || entries[index].weight_fd == -1) {
+    return -1;
+  }
+  Cgroup_entry_s *entry = &entries[index];
+  if(entry->weight != weight) {
+    char weight_str[16];
+    snprintf(weight_str, sizeof(weight_str), "%d", weight);
+    if(write_fd(entry->weight_fd, weight_str) == -1) {
+      return -1;
+    }
+    entry->weight = weight;
+  }
+  return 0;
+}
+
+/* Returns R if anything in the process' cgroup is running, else the process' own state
+ *   (see proc_run_state), so a job waiting on what it forked isn't taken for blocked.
+ * - Returns 0 if it has no cgroup.
+ */
+char cgroup_run_state(pid_t pid) {
+  if(find_entry(pid) == -1) {
+    return 0;
+  }
+  char path[MAX_PATH * 2];
+  char line[32];
+  char state = proc_run_state(pid);
+  snprintf(path, sizeof(path), "%s/%d/cgroup.procs", root, pid);
+  FILE *fp = fopen(path, "r");
+  if(fp == NULL) {
+    return state;
+  }
+  while(state != 'R' && fgets(line, sizeof(line), fp) != NULL) {
+    pid_t member = atoi(line);
+    if(member != pid && proc_run_state(member) == 'R') {
+      state = 'R';
+    }
+  }
+  fclose(fp);
+  return state;
+}
+
+/* Returns the CPU time (usec) everything in a process' cgroup has used, or -1 without one.
+ * - Still readable after the process has exited, until cgroup_release.
+ */
+long long cgroup_cpu_usec(pid_t pid) {
+  if(find_entry(pid) == -1) {
+    return -1;
+  }
+  char path[MAX_PATH * 2];
+  char line[64];
+  long long usec = -1;
+  snprintf(path, sizeof(path), "%s/%d/cpu.stat", root, pid);
+  FILE *fp = fopen(path, "r");
+  if(fp == NULL) {
+    return -1;
+  }
+  while(usec == -1 && fgets(line, sizeof(line), fp) != NULL) {
+    sscanf(line, "usage_usec %lld", &usec);
+  }
+  fclose(fp);
+  return usec;
+}
+
+/* Removes a finished process' cgroup.  Anything it forked that's still in there is thawed and
+ *   moved back to the shvm's own cgroup.
+ */
+void cgroup_release(pid_t pid) {
+  int index = find_entry(pid);
+  if(index == -1) {
+    return;
+  }
+  Cgroup_entry_s *entry = &entries[index];
+  if(entry->frozen) {
+    write_fd(entry->freeze_fd, "0");
+  }
+  close(entry->freeze_fd);
+  if(entry->weight_fd != -1) {
+    close(entry->weight_fd);
+  }
+  remove_cgroup(pid);
+
+  int *link = &buckets[pid % CGROUP_SLOTS];
+  while(*link != index) {
+    link = &entries[*link].next;
+  }
+  *link = entry->next;
+  entry->next = free_head;
+  free_head = index;
+  live--;
+}
+
+/* Prints how processes are being suspended and resumed */
+void print_cgroup() {
+  if(root[0] == '\0') {
+    PRINT_STATUS("Enforcement: signals (no writable cgroup v2 hierarchy)");
+  }
+  else {
+    PRINT_STATUS("Enforcement: cgroup v2 freezer under %s (%d processes)", root, live);
+  }
+}
+
+/* Returns the entry index for pid, or -1 */
+static int find_entry(pid_t pid) {
+  if(root[0] == '\0') {
+    return -1; // Nobody has a cgroup
+  }
+  int index = buckets[pid % CGROUP_SLOTS];
+  while(index != -1 && entries[index].pid != pid) {
+    index = entries[index].next;
+  }
+  return index;
+}
+
+/* Empties a process' cgroup (back into the shvm's own) and removes it */
+static void remove_cgroup(pid_t pid) {
+  char path[MAX_PATH * 2];
+  snprintf(path, sizeof(path), "%s/%d", root, pid);
+  if(rmdir(path) == 0 || errno != EBUSY) {
+    return;
+  }
+
+  char procs[MAX_PATH * 2];
+  char dest[MAX_PATH * 2];
+  snprintf(procs, sizeof(procs), "%s/%d/cgroup.procs", root, pid);
+  snprintf(dest, sizeof(dest), "%s/cgroup.procs", parent);
+  FILE *fp = fopen(procs, "r");
+  if(fp != NULL) {
+    char line[32];
+    while(fgets(line, sizeof(line), fp) != NULL) {
+      line[strcspn(line, "\n")] = '\0';
+      write_file(dest, line);
+    }
+    fclose(fp);
+  }
+  rmdir(path);
+}
+
+/* Writes str to the file at path.  Returns 0 on success or -1 on any error. */
+static int write_file(const char *path, const char *str) {
+  int fd = open(path, O_WRONLY | O_CLOEXEC);
+  if(fd == -1) {
+    return -1;
+  }
+  int status = write_fd(fd, str);
+  close(fd);
+  return status;
+}
+
+/* Writes str to an open cgroup file.  Returns 0 on success or -1 on any error. */
+static int write_fd(int fd, const char *str) {
+  size_t len = strlen(str);
+  return (write(fd, str, len) == (ssize_t)len) ? 0 : -1;
+}
+
+/* Finds the cgroup the shvm is in on the cgroup v2 hierarchy (from /proc/self/mounts and /proc/self/cgroup).
+ * Returns 0 with its full path in path, or -1 if there's no cgroup v2 hierarchy.
+ */
+static int find_hierarchy(char *path, size_t size) {
+  char mount[MAX_PATH] = "";
+  char dev[MAX_PATH];
+  char dir[MAX_PATH];
+  char type[64];
+  char line[MAX_PATH * 2];
+
+  FILE *fp = fopen("/proc/self/mounts", "r");
+  if(fp == NULL) {
+    return -1;
+  }
+  while(mount[0] == '\0' && fgets(line, sizeof(line), fp) != NULL) {
+    if(sscanf(line, "%511s %511s %63s", dev, dir, type) == 3 && strcmp(type, "cgroup2") == 0) {
+      strcpy(mount, dir);
+    }
+  }
+  fclose(fp);
+  if(mount[0] == '\0') {
+    return -1;
+  }
+
+  // The v2 entry is the one with hierarchy 0 and no controllers: "0::/path"
+  fp = fopen("/proc/self/cgroup", "r");
+  if(fp == NULL) {
+    return -1;
+  }
+  int found = -1;
+  while(found == -1 && fgets(line, sizeof(line), fp) != NULL) {
+    if(strncmp(line, "0::", 3) == 0) {
+      line[strcspn(line, "\n")] = '\0';
+      snprintf(path, size, "%s%s", mount, strcmp(line + 3, "/") == 0 ? "" : line + 3);
+      found = 0;
+    }
+  }
+  fclose(fp);
+  return found;
+}
+
+/* Returns 1 if the process is running a program of its own by now, else 0 */
+static int has_execd(pid_t pid) {
+  char path[64];
+  char exe[MAX_PATH];
+  snprintf(path, sizeof(path), "/proc/%d/exe", pid);
+  ssize_t len = readlink(path, exe, sizeof(exe) - 1);
+  if(len <= 0) {
+    return 0;
+  }
+  exe[len] = '\0';
+  return strcmp(exe, self_exe) != 0;
+}
@@ -0,0 +1,338 @@
+#define _GNU_SOURCE // syscall
+/* Standard Library Includes */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <errno.h>
+#include <time.h>
+/* Linux System API Includes */
+#include <unistd.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <sched.h>
+#include <sys/types.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <linux/futex.h>
+/* StrawHat VM Includes */
+#include "vm.h"
+#include "vm_coop.h"
+#include "vm_support.h"
+#include "vm_settings.h"
+#include "shvm_job.h"
+
+/* One process' control page */
+typedef struct coop_slot {
+  pid_t pid;             // 0 while the slot is free
+  Shvm_page_s *page;
+  uint32_t mark;         // The page's event count as the Dispatcher last saw it
+  int closed;            // 1 once the process is gone, and the slot is freed after the Dispatcher's wait
+} Coop_slot_s;
+
+/* Cooperation State
+ * - coop_m keeps the slots consistent between the Dispatcher, the threads that open and close them,
+ *   and whoever shows them.  The page a wait is on stays mapped until the wait is over.
+ */
+static pthread_mutex_t coop_m = PTHREAD_MUTEX_INITIALIZER;
+static Coop_slot_s slots[COOP_SLOTS];
+static int enabled = DEFAULT_COOP;   // 1 gives new launches a page
+static int waiting = -1;             // Slot the Dispatcher is waiting on
+static int interrupted = 0;          // 1 once coop_interrupt has cut that wait short
+static pid_t waiting_pid = 0;        // The process of that slot, and its page's event word, for coop_exited
+static uint32_t *waiting_event = NULL; // (NULL outside a wait)
+static int exit_users = 0;           // coop_exited calls that may still be using waiting_event
+static size_t page_bytes = 0;
+static long opened = 0;
+static long no_slot = 0;             // Launches left without a page, every slot being in use
+static long yielded = 0;             // Slices given back by a yield
+static long blocked = 0;             // Slices ended by a declared block
+static long long given_back_usec = 0; // What was left of those slices
+
+/* Local Prototypes */
+static Coop_slot_s *find_slot(pid_t pid);
+static void free_slot(Coop_slot_s *slot);
+static void page_name(char *name, size_t size, pid_t pid);
+static long futex(uint32_t *word, int op, uint32_t value, const struct timespec *timeout);
+
+/* Gives a process just launched its control page (call under the schedule lock, before it first runs).
+ * Returns 0 on success, or -1 if it has none (coop off, no slot free, or no shared memory).
+ */
+int coop_open(pid_t pid) {
+  pthread_mutex_lock(&coop_m);
+  Coop_slot_s *slot = enabled ? find_slot(0) : NULL;
+  if(slot == NULL) {
+    no_slot += enabled;
+    pthread_mutex_unlock(&coop_m);
+    return -1;
+  }
+  if(page_bytes == 0) {
+    long size = sysconf(_SC_PAGESIZE);
+    page_bytes = (size > (long)sizeof(Shvm_page_s)) ? (size_t)size : sizeof(Shvm_page_s);
+  }
+  char name[64];
+  page_name(name, sizeof(name), pid);
+  int fd = shm_open(name, O_RDWR | O_CREAT | O_EXCL | O_CLOEXEC, 0600);
+  if(fd == -1 && errno == EEXIST) {
+    shm_unlink(name); // Left by an earlier process with this pid
+    fd = shm_open(name, O_RDWR | O_CREAT | O_EXCL | O_CLOEXEC, 0600);
+  }
+  Shvm_page_s *page = MAP_FAILED;
+  if(fd != -1 && ftruncate(fd, page_bytes) == 0) {
+    page = mmap(NULL, page_bytes, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+  }
+  if(fd != -1) {
+    close(fd);
+  }
+  if(page == MAP_FAILED) {
+    shm_unlink(name);
+    pthread_mutex_unlock(&coop_m);
+    PRINT_DEBUG("PID %d has no control page (%s)", pid, strerror(errno));
+    return -1;
+  }
+  page->version = SHVM_PAGE_VERSION;
+  __atomic_store_n(&page->magic, SHVM_PAGE_MAGIC, __ATOMIC_RELEASE); // Last, so a job never sees half of it
+  slot->pid = pid;
+  slot->page = page;
+  slot->mark = 0;
+  slot->closed = 0;
+  opened++;
+  pthread_mutex_unlock(&coop_m);
+  return 0;
+}
+
+/* Drops the page of a process that has exited.  If the Dispatcher is waiting on it, that wait ends now. */
+void coop_close(pid_t pid) {
+  pthread_mutex_lock(&coop_m);
+  Coop_slot_s *slot = find_slot(pid);
+  if(slot != NULL) {
+    char name[64];
+    page_name(name, sizeof(name), pid);
+    shm_unlink(name);
+    if(waiting == slot - slots) {
+      __atomic_store_n(&slot->closed, 1, __ATOMIC_RELEASE);
+      __atomic_add_fetch(&slot->page->event, 1, __ATOMIC_RELEASE);
+      futex(&slot->page->event, FUTEX_WAKE, 1, NULL);
+    }
+    else {
+      free_slot(slot);
+    }
+  }
+  pthread_mutex_unlock(&coop_m);
+}
+
+/* Tells a process how long the slice it's about to be given is (see shvm_slice_usec) */
+void coop_slice(pid_t pid, long usec) {
+  pthread_mutex_lock(&coop_m);
+  Coop_slot_s *slot = find_slot(pid);
+  if(slot != NULL) {
+    __atomic_store_n(&slot->page->slice_usec, (uint64_t)usec, __ATOMIC_RELEASE);
+  }
+  pthread_mutex_unlock(&coop_m);
+}
+
+/* Gives a process a new slice: one waiting in shvm_yield carries on as soon as it's resumed.
+ * - Call every time it's resumed; whatever it said before doesn't end the slice it's given now.
+ */
+void coop_resume(pid_t pid) {
+  pthread_mutex_lock(&coop_m);
+  Coop_slot_s *slot = find_slot(pid);
+  if(slot != NULL && !slot->closed) {
+    slot->mark = __atomic_load_n(&slot->page->event, __ATOMIC_ACQUIRE);
+    __atomic_add_fetch(&slot->page->slice, 1, __ATOMIC_RELEASE);
+    futex(&slot->page->slice, FUTEX_WAKE, 1, NULL);
+  }
+  pthread_mutex_unlock(&coop_m);
+}
+
+/* Waits up to usec for a process to yield or block (Dispatcher only).
+ * Returns how the wait ended (COOP_*), or -1 if the process doesn't cooperate (the caller times it instead).
+ */
+int coop_wait(pid_t pid, long usec) {
+  pthread_mutex_lock(&coop_m);
+  Coop_slot_s *slot = find_slot(pid);
+  if(slot == NULL || slot->closed || !__atomic_load_n(&slot->page->attached, __ATOMIC_ACQUIRE)) {
+    pthread_mutex_unlock(&coop_m);
+    return -1;
+  }
+  Shvm_page_s *page = slot->page;
+  uint32_t mark = slot->mark;
+  waiting = slot - slots;
+  __atomic_store_n(&interrupted, 0, __ATOMIC_RELEASE);
+  __atomic_store_n(&waiting_pid, pid, __ATOMIC_SEQ_CST);
+  __atomic_store_n(&waiting_event, &page->event, __ATOMIC_SEQ_CST);
+  pthread_mutex_unlock(&coop_m);
+
+  struct timespec now, deadline;
+  clock_gettime(CLOCK_MONOTONIC, &deadline);
+  deadline.tv_sec += usec / 1000000;
+  deadline.tv_nsec += (usec % 1000000) * 1000;
+  if(deadline.tv_nsec >= 1000000000) {
+    deadline.tv_sec++;
+    deadline.tv_nsec -= 1000000000;
+  }
+  int why = COOP_RAN_OUT;
+  long long left = usec;
+  while(left > 0) {
+    struct timespec timeout = { left / 1000000, (left % 1000000) * 1000 };
+    futex(&page->event, FUTEX_WAIT, mark, &timeout);
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    left = (deadline.tv_sec - now.tv_sec) * 1000000LL + (deadline.tv_nsec - now.tv_nsec) / 1000;
+    uint32_t event = __atomic_load_n(&page->event, __ATOMIC_ACQUIRE);
+    if(event == mark) {
+      continue; // Timed out, or woken for nothing
+    }
+    mark = event;
+    if(__atomic_load_n(&interrupted, __ATOMIC_ACQUIRE) || __atomic_load_n(&slot->closed, __ATOMIC_ACQUIRE)) {
+      why = COOP_WOKEN;
+      break;
+    }
+    uint32_t state = __atomic_load_n(&page->state, __ATOMIC_ACQUIRE);
+    if(state == SHVM_JOB_YIELDED || state == SHVM_JOB_BLOCKED) {
+      why = (state == SHVM_JOB_YIELDED) ? COOP_YIELDED : COOP_BLOCKED;
+      break;
+    }
+  }
+
+  // The page may be unmapped below: let a coop_exited that's still using it finish first.
+  __atomic_store_n(&waiting_event, NULL, __ATOMIC_SEQ_CST);
+  while(__atomic_load_n(&exit_users, __ATOMIC_SEQ_CST) > 0) {
+    sched_yield();
+  }
+  pthread_mutex_lock(&coop_m);
+  waiting = -1;
+  if(why == COOP_YIELDED || why == COOP_BLOCKED) {
+    yielded += (why == COOP_YIELDED);
+    blocked += (why == COOP_BLOCKED);
+    given_back_usec += (left > 0) ? left : 0;
+  }
+  if(slot->closed) {
+    free_slot(slot);
+  }
+  else {
+    slot->mark = mark;
+  }
+  pthread_mutex_unlock(&coop_m);
+  return why;
+}
+
+/* Returns what a process last said it's doing (SHVM_JOB_*), or -1 if it doesn't cooperate */
+int coop_state(pid_t pid) {
+  int state = -1;
+  pthread_mutex_lock(&coop_m);
+  Coop_slot_s *slot = find_slot(pid);
+  if(slot != NULL && __atomic_load_n(&slot->page->attached, __ATOMIC_ACQUIRE)) {
+    state = __atomic_load_n(&slot->page->state, __ATOMIC_ACQUIRE);
+  }
+  pthread_mutex_unlock(&coop_m);
+  return state;
+}
+
+/* Ends the Dispatcher's wait on a page now, if it's in one (safe from any thread) */
+void coop_interrupt() {
+  pthread_mutex_lock(&coop_m);
+  if(waiting != -1) {
+    Shvm_page_s *page = slots[waiting].page;
+    __atomic_store_n(&interrupted, 1, __ATOMIC_RELEASE);
+    __atomic_add_fetch(&page->event, 1, __ATOMIC_RELEASE); // So the wake can't be missed
+    futex(&page->event, FUTEX_WAKE, 1, NULL);
+  }
+  pthread_mutex_unlock(&coop_m);
+}
+
+/* Ends the Dispatcher's wait on a page now if it's the page of this process, which has just exited.
+ * - Takes no lock, so it's safe in a signal handler (see cs_otur_terminated); the page itself is
+ *   closed later, by the Dispatcher (see coop_close).
+ */
+void coop_exited(pid_t pid) {
+  __atomic_add_fetch(&exit_users, 1, __ATOMIC_SEQ_CST);
+  uint32_t *event = __atomic_load_n(&waiting_event, __ATOMIC_SEQ_CST);
+  if(event != NULL && __atomic_load_n(&waiting_pid, __ATOMIC_SEQ_CST) == pid) {
+    __atomic_store_n(&interrupted, 1, __ATOMIC_RELEASE);
+    __atomic_add_fetch(event, 1, __ATOMIC_RELEASE); // So the wake can't be missed
+    futex(event, FUTEX_WAKE, 1, NULL);
+  }
+  __atomic_sub_fetch(&exit_users, 1, __ATOMIC_SEQ_CST);
+}
+
+/* Sets whether new launches get a control page (1) or not (0); pages already given out stay */
+void coop_set_enabled(int on) {
+  pthread_mutex_lock(&coop_m);
+  enabled = on;
+  pthread_mutex_unlock(&coop_m);
+}
+
+/* Prints whether processes may cooperate, and what that has saved; with list, every page too */
+void print_coop(int list) {
+  pthread_mutex_lock(&coop_m);
+  int pages = 0, attached = 0;
+  for(int i = 0; i < COOP_SLOTS; i++) {
+    if(slots[i].pid > 0 && !slots[i].closed) {
+      pages++;
+      attached += (__atomic_load_n(&slots[i].page->attached, __ATOMIC_ACQUIRE) != 0);
+    }
+  }
+  PRINT_STATUS("Cooperation: %s (%d pages, %d mapped by their process; %ld given out, %ld launches without one)",
+      enabled ? "on" : "off", pages, attached, opened, no_slot);
+  PRINT_STATUS("     Slices Yielded: %ld, Ended by a Block: %ld, Given Back: %.3f sec",
+      yielded, blocked, given_back_usec / 1000000.0);
+  for(int i = 0; i < COOP_SLOTS && list; i++) {
+    Shvm_page_s *page = slots[i].page;
+    if(slots[i].pid <= 0 || slots[i].closed || !__atomic_load_n(&page->attached, __ATOMIC_ACQUIRE)) {
+      continue;
+    }
+    uint32_t state = __atomic_load_n(&page->state, __ATOMIC_ACQUIRE);
+    PRINT_STATUS("     PID %6d: %-8s Progress: %10llu, Yields: %6llu, Blocks: %6llu", slots[i].pid,
+        state == SHVM_JOB_YIELDED ? "yielded" : (state == SHVM_JOB_BLOCKED ? "blocked" : "running"),
+        (unsigned long long)__atomic_load_n(&page->progress, __ATOMIC_ACQUIRE),
+        (unsigned long long)__atomic_load_n(&page->yields, __ATOMIC_RELAXED),
+        (unsigned long long)__atomic_load_n(&page->blocks, __ATOMIC_RELAXED));
+  }
+  pthread_mutex_unlock(&coop_m);
+}
+
+/* Drops every page (once the Dispatcher is gone), letting any process waiting in shvm_yield carry on */
+void coop_stop() {
+  pthread_mutex_lock(&coop_m);
+  for(int i = 0; i < COOP_SLOTS; i++) {
+    if(slots[i].pid > 0) {
+      char name[64];
+      page_name(name, sizeof(name), slots[i].pid);
+      shm_unlink(name);
+      __atomic_add_fetch(&slots[i].page->slice, 1, __ATOMIC_RELEASE);
+      futex(&slots[i].page->slice, FUTEX_WAKE, 1, NULL);
+      free_slot(&slots[i]);
+    }
+  }
+  waiting = -1;
+  pthread_mutex_unlock(&coop_m);
+}
+
+/* Returns the slot of the process with this pid (0 for a free slot), or NULL (coop_m held) */
+static Coop_slot_s *find_slot(pid_t pid) {
+  for(int i = 0; i < COOP_SLOTS; i++) {
+    if(slots[i].pid == pid && (pid == 0 || !slots[i].closed)) {
+      return &slots[i];
+    }
+  }
+  return NULL;
+}
+
+/* Unmaps a slot's page and frees the slot (coop_m held) */
+static void free_slot(Coop_slot_s *slot) {
+  munmap(slot->page, page_bytes);
+  slot->pid = 0;
+  slot->page = NULL;
+  slot->mark = 0;
+  slot->closed = 0;
+}
+
+/* The shared memory name of a process' page (see SHVM_PAGE_NAME) */
+static void page_name(char *name, size_t size, pid_t pid) {
+  snprintf(name, size, SHVM_PAGE_NAME, (int)getpid(), (int)pid);
+}
+
+/* The futex system call (shared, not private: the words are in pages shared with the processes) */
+static long futex(uint32_t *word, int op, uint32_t value, const struct timespec *timeout) {
+  return syscall(SYS_futex, word, op, value, timeout, NULL, 0);
+}
@@ -1,12 +1,20 @@
+#define _GNU_SOURCE // SCHED_BATCH, SCHED_IDLE, sched_setaffinity
 /* Standard Library Includes */
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
+#include <errno.h>
 /* Linux API Library Includes */
 #include <signal.h>
 #include <unistd.h>
 #include <sys/types.h>
 #include <sys/wait.h>
 #include <sys/time.h>
+#include <sys/epoll.h>
+#include <sys/timerfd.h>
+#include <sys/eventfd.h>
+#include <sys/signalfd.h>
+#include <time.h>
 #include <pthread.h>
 #include <sched.h>
 /* StrawHat Project Includes */
@@ -17,15 +25,71 @@
 #include "vm_printing.h"
 /* Otur Scheduler Library Includes */
 #include "otur_sched.h"
+#include "vm_persist.h"
+#include "vm_archive.h"
+#include "vm_cgroup.h"
+#include "vm_history.h"
+#include "vm_admit.h"
+#include "vm_shell.h"
+#include "vm_zygote.h"
+#include "vm_output.h"
+#include "vm_pressure.h"
+#include "vm_coop.h"
+#include "vm_snapshot.h"
+#include "shvm_job.h"
 
 /* Global Constants */
 enum cs_states { CS_STOP = 0, CS_RUN };
 
 /* Mutex Control Variables */
-pthread_mutex_t cs_cv_m = PTHREAD_MUTEX_INITIALIZER;
 pthread_mutex_t cs_run_m = PTHREAD_MUTEX_INITIALIZER;
 pthread_t pt_cs; // Main CS thread variable (controlled from atexit function)
 
+/* Dispatcher Events
+ * The Dispatcher never sleeps blind: every wait (a quantum, a probe, the delay between quanta, or
+ *   being stopped) is one epoll set, where a timerfd ends the wait, an eventfd wakes it when the CS
+ *   System is started or shut down, and a signalfd delivers Ctrl-C (SIGINT is blocked in every thread)
+ *   and SIGCHLD (blocked on the Dispatcher, see Exits).
+ * - start_cs and stop_cs only flip cs_run and post the eventfd, so no thread ever waits on another
+ *   thread's mutex, and Ctrl-C is handled on the Dispatcher as an ordinary event, not in a handler.
+ */
+enum cs_events { CS_EVENT_TIMER = 0, CS_EVENT_WAKE, CS_EVENT_SIGNAL };
+static int cs_epoll_fd = -1;
+static int cs_timer_fd = -1;
+static int cs_wake_fd = -1;
+static int cs_signal_fd = -1;
+
+/* Exits
+ * The Process System reaps its children in its SIGCHLD handler, and calls cs_otur_terminated from
+ *   there, where only async-signal-safe work may be done.  So that only records the pid and exit code
+ *   here and sends the Dispatcher a SIGCHLD of its own, which its signalfd reads; the Dispatcher then
+ *   finishes the exit (the schedule, history, cgroup and control page) as an ordinary event.
+ * - A SIGCHLD from a child that the signalfd takes first (every thread had it blocked) is handed on to
+ *   the handler (see shell_sigchld), so no child goes unreaped.
+ * - The handler may run on any thread that doesn't block SIGCHLD, so slots are claimed by compare-and-swap.
+ */
+typedef struct exit_record {
+  pid_t pid;
+  int exit_code;
+  int ready; // 1 once pid and exit_code are written
+} Exit_s;
+static Exit_s exits[EXIT_SLOTS];
+static unsigned exits_head = 0;  // Next to be finished (Dispatcher only, under sched_m)
+static unsigned exits_tail = 0;  // Next to be claimed
+static long exits_dropped = 0;   // Exits that found every slot taken
+static int exits_bell = 0;       // 1 while the Dispatcher is there to be sent a SIGCHLD
+
+/* Schedule Lock
+ * The Dispatcher and the shell/control threads all use the schedule (the shell polls it in batch
+ * mode), and stop_cs() only keeps the Dispatcher from starting its next iteration, so every use
+ * holds sched_m.  The SIGCHLD handler never touches the schedule (see Exits), but SIGCHLD is still
+ * blocked while it's held, so the handler can't stretch the time it's held for.
+ * - Every update records the change as it unlocks (see vm_snapshot.h), keeping the counts current
+ *   without copying anything.  A full copy for schedule and the control socket is only made when one
+ *   is asked for and the last is out of date (cs_snapshot), so printing it never holds the lock.
+ */
+static pthread_mutex_t sched_m = PTHREAD_MUTEX_INITIALIZER;
+
 /* Local Global Variables (these are all private to this source file) */
 static Otur_process_s *on_cpu = NULL;
 static Otur_schedule_s *schedule = NULL;
@@ -34,13 +98,96 @@ static int cs_run = CS_STOP; // Controls the running of the CS Thread (initializ
 static useconds_t sleep_usec_time = SLEEP_USEC;
 static useconds_t between_usec_time = BETWEEN_USEC;
 
-/* Run at VM startup to initialize Context Switching (CS) thread */
+/* Auto-Reap Policy: Defunct processes past any non-zero limit are reaped into the Exit Archive */
+static int autoreap_count = DEFAULT_AUTOREAP_COUNT; // Most processes kept in the Defunct Queue
+static long autoreap_age_ms = DEFAULT_AUTOREAP_AGE * 1000L; // Longest a process is kept after it exits
+static long autoreap_bytes = DEFAULT_AUTOREAP_KB * 1024L;  // Most memory the Defunct Queue may hold
+
+/* Adaptive Quantum: each process runs for what it has been learned to need (see otur_learn) */
+static int adaptive_quantum = ADAPTIVE_QUANTUM; // 0 runs every process for sleep_usec_time
+static long long slice_cpu = -1;                // CPU time (usec) of the process on the CPU when its slice began
+static struct timespec slice_start;             // When its slice began
+
+/* Dispatch Engine
+ * Serial (1 slot) stops and continues one process at a time.  Concurrent lets up to engine_slots
+ *   selected processes run at once, each at a kernel priority for its Otur priority, and only stops
+ *   the ones that aren't selected again (see cs_run_concurrent).
+ */
+typedef struct running_process {
+  pid_t pid;
+  int policy; // Kernel scheduling class and nice value last given to it
+  int nice;
+  long long cpu; // CPU time (usec) it had used when this quantum began, -1 if unknown
+} Running_s;
+static int engine_slots = ENGINE_SLOTS;
+static Otur_process_s *also_cpu[ENGINE_MAX_SLOTS]; // Selected along with on_cpu for this quantum
+static int also_count = 0;
+static Running_s running[ENGINE_MAX_SLOTS];        // Left running (not stopped) by the concurrent engine
+static int running_count = 0;
+static long shed_count = 0;       // Processes stopped because they weren't selected again
+static long refused_count = 0;    // Priority changes the kernel refused
+
+/* Job Names (-n name): the latest process launched with each name, for others to run after (-a name) */
+typedef struct job_name {
+  char name[MAX_JOB_NAME];
+  pid_t pid;
+} Job_name_s;
+static Job_name_s job_names[JOB_NAMES];
+static int job_names_next = 0; // Slot the next new name takes (the oldest)
+
+/* Blocked Process Tracking */
+static long blocked_quanta = 0; // Quanta cut short because the process was blocked
+static long unblocked = 0;      // Processes moved from the Wait Queue back to the Ready Queues
+
+/* Local Prototypes */
+static int ready_list(Otur_process_s *node);
+static int cs_is_alive(pid_t pid);
+static pid_t cs_reap_target(pid_t pid);
+static void cs_autoreap();
+static long defunct_bytes(Otur_process_s *node);
+static int cs_unfinished(pid_t pid);
+static char cs_run_state(pid_t pid);
+static int cs_is_blocked(pid_t pid);
+static long cs_quantum(Otur_process_s *node);
+static int cs_level_nice(int level);
+static void cs_dispatch_launch(Otur_process_s *node);
+static void cs_pin(Otur_process_s *node);
+static void cs_slice_begin(pid_t pid);
+static void cs_slice_end(Otur_process_s *node);
+static void cs_block_on_cpu();
+static int cs_wake_waiting();
+static void cs_sample_waiting();
+static void cs_sample_pressure();
+static void cs_run_concurrent(sigset_t *saved);
+static void cs_run_also(Otur_process_s *node, int critical);
+static void cs_select_gang(Otur_process_s *leader);
+static void cs_shed(int keep_selected);
+static void cs_forget_running(pid_t pid);
+static long long cs_cpu_usec(pid_t pid);
+static void cs_charge_running(Otur_process_s *node);
+static int cs_also_index(pid_t pid);
+static void cs_name_job(char *name, pid_t pid);
+static pid_t cs_job_pid(char *job);
+static void cs_cancel_pending();
+static void cs_stop(pid_t pid);
+static void cs_cont(pid_t pid);
+static void sched_lock(sigset_t *saved);
+static void sched_unlock(sigset_t *saved);
+static void sched_unlock_read(sigset_t *saved);
+static void cs_events_open();
+static int cs_wait_event(long usec);
+static int cs_wait_job(pid_t pid, long usec);
+static void cs_read_signals();
+static void cs_finish_exits();
+static void cs_finish_exit(pid_t pid, int exit_code);
+static void cs_wake();
+
+/* Run at VM startup to initialize Context Switching (CS) thread
+ * - Call with SIGINT blocked, from the main thread before any other thread exists (see main).
+ */
 void initialize_cs_system() {
-  // Start the CS Thread Locked by...
-  // 1) Acquiring the lock here on initialization
-  // 2) Each iteration of the CS thread starts by acquiring the lock.
-  // The Shell commands release/acquire the lock to control CS
-  pthread_mutex_lock(&cs_cv_m);
+  // The CS thread starts stopped, waiting on its events until start_cs().
+  cs_events_open();
 
   // Create the runner thread for the CS system
   int ret = pthread_create(&pt_cs, NULL, &cs_thread, NULL);
@@ -53,21 +200,34 @@ void initialize_cs_system() {
   if(schedule == NULL) {
     ABORT_ERROR("Error reported by otur_initialize.");
   }
+
+  // Processes get cgroups of their own where the system allows it, else they're signalled.
+  cgroup_initialize();
 }
 
 /* Free all CS related memory.  Registered with atexit */
 void cs_cleanup() {
   PRINT_STATUS("... Beginning CS Shutdown");
 
-  PRINT_STATUS("... Deallocating Scheduler with otur_cleanup(schedule)");
-  otur_cleanup(schedule);
-
   PRINT_STATUS("... Shutting Down CS System and Dispatcher");
   cs_do_cs = CS_STOP; // Tell the thread to die.
-  pthread_mutex_unlock(&cs_cv_m); // If the CS is not running, activate it so it can die.
+  __atomic_store_n(&exits_bell, 0, __ATOMIC_SEQ_CST); // Exits from here on are left unfinished
+  cs_wake(); // Whatever it's waiting on, it stops waiting.
 
   PRINT_STATUS("... Waiting for CS System and Dispatcher to Complete");
   pthread_join(pt_cs, NULL);
+  log_flush(); // Everything the Dispatcher said goes out before the rest of the shutdown
+
+  PRINT_STATUS("... Releasing the Control Pages of Cooperating Processes");
+  coop_stop();
+
+  // The Dispatcher is gone, so nothing else can touch the schedule now.
+  PRINT_STATUS("... Deallocating Scheduler with otur_cleanup(schedule)");
+  snapshot_free();
+  otur_cleanup(schedule);
+
+  PRINT_STATUS("... Handing Processes back from their cgroups");
+  cgroup_cleanup();
 
   PRINT_STATUS("... Removing Process from CPU");
   free(on_cpu);
@@ -81,24 +241,53 @@ void *cs_thread(void *args) {
   int iteration = 1;
   pid_t last_run_cpu = -1;
 
-// 1) While not blocked... (lock cs_cv_m to block)
+  // SIGCHLD stays blocked here, for the signalfd to read: the handler runs on other threads, and
+  // sends this one a SIGCHLD of its own for every exit it records (see Exits).
+  sigset_t mask;
+  sigemptyset(&mask);
+  sigaddset(&mask, SIGCHLD);
+  pthread_sigmask(SIG_BLOCK, &mask, NULL);
+  __atomic_store_n(&exits_bell, 1, __ATOMIC_SEQ_CST);
+
+  // Status messages from the dispatch loop are queued, so terminal I/O can't stretch a quantum.
+  log_thread_async();
+
+// 1) While not stopped... (waits on its events until started)
 // .. a) Gets the next process to run from the Scheduler (select)
 // .. .. Holds this in the on_cpu global
 // .. b) Resumes the selected process
-// .. c) Sleeps for sleep_usec_time microseconds
+// .. c) Waits out its quantum (sleep_usec_time, what it has been learned to need, or what it asked for)
+// .. .. After BLOCK_PROBE_USEC, a blocked process is moved to the Wait Queue instead
 // .. d) Suspends the selected process
 // .. e) Returns the process to the Scheduler (insert)
   while(cs_do_cs == CS_RUN) {
     long delay = sleep_usec_time;
-    pthread_mutex_lock(&cs_cv_m);  // mylock.acquire()  -- Turnstile Pattern
-    pthread_mutex_unlock(&cs_cv_m);// mylock.release()
+    sigset_t saved;
+    if(!cs_is_running()) {
+      // Stopped: nothing left running by the concurrent engine may keep running meanwhile.
+      if(running_count > 0) {
+        sched_lock(&saved);
+        cs_shed(0);
+        sched_unlock(&saved);
+      }
+      while(!cs_is_running() && cs_do_cs == CS_RUN) {
+        cs_wait_event(-1);
+      }
+    }
 
-    // Check to see if the system is being shutdown while waiting on lock.
+    // Check to see if the system is being shutdown while waiting to start.
     if(cs_do_cs == CS_STOP) {
       continue; 
     }
 
+    // Launches held back by admission control go as soon as there's room for them.
+    if(admit_waiting() > 0) {
+      shell_admit_waiting();
+    }
+
     PRINT_DEBUG("Context Switch: Iteration %d", iteration++);
+    sched_lock(&saved); // Released only while the quantum runs
+    cs_sample_pressure();
 
     // Call the Scheduler to get the next Process
     on_cpu = otur_select(schedule);
@@ -111,26 +300,64 @@ void *cs_thread(void *args) {
 
     // Only Dispatch if something was selected
     if(on_cpu != NULL) {
-      if(process_find(on_cpu->pid) == 0) {
-        if(otur_exited(schedule, on_cpu, 42) == -1) {
+      persist_track(on_cpu, PERSIST_CPU);
+      if(!cs_is_alive(on_cpu->pid)) {
+        // Adopted processes finish without a SIGCHLD, so this is where we find out.
+        if(otur_exited(schedule, on_cpu, persist_adopted(on_cpu->pid) ? PERSIST_LOST_EXIT : 42) == -1) {
           ABORT_ERROR("Error reported by otur_exited.");
         }
+        persist_track(on_cpu, PERSIST_DEFUNCT);
         on_cpu = NULL;
         last_run_cpu = 0; // Nothing on the CPU for this iteration
       }
+      else if(engine_slots > 1 || otur_gang(on_cpu) != OTUR_STR_NIL) {
+        // A gang always runs all at once, even on the serial engine.
+        last_run_cpu = on_cpu->pid;
+        cs_run_concurrent(&saved);
+      }
       else {
+        cs_shed(0); // Left over from the concurrent engine
         if(last_run_cpu != on_cpu->pid) {
-          PRINT_STATUS("Switching to run PID: %d (%s)", on_cpu->pid, on_cpu->cmd);
+          PRINT_STATUS("Switching to run PID: %d (%s)", on_cpu->pid, otur_cmd(on_cpu));
         }
         last_run_cpu = on_cpu->pid;
-        kill(on_cpu->pid, SIGCONT);
-        usleep(delay);
+        delay = cs_quantum(on_cpu);
+        pid_t pid = on_cpu->pid;
+        cs_slice_begin(pid);
+        cs_dispatch_launch(on_cpu);
+        coop_slice(pid, delay);
+        cs_cont(pid);
+        // Give it (and everything waiting) a moment to show whether it can actually run.
+        cs_wake_waiting();
+        sched_unlock(&saved);
+        int said = cs_wait_job(pid, BLOCK_PROBE_USEC);
+        sched_lock(&saved);
+        cs_sample_waiting();
+        // One that went straight back to sleep would only waste the rest of its quantum.
+        if(on_cpu && cs_is_blocked(on_cpu->pid)) {
+          cs_block_on_cpu();
+        }
+        // A cooperating process may give the rest back, by yielding or blocking.
+        if(on_cpu && said != COOP_YIELDED) {
+          sched_unlock(&saved);
+          said = cs_wait_job(pid, delay - BLOCK_PROBE_USEC);
+          sched_lock(&saved);
+          if(on_cpu && said == COOP_BLOCKED) {
+            cs_block_on_cpu();
+          }
+        }
+        // An adopted process that finished during its quantum goes straight to Defunct.
+        if(on_cpu && persist_adopted(on_cpu->pid) && !persist_alive(on_cpu->pid)) {
+          cs_exiting_process(PERSIST_LOST_EXIT);
+        }
         // It's run for the quantum, suspend it and return it to the queue.
         if(on_cpu) {
-          kill(on_cpu->pid, SIGTSTP);
+          cs_stop(on_cpu->pid);
+          cs_slice_end(on_cpu);
           if(otur_enqueue(schedule, on_cpu) == -1) {
             ABORT_ERROR("Error reported by otur_enqueue.");
           }
+          persist_track(on_cpu, ready_list(on_cpu));
           on_cpu = NULL;
         }
       }
@@ -142,19 +369,42 @@ void *cs_thread(void *args) {
         print_empty_cs();
       }
       last_run_cpu = 0; // Nothing on the CPU for this iteration
-      usleep(delay);
+      cs_shed(0);
+      if(cs_wake_waiting() > 0) {
+        sched_unlock(&saved);
+        cs_wait_event(BLOCK_PROBE_USEC);
+        sched_lock(&saved);
+        cs_sample_waiting();
+        delay -= BLOCK_PROBE_USEC;
+      }
+      sched_unlock(&saved);
+      cs_wait_event(delay);
+      sched_lock(&saved);
     }
+    cs_cancel_pending();
+    cs_autoreap();
 #if DO_MLFQ
     // Promote the Processes
+    // Promoted processes are appended to the High Queue, so only those past its old tail moved.
+    Otur_process_s *high_tail = otur_last(schedule->ready_queue_high);
     if(otur_promote(schedule) == -1) {
       ABORT_ERROR("Error reported by otur_promote.");
     }
+    for(Otur_process_s *walker = high_tail ? otur_next(high_tail) : otur_first(schedule->ready_queue_high);
+        walker != NULL; walker = otur_next(walker)) {
+      persist_track(walker, PERSIST_HIGH);
+    }
 
 #endif
+    sched_unlock(&saved);
     // Delay after the run quantum, but before we pick a new one (to help with debugging)
-    usleep(between_usec_time);
+    cs_wait_event(between_usec_time);
   }
   // CS System has ended the main loop, we can now properly exit the thread.
+  sigset_t saved;
+  sched_lock(&saved);
+  cs_shed(0);
+  sched_unlock(&saved);
   pthread_exit(0);
 }
 
@@ -221,8 +471,22 @@ void cs_reap(pid_t pid) {
   stop_cs(); // Critical!  This ensures that all processes have been returned to Scheduler first
 
   PRINT_DEBUG("Reaping Process Now");
+  sigset_t saved;
+  sched_lock(&saved);
+  pid_t target = cs_reap_target(pid);
   int ec = otur_reap(schedule, pid);
-  if(ec == -1) {
+  Archive_record_s record;
+  int archived = (ec == -1 && pid != 0 && archive_find(pid, &record) == 0);
+  if(ec != -1) {
+    persist_forget(target);
+  }
+  sched_unlock(&saved);
+
+  if(archived) {
+    PRINT_STATUS("Process was already Auto-Reaped (ran %u.%03u sec).  Exit Code was %d",
+        (record.died - record.born) / 1000, (record.died - record.born) % 1000, record.exit_code);
+  }
+  else if(ec == -1) {
     PRINT_WARNING("[No Such Process to Reap]");
   }
   else {
@@ -233,6 +497,824 @@ void cs_reap(pid_t pid) {
   }
 }
 
+/* Direct the Scheduler to reap a defunct process without printing anything.
+ * Returns the exit code, or -1 if there was no such process.
+ */
+int cs_reap_code(pid_t pid) {
+  int last_state = -1;
+
+  pthread_mutex_lock(&cs_run_m);
+  last_state = cs_run;
+  pthread_mutex_unlock(&cs_run_m);
+
+  stop_cs(); // Critical!  This ensures that all processes have been returned to Scheduler first
+
+  sigset_t saved;
+  sched_lock(&saved);
+  pid_t target = cs_reap_target(pid);
+  int ec = otur_reap(schedule, pid);
+  Archive_record_s record;
+  if(ec != -1) {
+    persist_forget(target);
+  }
+  else if(pid != 0 && archive_find(pid, &record) == 0) {
+    ec = record.exit_code; // Already auto-reaped, but it still has an answer
+  }
+  sched_unlock(&saved);
+
+  if(last_state == CS_RUN) {
+    start_cs();
+  }
+  return ec;
+}
+
+/* Blocks the caller until the process with the given pid has finished.
+ * - A pid of 0 waits until no processes are left on the CPU or in the Ready or Wait Queues.
+ */
+void cs_wait(pid_t pid) {
+  if(pid == 0) {
+    while(cs_live_count() > 0) {
+      usleep(WAIT_POLL_USEC);
+    }
+  }
+  else {
+    while(cs_unfinished(pid)) {
+      usleep(WAIT_POLL_USEC);
+    }
+  }
+}
+
+/* Rebuilds the Schedule from the snapshot left by an earlier shvm (see vm_persist.h)
+ * - Call before the CS System is started.
+ * Returns the number of processes adopted, or -1 on any error.
+ */
+int cs_recover() {
+  sigset_t saved;
+  sched_lock(&saved);
+  int adopted = persist_recover(schedule);
+  print_otur_debug(schedule, get_on_cpu());
+  sched_unlock(&saved);
+  return adopted;
+}
+
+/* Sets one Auto-Reap limit (AUTOREAP_OFF clears them all), then applies the policy right away.
+ * - value is a count of processes, seconds, or KB, by limit.  0 turns that limit off.
+ */
+void cs_set_autoreap(int limit, long value) {
+  int last_state = -1;
+
+  pthread_mutex_lock(&cs_run_m);
+  last_state = cs_run;
+  pthread_mutex_unlock(&cs_run_m);
+
+  stop_cs(); // Critical!  The Dispatcher applies the policy too.
+
+  sigset_t saved;
+  sched_lock(&saved);
+  switch(limit) {
+    case AUTOREAP_OFF:   autoreap_count = 0; autoreap_age_ms = 0; autoreap_bytes = 0; break;
+    case AUTOREAP_COUNT: autoreap_count = value;          break;
+    case AUTOREAP_AGE:   autoreap_age_ms = value * 1000;  break;
+    case AUTOREAP_MEM:   autoreap_bytes = value * 1024;   break;
+  }
+  cs_autoreap();
+  sched_unlock(&saved);
+  print_autoreap();
+
+  if(last_state == CS_RUN) {
+    start_cs();
+  }
+}
+
+/* Prints the Auto-Reap limits and what the Exit Archive holds */
+void print_autoreap() {
+  long archived = 0;
+  long failed = 0;
+  archive_totals(&archived, &failed);
+
+  if(autoreap_count == 0 && autoreap_age_ms == 0 && autoreap_bytes == 0) {
+    PRINT_STATUS("Auto-Reap: off");
+  }
+  else {
+    PRINT_STATUS("Auto-Reap: count %d, age %ld sec, mem %ld KB (0 is no limit)",
+        autoreap_count, autoreap_age_ms / 1000, autoreap_bytes / 1024);
+  }
+  PRINT_STATUS("Exit Archive: %ld Processes Auto-Reaped (%ld non-zero exit), last %d kept",
+      archived, failed, ARCHIVE_SLOTS);
+}
+
+/* Reaps Defunct processes, oldest first, into the Exit Archive until the queue is within every limit.
+ * - The Defunct Queue is in the order processes exited, so only its head ever needs checking for age.
+ * - Call with the schedule locked.
+ */
+static void cs_autoreap() {
+  if(autoreap_count == 0 && autoreap_age_ms == 0 && autoreap_bytes == 0) {
+    return;
+  }
+  Otur_queue_s *defunct = schedule->defunct_queue;
+  uint32_t now = otur_table_now();
+
+  // Memory is only added up when it's limited
+  long bytes = 0;
+  if(autoreap_bytes) {
+    for(Otur_process_s *walker = otur_first(defunct); walker != NULL; walker = otur_next(walker)) {
+      bytes += defunct_bytes(walker);
+    }
+  }
+
+  Otur_process_s *head = NULL;
+  while((head = otur_first(defunct)) != NULL) {
+    if(!(autoreap_count && otur_count(defunct) > autoreap_count) &&
+       !(autoreap_age_ms && now - otur_died(head) >= autoreap_age_ms) &&
+       !(autoreap_bytes && bytes > autoreap_bytes)) {
+      break;
+    }
+    pid_t pid = head->pid;
+    bytes -= defunct_bytes(head);
+    archive_add(pid, otur_state(head) & OTUR_EXIT_MASK, otur_born(head), otur_died(head));
+    if(otur_reap(schedule, 0) == -1) {
+      ABORT_ERROR("Error reported by otur_reap.");
+    }
+    persist_forget(pid);
+    PRINT_DEBUG("Auto-Reaped PID %d", pid);
+  }
+}
+
+/* Returns the run state of a process (see proc_run_state), or of the job in its cgroup if it has one */
+static char cs_run_state(pid_t pid) {
+  char state = cgroup_run_state(pid);
+  return state ? state : proc_run_state(pid);
+}
+
+/* Returns 1 if the process is blocked (sleeping, or waiting on I/O), else 0.
+ * - A cooperating process is blocked from shvm_block until shvm_unblock, and never while it's yielded.
+ */
+static int cs_is_blocked(pid_t pid) {
+  int said = coop_state(pid);
+  if(said == SHVM_JOB_BLOCKED || said == SHVM_JOB_YIELDED) {
+    return (said == SHVM_JOB_BLOCKED);
+  }
+  char state = cs_run_state(pid);
+  return (state == 'S' || state == 'D');
+}
+
+/* Suspends the process on the CPU, which turned out to be blocked, and parks it in the Wait Queue. */
+static void cs_block_on_cpu() {
+  cs_stop(on_cpu->pid);
+  cs_slice_end(on_cpu);
+  if(otur_block(schedule, on_cpu) == -1) {
+    ABORT_ERROR("Error reported by otur_block.");
+  }
+  persist_track(on_cpu, ready_list(on_cpu)); // The snapshot recovers it as ready
+  PRINT_DEBUG("PID %d is blocked, moved to the Wait Queue", on_cpu->pid);
+  blocked_quanta++;
+  on_cpu = NULL;
+}
+
+/* Returns the nice value for a priority level (-p), LEVEL_NICE_SPAN either side of DEFAULT_PRIORITY. */
+static int cs_level_nice(int level) {
+  int span = (level < DEFAULT_PRIORITY) ? DEFAULT_PRIORITY - MIN_PRIORITY : MAX_PRIORITY - DEFAULT_PRIORITY;
+  int nice = (level - DEFAULT_PRIORITY) * LEVEL_NICE_SPAN / span;
+  return nice > 19 ? 19 : nice;
+}
+
+/* Applies what a process asked for at launch (-p level, -cpu list) as the serial engine dispatches it:
+ * - A level sets its nice value (see cs_level_nice); a pinned process is kept to its CPUs.
+ * - Both are set again every dispatch, so a process can't keep a change it made itself meanwhile.
+ * - Kernel refusals (eg. raising priority without CAP_SYS_NICE, or no online CPU in the set) are counted.
+ */
+static void cs_dispatch_launch(Otur_process_s *node) {
+  if(otur_level(node) != 0 && proc_set_sched(node->pid, SCHED_OTHER, cs_level_nice(otur_level(node))) == -1) {
+    refused_count++;
+  }
+  cs_pin(node);
+}
+
+/* Keeps a pinned process (-cpu list) to its CPUs; a refusal is counted. */
+static void cs_pin(Otur_process_s *node) {
+  if(!(otur_state(node) & OTUR_PINNED)) {
+    return;
+  }
+  cpu_set_t set;
+  CPU_ZERO(&set);
+  for(int cpu = 0; cpu < MAX_PIN_CPUS; cpu++) {
+    if(otur_cpus(node) & (1ULL << cpu)) {
+      CPU_SET(cpu, &set);
+    }
+  }
+  if(sched_setaffinity(node->pid, sizeof(set), &set) == -1) {
+    refused_count++;
+  }
+}
+
+/* Returns how long (usec) the given process should run for this slice. */
+static long cs_quantum(Otur_process_s *node) {
+  if(otur_fixed_quantum(node) != 0) {
+    return otur_fixed_quantum(node); // Asked for at launch (-q)
+  }
+  if(!adaptive_quantum || otur_quantum(node) == 0) {
+    return sleep_usec_time;
+  }
+  return otur_quantum(node);
+}
+
+/* Records where a process' CPU time stands as its slice begins. */
+static void cs_slice_begin(pid_t pid) {
+  slice_cpu = proc_cpu_usec(pid);
+  clock_gettime(CLOCK_MONOTONIC, &slice_start);
+}
+
+/* Tells the Scheduler how much of its slice a (now suspended) process actually used. */
+static void cs_slice_end(Otur_process_s *node) {
+  long long cpu = proc_cpu_usec(node->pid);
+  if(slice_cpu < 0 || cpu < slice_cpu) {
+    return; // Couldn't be measured
+  }
+  struct timespec now;
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  long long wall = (now.tv_sec - slice_start.tv_sec) * 1000000LL + (now.tv_nsec - slice_start.tv_nsec) / 1000;
+
+  // Quanta may grow to 4x the runtime setting, so `runtime` still scales the whole system.
+  long max_quantum = (long)sleep_usec_time * 4 < SLEEP_MAX_USEC ? (long)sleep_usec_time * 4 : SLEEP_MAX_USEC;
+  if(otur_learn(node, cpu - slice_cpu, wall > 0 ? wall : 1, SLEEP_MIN_USEC, max_quantum) == -1) {
+    ABORT_ERROR("Error reported by otur_learn.");
+  }
+  otur_charge(node, cpu - slice_cpu); // and its tenant pays for it
+  slice_cpu = -1;
+}
+
+/* Turns the Adaptive Quantum on (1) or off (0) */
+void set_adaptive_quantum(int on) {
+  adaptive_quantum = on;
+  PRINT_STATUS("Quantum: %s", adaptive_quantum ? "adaptive (learned per process)" : "fixed (runtime)");
+}
+
+/* Runs one quantum of the concurrent engine: on_cpu (already selected) and up to engine_slots - 1 more.
+ * - Every selected process brings the ready members of its gang along (see cs_select_gang), even past
+ *   the slots; the serial engine runs a gang through here too.
+ * - Processes still running from the last quantum and selected again are simply left running;
+ *   only the ones that weren't are stopped, so SIGTSTP is only spent shedding load beyond the slots.
+ * - Within the slots, the kernel shares the CPUs out by the class and nice value cs_run_also gives each.
+ * - Call with the schedule locked (released only while the quantum runs).
+ */
+static void cs_run_concurrent(sigset_t *saved) {
+  Otur_process_s *node = NULL;
+  slice_cpu = -1; // Quanta aren't learned here: a process' slice is shared with the rest
+  persist_track(on_cpu, PERSIST_CPU);
+
+  // Each slot is held against its tenant as it is taken, so the next slot goes to whoever is most under-served.
+  // What each process actually used is only charged once it's measured (see cs_charge_running).
+  // Under memory pressure, at most one large process runs at a time.
+  also_count = 0;
+  otur_tenant_hold(otur_tenant_of(on_cpu), sleep_usec_time);
+  cs_select_gang(on_cpu);
+  schedule->defer_hold = (schedule->defer_kb && otur_rss(on_cpu) >= schedule->defer_kb);
+  while(also_count < engine_slots - 1 && (node = otur_select(schedule)) != NULL) {
+    persist_track(node, PERSIST_CPU);
+    if(cs_is_alive(node->pid)) {
+      also_cpu[also_count++] = node;
+      otur_tenant_hold(otur_tenant_of(node), sleep_usec_time);
+      cs_select_gang(node);
+      schedule->defer_hold |= (schedule->defer_kb && otur_rss(node) >= schedule->defer_kb);
+    }
+    else {
+      if(otur_exited(schedule, node, persist_adopted(node->pid) ? PERSIST_LOST_EXIT : 42) == -1) {
+        ABORT_ERROR("Error reported by otur_exited.");
+      }
+      persist_track(node, PERSIST_DEFUNCT);
+    }
+  }
+
+  schedule->defer_hold = 0;
+  otur_tenant_release();
+
+  // Stop the ones that weren't selected again, then start (or just re-prioritize) the selection.
+  cs_shed(1);
+  int critical = (otur_state(on_cpu) & OTUR_CRITICAL) != 0;
+  for(int i = 0; i < also_count; i++) {
+    critical |= (otur_state(also_cpu[i]) & OTUR_CRITICAL) != 0;
+  }
+  cs_run_also(on_cpu, critical);
+  for(int i = 0; i < also_count; i++) {
+    cs_run_also(also_cpu[i], critical);
+  }
+
+  // Give them (and everything waiting) a moment to show whether they can actually run.
+  cs_wake_waiting();
+  sched_unlock(saved);
+  cs_wait_event(BLOCK_PROBE_USEC);
+  sched_lock(saved);
+  cs_sample_waiting();
+  if(on_cpu && cs_is_blocked(on_cpu->pid)) {
+    cs_charge_running(on_cpu);
+    cs_forget_running(on_cpu->pid);
+    cs_block_on_cpu();
+  }
+  for(int i = also_count - 1; i >= 0; i--) {
+    if(cs_is_blocked(also_cpu[i]->pid)) {
+      node = also_cpu[i];
+      also_cpu[i] = also_cpu[--also_count];
+      cs_stop(node->pid);
+      cs_charge_running(node);
+      cs_forget_running(node->pid);
+      if(otur_block(schedule, node) == -1) {
+        ABORT_ERROR("Error reported by otur_block.");
+      }
+      persist_track(node, ready_list(node));
+      blocked_quanta++;
+    }
+  }
+
+  sched_unlock(saved);
+  cs_wait_event(sleep_usec_time - BLOCK_PROBE_USEC);
+  sched_lock(saved);
+
+  // An adopted process that finished during the quantum goes straight to Defunct.
+  if(on_cpu && persist_adopted(on_cpu->pid) && !persist_alive(on_cpu->pid)) {
+    cs_forget_running(on_cpu->pid);
+    cs_exiting_process(PERSIST_LOST_EXIT);
+  }
+  // Everything else goes back to the Scheduler still running, to be selected again or shed.
+  if(on_cpu) {
+    also_cpu[also_count++] = on_cpu;
+    on_cpu = NULL;
+  }
+  for(int i = 0; i < also_count; i++) {
+    node = also_cpu[i];
+    cs_charge_running(node);
+    if(persist_adopted(node->pid) && !persist_alive(node->pid)) {
+      cs_forget_running(node->pid);
+      if(otur_exited(schedule, node, PERSIST_LOST_EXIT) == -1) {
+        ABORT_ERROR("Error reported by otur_exited.");
+      }
+      persist_track(node, PERSIST_DEFUNCT);
+      continue;
+    }
+    if(otur_enqueue(schedule, node) == -1) {
+      ABORT_ERROR("Error reported by otur_enqueue.");
+    }
+    persist_track(node, ready_list(node));
+  }
+  also_count = 0;
+}
+
+/* Adds the ready members of the leader's gang to also_cpu (as many as fit), so they run together. */
+static void cs_select_gang(Otur_process_s *leader) {
+  int count = otur_select_gang(schedule, leader, also_cpu + also_count, ENGINE_MAX_SLOTS - 1 - also_count);
+  if(count == -1) {
+    ABORT_ERROR("Error reported by otur_select_gang.");
+  }
+  if(count > 0) {
+    PRINT_DEBUG("Gang %s: PID %d runs with %d more", otur_gang_name(leader), leader->pid, count);
+  }
+  for(int i = 0; i < count; i++) {
+    Otur_process_s *node = also_cpu[also_count];
+    persist_track(node, PERSIST_CPU);
+    if(cs_is_alive(node->pid)) {
+      otur_tenant_hold(otur_tenant_of(node), sleep_usec_time);
+      also_count++;
+      continue;
+    }
+    // Adopted processes finish without a SIGCHLD, so this is where we find out.
+    memmove(&also_cpu[also_count], &also_cpu[also_count + 1], (count - i - 1) * sizeof(Otur_process_s *));
+    if(otur_exited(schedule, node, persist_adopted(node->pid) ? PERSIST_LOST_EXIT : 42) == -1) {
+      ABORT_ERROR("Error reported by otur_exited.");
+    }
+    persist_track(node, PERSIST_DEFUNCT);
+  }
+}
+
+/* Lets a selected process run under the concurrent engine, with the kernel priority for its Otur priority:
+ * - Critical runs at NICE_CRITICAL, High (including Normal ones promoted by aging) at NICE_HIGH.
+ * - Normal runs as SCHED_BATCH at NICE_NORMAL, or SCHED_IDLE while a critical process is running.
+ * - A process with a cgroup gets the matching cpu.weight (WEIGHT_*) instead, which covers what it forks.
+ * - One launched with a priority level (-p) runs at the nice value for its level instead, cgroup or not,
+ *   and a pinned one (-cpu) is kept to its CPUs as it starts.  A quantum (-q) isn't honoured here:
+ *   the quantum (runtime) is shared by everything selected, so -q only applies to the serial engine.
+ * - Kernel refusals (eg. raising priority back up without CAP_SYS_NICE) are counted and otherwise ignored.
+ */
+static void cs_run_also(Otur_process_s *node, int critical) {
+  int policy = SCHED_OTHER;
+  int nice = NICE_CRITICAL;
+  int weight = WEIGHT_CRITICAL;
+  if(otur_state(node) & OTUR_CRITICAL) {
+    nice = NICE_CRITICAL;
+  }
+  else if(otur_state(node) & OTUR_HIGH) {
+    nice = NICE_HIGH;
+    weight = WEIGHT_HIGH;
+  }
+  else {
+    policy = critical ? SCHED_IDLE : SCHED_BATCH;
+    nice = NICE_NORMAL;
+    weight = critical ? WEIGHT_IDLE : WEIGHT_NORMAL;
+  }
+  int level = otur_level(node);
+  if(level != 0) {
+    policy = SCHED_OTHER;
+    nice = cs_level_nice(level);
+  }
+
+  int i = 0;
+  while(i < running_count && running[i].pid != node->pid) {
+    i++;
+  }
+  int stopped = (i == running_count);
+  if(stopped) {
+    running[running_count++] = (Running_s){ .pid = node->pid, .policy = -1, .nice = 0 };
+    cs_pin(node);
+  }
+  running[i].cpu = cs_cpu_usec(node->pid); // Its quantum starts now, whether it was stopped or not
+  if(running[i].policy != policy || running[i].nice != nice) {
+    if((level != 0 || cgroup_set_weight(node->pid, weight) == -1) && proc_set_sched(node->pid, policy, nice) == -1) {
+      refused_count++;
+    }
+    running[i].policy = policy;
+    running[i].nice = nice;
+  }
+  coop_slice(node->pid, sleep_usec_time);
+  if(stopped) {
+    PRINT_STATUS("Switching to run PID: %d (%s)", node->pid, otur_cmd(node));
+  }
+  // Sent every quantum: a new process stops itself before exec, and a SIGCONT that beat that stop is lost.
+  // It costs a running process nothing (no state change, and no write at all for a thawed cgroup).
+  cs_cont(node->pid);
+}
+
+/* Stops every process the concurrent engine left running, except (if keep_selected) the ones
+ *   selected for this quantum.
+ */
+static void cs_shed(int keep_selected) {
+  int kept = 0;
+  for(int i = 0; i < running_count; i++) {
+    pid_t pid = running[i].pid;
+    int selected = (on_cpu && on_cpu->pid == pid) || cs_also_index(pid) != -1;
+    if(keep_selected && selected) {
+      running[kept++] = running[i];
+    }
+    else {
+      cs_stop(pid);
+      shed_count++;
+    }
+  }
+  running_count = kept;
+}
+
+/* Returns the CPU time (usec) a process has used so far, with anything it forked if it has a cgroup,
+ *   or -1 if it can't be read.
+ */
+static long long cs_cpu_usec(pid_t pid) {
+  long long cpu = cgroup_cpu_usec(pid);
+  return cpu != -1 ? cpu : proc_cpu_usec(pid);
+}
+
+/* Charges a process left running by the concurrent engine (and its tenant) for the CPU it has
+ *   actually used since its quantum began, however long it was given.
+ */
+static void cs_charge_running(Otur_process_s *node) {
+  for(int i = 0; i < running_count; i++) {
+    if(running[i].pid != node->pid) {
+      continue;
+    }
+    long long cpu = cs_cpu_usec(node->pid);
+    if(running[i].cpu >= 0 && cpu >= running[i].cpu) {
+      otur_charge(node, cpu - running[i].cpu > UINT32_MAX ? UINT32_MAX : (uint32_t)(cpu - running[i].cpu));
+    }
+    running[i].cpu = cpu; // Charged up to here
+    return;
+  }
+}
+
+/* Drops a process that has finished, been stopped or blocked from the ones left running */
+static void cs_forget_running(pid_t pid) {
+  for(int i = 0; i < running_count; i++) {
+    if(running[i].pid == pid) {
+      running[i] = running[--running_count];
+      return;
+    }
+  }
+}
+
+/* Returns where the process with this pid is in also_cpu, or -1 */
+static int cs_also_index(pid_t pid) {
+  for(int i = 0; i < also_count; i++) {
+    if(also_cpu[i]->pid == pid) {
+      return i;
+    }
+  }
+  return -1;
+}
+
+/* Picks the Dispatch Engine: 1 slot is serial, more run that many processes at once (concurrent) */
+void cs_set_engine(int slots) {
+  int last_state = -1;
+
+  pthread_mutex_lock(&cs_run_m);
+  last_state = cs_run;
+  pthread_mutex_unlock(&cs_run_m);
+
+  stop_cs(); // The Dispatcher sheds whatever is over the new limit on its next quantum.
+
+  sigset_t saved;
+  sched_lock(&saved);
+  engine_slots = slots;
+  sched_unlock(&saved);
+  print_engine();
+
+  if(last_state == CS_RUN) {
+    start_cs();
+  }
+}
+
+/* Prints the Dispatch Engine in use */
+void print_engine() {
+  if(engine_slots > 1) {
+    PRINT_STATUS("Engine: concurrent, up to %d processes at once (%ld shed, %ld priority changes refused)",
+        engine_slots, shed_count, refused_count);
+  }
+  else {
+    PRINT_STATUS("Engine: serial, one process at a time");
+  }
+}
+
+/* Picks how each Ready Queue is ordered: OTUR_POLICY_FIFO, or OTUR_POLICY_SJF (least predicted time left first) */
+void cs_set_policy(int policy) {
+  sigset_t saved;
+  sched_lock(&saved);
+  schedule->policy = policy;
+  sched_unlock(&saved);
+  print_policy();
+}
+
+/* Prints the Ready Queue order in use, and what the runtime history it predicts from holds */
+void print_policy() {
+  sigset_t saved;
+  sched_lock(&saved);
+  if(schedule->policy == OTUR_POLICY_SJF) {
+    PRINT_STATUS("Policy: sjf, the least predicted CPU time left first (%d usec if unknown), starving ones before all",
+        SJF_UNKNOWN_USEC);
+  }
+  else {
+    PRINT_STATUS("Policy: fifo, first come first served");
+  }
+  print_history();
+  sched_unlock_read(&saved);
+}
+
+/* Prints the memory pressure, and how many ready processes the Scheduler is holding back for smaller ones */
+void cs_print_pressure() {
+  int large_ready = 0;
+  sigset_t saved;
+  sched_lock(&saved);
+  Otur_queue_s *queues[] = { schedule->ready_queue_high, schedule->ready_queue_normal };
+  for(int i = 0; i < 2 && schedule->defer_kb; i++) {
+    for(Otur_process_s *walker = otur_first(queues[i]); walker != NULL; walker = otur_next(walker)) {
+      large_ready += (otur_rss(walker) >= schedule->defer_kb);
+    }
+  }
+  long deferred = schedule->deferred;
+  sched_unlock_read(&saved);
+  print_pressure(large_ready, deferred);
+}
+
+/* Sets a tenant's shares of the CPUs, adding the tenant if it's new */
+void cs_set_tenant(char *name, int shares) {
+  sigset_t saved;
+  sched_lock(&saved);
+  int tenant = otur_tenant(name);
+  if(tenant != -1) {
+    otur_tenant_shares(tenant, shares);
+  }
+  sched_unlock(&saved);
+
+  if(tenant == -1) {
+    PRINT_WARNING("No room for tenant %s (at most %d tenants)", name, OTUR_MAX_TENANTS);
+    return;
+  }
+  print_tenants();
+}
+
+/* Prints every tenant: its shares (and the part of the CPUs they come to now), processes and usage */
+void print_tenants() {
+  int live[OTUR_MAX_TENANTS] = {0};
+  int ready[OTUR_MAX_TENANTS] = {0};
+  sigset_t saved;
+  sched_lock(&saved);
+  Otur_queue_s *queues[] = { schedule->ready_queue_high, schedule->ready_queue_normal, schedule->wait_queue };
+  for(int i = 0; i < 3; i++) {
+    for(Otur_process_s *walker = otur_first(queues[i]); walker != NULL; walker = otur_next(walker)) {
+      live[otur_tenant_of(walker)]++;
+      ready[otur_tenant_of(walker)] += (i < 2);
+    }
+  }
+  if(on_cpu) {
+    live[otur_tenant_of(on_cpu)]++;
+  }
+  for(int i = 0; i < also_count; i++) {
+    live[otur_tenant_of(also_cpu[i])]++;
+  }
+
+  // Shares only count for tenants with something to run
+  long active_shares = 0;
+  for(int i = 0; i < otur_tenant_count(); i++) {
+    active_shares += live[i] ? otur_tenant_info(i)->shares : 0;
+  }
+  PRINT_STATUS("Tenants: %d", otur_tenant_count());
+  for(int i = 0; i < otur_tenant_count(); i++) {
+    const Otur_tenant_s *tenant = otur_tenant_info(i);
+    PRINT_STATUS("     %-16s Shares: %5u (%3ld%% now), Processes: %4d (%4d ready), CPU: %9.3f sec",
+        otur_tenant_name(i), tenant->shares, live[i] ? tenant->shares * 100L / active_shares : 0L,
+        live[i], ready[i], tenant->total / 1000000.0);
+  }
+  sched_unlock_read(&saved);
+}
+
+/* Resumes every process in the Wait Queue, so cs_sample_waiting can see which of them can run.
+ * Returns the number of waiting processes.
+ */
+static int cs_wake_waiting() {
+  for(Otur_process_s *walker = otur_first(schedule->wait_queue); walker != NULL; walker = otur_next(walker)) {
+    cs_cont(walker->pid);
+  }
+  return otur_count(schedule->wait_queue);
+}
+
+/* Suspends every waiting process again, after cs_wake_waiting, and returns the ones that are
+ *   running (no longer blocked) to their Ready Queues.
+ * - The whole Wait Queue is checked in one batch, during the probe the Dispatcher already makes.
+ */
+static void cs_sample_waiting() {
+  Otur_process_s *walker = otur_first(schedule->wait_queue);
+  while(walker != NULL) {
+    Otur_process_s *next = otur_next(walker);
+    pid_t pid = walker->pid;
+    char state = cs_run_state(pid);
+    cs_stop(pid);
+
+    if(state == 'R' && coop_state(pid) != SHVM_JOB_BLOCKED) {
+      if(otur_unblock(schedule, pid) == -1) {
+        ABORT_ERROR("Error reported by otur_unblock.");
+      }
+      persist_track(walker, ready_list(walker));
+      PRINT_DEBUG("PID %d is runnable, moved back to the Ready Queue", pid);
+      unblocked++;
+    }
+    // Adopted processes finish without a SIGCHLD, so this is where we find out.
+    else if(persist_adopted(pid) && !persist_alive(pid)) {
+      if(otur_killed(schedule, pid, PERSIST_LOST_EXIT) == -1) {
+        ABORT_ERROR("Error reported by otur_killed.");
+      }
+      persist_track(otur_last(schedule->defunct_queue), PERSIST_DEFUNCT);
+    }
+    walker = next;
+  }
+}
+
+/* Samples the host's memory pressure when it's due and, while under it, every ready or waiting
+ *   process' resident set, so otur_select can defer the large ones (see vm_pressure.h).
+ */
+static void cs_sample_pressure() {
+  int state = pressure_sample();
+  if(state == -1) {
+    return;
+  }
+  if(state) {
+    Otur_queue_s *queues[] = { schedule->ready_queue_high, schedule->ready_queue_normal, schedule->wait_queue };
+    for(int i = 0; i < 3; i++) {
+      for(Otur_process_s *walker = otur_first(queues[i]); walker != NULL; walker = otur_next(walker)) {
+        otur_footprint(walker, pressure_rss_kb(walker->pid));
+      }
+    }
+  }
+  schedule->defer_kb = state ? pressure_large_kb() : 0;
+}
+
+/* Remembers the pid launched with a job name (replacing any earlier one with that name) */
+static void cs_name_job(char *name, pid_t pid) {
+  for(int i = 0; i < JOB_NAMES; i++) {
+    if(job_names[i].pid != 0 && strcmp(job_names[i].name, name) == 0) {
+      job_names[i].pid = pid;
+      return;
+    }
+  }
+  snprintf(job_names[job_names_next].name, MAX_JOB_NAME, "%s", name);
+  job_names[job_names_next].pid = pid;
+  job_names_next = (job_names_next + 1) % JOB_NAMES;
+}
+
+/* Returns the pid of a job given by pid or by name, or 0 if there's no such name */
+static pid_t cs_job_pid(char *job) {
+  char *end = NULL;
+  long pid = strtol(job, &end, 10);
+  if(end != job && *end == '\0') {
+    return pid > 0 ? pid : 0;
+  }
+  for(int i = 0; i < JOB_NAMES; i++) {
+    if(job_names[i].pid != 0 && strcmp(job_names[i].name, job) == 0) {
+      return job_names[i].pid;
+    }
+  }
+  return 0;
+}
+
+/* Kills the Pending processes that can never run, because a process they run after failed.
+ * - Each goes Defunct when its SIGCHLD comes in, which in turn cancels whatever runs after it.
+ */
+static void cs_cancel_pending() {
+  Otur_process_s *cancelled[16];
+  int count = 0;
+  while((count = otur_cancel(schedule, cancelled, 16)) > 0) {
+    for(int i = 0; i < count; i++) {
+      PRINT_STATUS("Cancelling PID %d (%s): a process it runs after failed", cancelled[i]->pid, otur_cmd(cancelled[i]));
+      kill(cancelled[i]->pid, SIGKILL);
+    }
+  }
+}
+
+/* Returns about how much memory a Defunct process holds: its node and table slot (commands are shared) */
+static long defunct_bytes(Otur_process_s *node) {
+  return sizeof(Otur_process_s) + (sizeof(Otur_chunk_s) / OTUR_CHUNK_SIZE);
+}
+
+/* Returns the snapshot list a process just put back by otur_enqueue is in (same rule) */
+static int ready_list(Otur_process_s *node) {
+  return (otur_state(node) & (OTUR_HIGH | OTUR_CRITICAL)) ? PERSIST_HIGH : PERSIST_NORMAL;
+}
+
+/* Returns 1 if pid is one of our children or an adopted process that's still alive, else 0. */
+static int cs_is_alive(pid_t pid) {
+  return process_find(pid) || (persist_adopted(pid) && persist_alive(pid));
+}
+
+/* Returns the pid otur_reap(pid) is about to reap (pid 0 means the head of the Defunct Queue). */
+static pid_t cs_reap_target(pid_t pid) {
+  if(pid == 0 && otur_first(schedule->defunct_queue)) {
+    return otur_first(schedule->defunct_queue)->pid;
+  }
+  return pid;
+}
+
+/* Returns 1 while the process with the given pid has not finished, adopted ones included
+ * - The Process System forgets it as it's reaped, but it isn't finished until the Dispatcher has
+ *   made it Defunct (see Exits), so it's looked for in the schedule too.
+ */
+static int cs_unfinished(pid_t pid) {
+  Otur_queue_s *queues[] = { schedule->ready_queue_high, schedule->ready_queue_normal, schedule->wait_queue,
+                             schedule->pending_queue };
+  sigset_t saved;
+  sched_lock(&saved);
+  int unfinished = (process_find(pid) || persist_adopted(pid) || (on_cpu && on_cpu->pid == pid) ||
+                    cs_also_index(pid) != -1);
+  for(int i = 0; i < 4 && !unfinished; i++) {
+    unfinished = (otur_table_find(pid, queues[i]->id) != OTUR_NIL);
+  }
+  sched_unlock_read(&saved);
+  return unfinished;
+}
+
+/* Returns the number of processes that have not finished yet (On CPU, Ready, Waiting, or not yet admitted) */
+int cs_live_count() {
+  sigset_t saved;
+  sched_lock(&saved);
+  int count = otur_count(schedule->ready_queue_high) + otur_count(schedule->ready_queue_normal) +
+              otur_count(schedule->wait_queue) + otur_count(schedule->pending_queue) + also_count;
+  if(on_cpu) {
+    count++;
+  }
+  sched_unlock_read(&saved);
+  return count + admit_waiting();
+}
+
+/* Counts the live processes (On CPU, Ready, Waiting or Pending) of each admission class (see vm_admit.h) */
+void cs_live_by_class(int live[]) {
+  Otur_queue_s *queues[] = { schedule->ready_queue_high, schedule->ready_queue_normal, schedule->wait_queue,
+                             schedule->pending_queue };
+  sigset_t saved;
+  sched_lock(&saved);
+  for(int i = 0; i < 4; i++) {
+    for(Otur_process_s *walker = otur_first(queues[i]); walker != NULL; walker = otur_next(walker)) {
+      uint32_t state = otur_state(walker);
+      live[admit_class((state & OTUR_CRITICAL) != 0, (state & OTUR_HIGH) != 0)]++;
+    }
+  }
+  for(int i = -1; i < also_count; i++) {
+    Otur_process_s *node = (i == -1) ? on_cpu : also_cpu[i];
+    if(node != NULL) {
+      uint32_t state = otur_state(node);
+      live[admit_class((state & OTUR_CRITICAL) != 0, (state & OTUR_HIGH) != 0)]++;
+    }
+  }
+  sched_unlock_read(&saved);
+}
+
+/* Returns 1 if the CS System is running, 0 if it is stopped */
+int cs_is_running() {
+  pthread_mutex_lock(&cs_run_m);
+  int state = cs_run;
+  pthread_mutex_unlock(&cs_run_m);
+  return (state == CS_RUN);
+}
+
 /* Return the process that was on the CPU back to the Scheduler during Termination
  * -  If process was NOT on CPU during termination, then it is handled in another function.
  */
@@ -242,6 +1324,7 @@ void cs_exiting_process(int exit_code) {
     if(otur_exited(schedule, on_cpu, exit_code) == -1) {
       ABORT_ERROR("Error reported by otur_exited.");
     }
+    persist_track(on_cpu, PERSIST_DEFUNCT);
     PRINT_DEBUG("Exiting PID %d, with exit code %d with otur_exited\n", on_cpu->pid, exit_code);
     on_cpu = NULL;
   }
@@ -252,39 +1335,143 @@ void cs_exiting_process(int exit_code) {
 
 /* Add a newly created process to the schedule system */
 void cs_otur_process(Process_data_s *proc) {
+  sigset_t saved;
+  sched_lock(&saved);
   // Create the new Process with the given parameters (from the Shell)
   Otur_process_s *proc_node = otur_invoke(proc->pid, proc->is_high, proc->is_critical, proc->input_orig);
   if(proc_node == NULL) {
     ABORT_ERROR("Error reported by otur_invoke.");
   }
+  if(proc->gang[0] != '\0' && otur_join(proc_node, proc->gang) == -1) {
+    ABORT_ERROR("Error reported by otur_join.");
+  }
+  if(otur_override(proc_node, proc->quantum_usec, proc->level) == -1) {
+    ABORT_ERROR("Error reported by otur_override.");
+  }
+  if(otur_pin(proc_node, proc->cpus) == -1) {
+    ABORT_ERROR("Error reported by otur_pin.");
+  }
+  if(proc->name[0] != '\0') {
+    cs_name_job(proc->name, proc->pid);
+  }
+  for(int i = 0; i < MAX_AFTER && proc->after[i][0] != '\0'; i++) {
+    // One reaped into the Exit Archive after a success counts too
+    pid_t prereq = cs_job_pid(proc->after[i]);
+    Archive_record_s record;
+    if(prereq > 0 && !cs_is_alive(prereq) && archive_find(prereq, &record) == 0 && record.exit_code == 0) {
+      continue;
+    }
+    if(otur_depend(schedule, proc_node, prereq) == -1) {
+      PRINT_WARNING("%s has failed or can't be found, so PID %d can't run after it", proc->after[i], proc->pid);
+    }
+  }
+  if(proc->tenant[0] != '\0') {
+    int tenant = otur_tenant(proc->tenant);
+    if(tenant == -1) {
+      PRINT_WARNING("No room for tenant %s (at most %d tenants), PID %d runs as default", proc->tenant, OTUR_MAX_TENANTS, proc->pid);
+    }
+    else if(otur_assign(proc_node, tenant) == -1) {
+      ABORT_ERROR("Error reported by otur_assign.");
+    }
+  }
+  // How long it took before is how long it's predicted to take (see policy sjf)
+  long long predict = history_start(proc->pid, proc->argv);
+  if(predict >= 0 && otur_predict(proc_node, predict > 0 ? predict : 1) == -1) {
+    ABORT_ERROR("Error reported by otur_predict.");
+  }
   // Then Insert it into the Queue
   if(otur_enqueue(schedule, proc_node) == -1) {
     ABORT_ERROR("Error reported by otur_enqueue.");
   }
+  persist_track(proc_node, ready_list(proc_node));
+  if(coop_open(proc->pid) == -1) {
+    PRINT_DEBUG("PID %d has no control page, it can't cooperate", proc->pid);
+  }
+  int weight = proc->is_critical ? WEIGHT_CRITICAL : (proc->is_high ? WEIGHT_HIGH : WEIGHT_NORMAL);
+  if(cgroup_adopt(proc->pid, weight) == -1) {
+    PRINT_DEBUG("PID %d has no cgroup, it will be signalled", proc->pid);
+  }
   PRINT_STATUS("Process %s created with PID %d", proc->input_orig, proc->pid);
+  cs_cancel_pending();
   // Finally, print the schedule out (Debug Mode Only) to see it there.
   print_otur_debug(schedule, get_on_cpu());
+  sched_unlock(&saved);
 }
 
-/* Directs Scheduler that a process had terminated with the given exit code. */
+/* Records that a process has terminated with the given exit code, for the Dispatcher to finish.
+ * - Called from the Process System's SIGCHLD handler: nothing here takes a lock (see Exits).
+ */
 void cs_otur_terminated(pid_t pid, int exit_code) {
-  int last_state = -1; // Illegal state that will be set in this function
+  unsigned tail = __atomic_load_n(&exits_tail, __ATOMIC_ACQUIRE);
+  do {
+    if(tail - __atomic_load_n(&exits_head, __ATOMIC_ACQUIRE) >= EXIT_SLOTS) {
+      __atomic_add_fetch(&exits_dropped, 1, __ATOMIC_RELAXED);
+      return;
+    }
+  } while(!__atomic_compare_exchange_n(&exits_tail, &tail, tail + 1, 0, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE));
+  Exit_s *rec = &exits[tail % EXIT_SLOTS];
+  rec->pid = pid;
+  rec->exit_code = exit_code;
+  __atomic_store_n(&rec->ready, 1, __ATOMIC_RELEASE);
 
-  // There IS a race condition here, but it's a pretty minor one.  
-  // If it WAS running when we shut it off, restart it when we finish.
-  // It's possible they shut it off manually in the microseconds between these,
-  // but it's not exactly the end of the world if they had.
-  pthread_mutex_lock(&cs_run_m);
-  last_state = cs_run;
-  pthread_mutex_unlock(&cs_run_m);
+  coop_exited(pid); // A slice the Dispatcher is waiting out on its page ends now
+  if(__atomic_load_n(&exits_bell, __ATOMIC_SEQ_CST)) {
+    pthread_kill(pt_cs, SIGCHLD);
+  }
+}
 
-  stop_cs(); // Critical! This ensures the state is consistent first.
+/* Finishes the exits recorded by cs_otur_terminated, oldest first (Dispatcher only, schedule unlocked) */
+static void cs_finish_exits() {
+  if(__atomic_load_n(&exits_head, __ATOMIC_ACQUIRE) == __atomic_load_n(&exits_tail, __ATOMIC_ACQUIRE) &&
+     __atomic_load_n(&exits_dropped, __ATOMIC_RELAXED) == 0) {
+    return;
+  }
+  long dropped = __atomic_exchange_n(&exits_dropped, 0, __ATOMIC_RELAXED);
+  if(dropped > 0) {
+    PRINT_WARNING("%ld exits came in with no room left to record them (see EXIT_SLOTS)", dropped);
+  }
+
+  sigset_t saved;
+  sched_lock(&saved);
+  unsigned head = exits_head;
+  while(head != __atomic_load_n(&exits_tail, __ATOMIC_ACQUIRE)) {
+    Exit_s *rec = &exits[head % EXIT_SLOTS];
+    if(!__atomic_load_n(&rec->ready, __ATOMIC_ACQUIRE)) {
+      break; // Still being recorded, and its SIGCHLD comes after
+    }
+    pid_t pid = rec->pid;
+    int exit_code = rec->exit_code;
+    __atomic_store_n(&rec->ready, 0, __ATOMIC_RELAXED);
+    __atomic_store_n(&exits_head, ++head, __ATOMIC_RELEASE);
+    cs_finish_exit(pid, exit_code);
+  }
+  cs_cancel_pending(); // Everything waiting on a failure goes too
+  cs_autoreap();
+  sched_unlock(&saved);
+}
+
+/* Directs Scheduler that a process had terminated with the given exit code (schedule locked). */
+static void cs_finish_exit(pid_t pid, int exit_code) {
+  cs_forget_running(pid);
+  long long cpu = cgroup_cpu_usec(pid); // Gone with its cgroup
+  cgroup_release(pid);
+  coop_close(pid);
+  int also = cs_also_index(pid);
 
   // Check if the terminted process is on the cpu.  If so, treat it as an exiting process.
   if(on_cpu && on_cpu->pid == pid) {
     // Exit from the CPU directly (terminated while being run)
     cs_exiting_process(exit_code);
   }
+  // Or running alongside it (concurrent engine)
+  else if(also != -1) {
+    Otur_process_s *node = also_cpu[also];
+    also_cpu[also] = also_cpu[--also_count];
+    if(otur_exited(schedule, node, exit_code) == -1) {
+      ABORT_ERROR("Error reported by otur_exited.");
+    }
+    persist_track(node, PERSIST_DEFUNCT);
+  }
   // Otherwise, it was terminated while in a Queue; treat as a terminated process.
   else {
     // Exit from the Ready or Suspended Queues (terminated by command)
@@ -292,33 +1479,33 @@ void cs_otur_terminated(pid_t pid, int exit_code) {
     if(status == -1) {
       ABORT_ERROR("Error reported by otur_killed.");
     }
+    persist_track(otur_last(schedule->defunct_queue), PERSIST_DEFUNCT); // otur_killed appends it
 
     PRINT_DEBUG("Terminating PID %d with exit code %d with otur_killed\n", pid, exit_code);
   }
-
-  // Finally, if the CS system had been running before this interruption, resume it.
-  if(last_state == CS_RUN) {
-    start_cs();
-  }
-} 
+  // Successful runs teach the history how long the command takes (without a cgroup, what it was charged)
+  Otur_process_s *ended = otur_last(schedule->defunct_queue); // Each of those appends it
+  int success = ended != NULL && ended->pid == pid && (otur_state(ended) & OTUR_EXIT_MASK) == 0;
+  history_finish(pid, cpu >= 0 ? cpu : (success ? (long long)otur_ran(ended) : -1), success);
+}
 
 /* Starts the CS Processing System */
 void start_cs() {
   pthread_mutex_lock(&cs_run_m);
-  if(cs_run == CS_STOP) {
-    cs_run = CS_RUN;
-    pthread_mutex_unlock(&cs_cv_m);
-  }
+  int was = cs_run;
+  cs_run = CS_RUN;
   pthread_mutex_unlock(&cs_run_m);
+  if(was == CS_STOP) {
+    cs_wake();
+  }
 }
 
-/* Stops the CS Processing System */
+/* Stops the CS Processing System
+ * - The Dispatcher finishes the quantum in progress; the schedule lock is what keeps callers consistent.
+ */
 void stop_cs() {
   pthread_mutex_lock(&cs_run_m);
-  if(cs_run == CS_RUN) {
-    cs_run = CS_STOP;
-    pthread_mutex_lock(&cs_cv_m);
-  }
+  cs_run = CS_STOP;
   pthread_mutex_unlock(&cs_run_m);
 }
 
@@ -381,6 +1568,19 @@ void print_cs_status() {
   else {
     PRINT_STATUS("CS System Stopped: runtime %d usec, delaytime %d usec", sleep_usec_time, between_usec_time);
   }
+  PRINT_STATUS("Quantum: %s", adaptive_quantum ? "adaptive (learned per process)" : "fixed (runtime)");
+  print_engine();
+  print_policy();
+  print_admit();
+  cs_print_pressure();
+  print_zygote();
+  print_output();
+  print_coop(0);
+  print_cgroup();
+  Snapshot_summary_s summary;
+  snapshot_summary(&summary);
+  PRINT_STATUS("Blocked Processes: %d waiting, %ld quanta cut short, %ld back to ready",
+      summary.count[SNAP_WAIT], blocked_quanta, unblocked);
   return;
 }
 
@@ -406,6 +1606,68 @@ useconds_t get_between_usec() {
   return between_usec_time;
 }
 
+/* Returns the latest copy of the schedule, held until snapshot_put, making a new one first if the
+ * schedule has changed since.  Only the copying holds the schedule lock.
+ */
+const Snapshot_s *cs_snapshot() {
+  if(schedule != NULL && snapshot_stale()) {
+    sigset_t saved;
+    sched_lock(&saved);
+    if(snapshot_stale()) { // Another reader may have made it while this one waited
+      snapshot_publish(schedule, on_cpu, also_cpu, also_count);
+    }
+    sched_unlock_read(&saved);
+  }
+  return snapshot_get();
+}
+
+/* Prints the whole schedule, and the processes on the CPUs, as one consistent picture */
+void cs_print_schedule() {
+  const Snapshot_s *snap = cs_snapshot();
+  print_snapshot(snap);
+  snapshot_put(snap);
+}
+
+/* Suspends a process: its whole cgroup if it has one, else its process group with SIGTSTP
+ * - Every process is started as the leader of its own process group, so that also catches what it forks.
+ */
+static void cs_stop(pid_t pid) {
+  if(cgroup_freeze(pid, 1) == -1 && killpg(pid, SIGTSTP) == -1) {
+    kill(pid, SIGTSTP); // Adopted, or it moved itself to another group
+  }
+}
+
+/* Resumes a process: its whole cgroup if it has one, else its process group with SIGCONT */
+static void cs_cont(pid_t pid) {
+  coop_resume(pid); // A cooperating process waiting in shvm_yield carries on
+  if(cgroup_freeze(pid, 0) == -1 && killpg(pid, SIGCONT) == -1) {
+    kill(pid, SIGCONT);
+  }
+}
+
+/* Locks the schedule against every other thread (and SIGCHLD on this one) */
+static void sched_lock(sigset_t *saved) {
+  sigset_t mask;
+  sigemptyset(&mask);
+  sigaddset(&mask, SIGCHLD);
+  pthread_sigmask(SIG_BLOCK, &mask, saved);
+  pthread_mutex_lock(&sched_m);
+}
+
+/* Records the change to the schedule and unlocks it, then lets through any SIGCHLD that came in meanwhile */
+static void sched_unlock(sigset_t *saved) {
+  if(schedule != NULL) {
+    snapshot_changed(schedule, on_cpu, also_count);
+  }
+  sched_unlock_read(saved);
+}
+
+/* Unlocks the schedule after only reading it, so there's no change to record */
+static void sched_unlock_read(sigset_t *saved) {
+  pthread_mutex_unlock(&sched_m);
+  pthread_sigmask(SIG_SETMASK, saved, NULL);
+}
+
 /* Accessor for the process currently on the CPU */
 Otur_process_s *get_on_cpu() {
   return on_cpu;
@@ -415,3 +1677,113 @@ Otur_process_s *get_on_cpu() {
 Otur_schedule_s *get_schedule() {
   return schedule;
 }
+
+/* Creates the Dispatcher's epoll set with its timer, wake-up and signal events (see Dispatcher Events) */
+static void cs_events_open() {
+  sigset_t mask;
+  sigemptyset(&mask);
+  sigaddset(&mask, SIGINT);
+  sigaddset(&mask, SIGCHLD);
+  cs_epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+  cs_timer_fd = timerfd_create(CLOCK_MONOTONIC, TFD_CLOEXEC | TFD_NONBLOCK);
+  cs_wake_fd = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+  cs_signal_fd = signalfd(-1, &mask, SFD_CLOEXEC | SFD_NONBLOCK);
+  if(cs_epoll_fd == -1 || cs_timer_fd == -1 || cs_wake_fd == -1 || cs_signal_fd == -1) {
+    ABORT_ERROR("Could not create the Dispatcher's events.");
+  }
+  int fds[] = { cs_timer_fd, cs_wake_fd, cs_signal_fd };
+  for(int i = CS_EVENT_TIMER; i <= CS_EVENT_SIGNAL; i++) {
+    struct epoll_event ev = {0};
+    ev.events = EPOLLIN;
+    ev.data.u32 = i;
+    if(epoll_ctl(cs_epoll_fd, EPOLL_CTL_ADD, fds[i], &ev) == -1) {
+      ABORT_ERROR("Could not watch the Dispatcher's events.");
+    }
+  }
+}
+
+/* Waits usec on the Dispatcher's timer, handling Ctrl-C and exits meanwhile (Dispatcher thread only).
+ * - With usec -1, waits until the CS System is started (or anything else wakes it) instead.
+ * - Cut short when shvm is shutting down.
+ * Returns 0 once the time is up, or 1 if woken first.
+ */
+static int cs_wait_event(long usec) {
+  if(usec == 0 || usec < -1) {
+    return 0;
+  }
+  struct itimerspec timer = {0};
+  if(usec > 0) {
+    timer.it_value.tv_sec = usec / 1000000;
+    timer.it_value.tv_nsec = (usec % 1000000) * 1000;
+  }
+  timerfd_settime(cs_timer_fd, 0, &timer, NULL);
+  cs_finish_exits(); // Any whose SIGCHLD went elsewhere (eg. during a launch from here)
+
+  while(1) {
+    struct epoll_event events[3];
+    int n = epoll_wait(cs_epoll_fd, events, 3, -1);
+    if(n == -1 && errno != EINTR) {
+      ABORT_ERROR("The Dispatcher could not wait on its events.");
+    }
+    int woken = 0, expired = 0;
+    for(int i = 0; i < n; i++) {
+      uint64_t count = 0;
+      switch(events[i].data.u32) {
+        case CS_EVENT_TIMER:
+          expired = (read(cs_timer_fd, &count, sizeof(count)) == sizeof(count));
+          break;
+        case CS_EVENT_WAKE:
+          woken = (read(cs_wake_fd, &count, sizeof(count)) == sizeof(count));
+          break;
+        case CS_EVENT_SIGNAL:
+          cs_read_signals();
+          break;
+      }
+    }
+    if(expired) {
+      return 0;
+    }
+    if(cs_do_cs == CS_STOP || (woken && usec == -1)) {
+      timer.it_value.tv_sec = timer.it_value.tv_nsec = 0;
+      timerfd_settime(cs_timer_fd, 0, &timer, NULL); // Disarmed, so it can't end the next wait early
+      return 1;
+    }
+  }
+}
+
+/* Waits out usec of a process' slice: on its control page if it cooperates (see vm_coop.h), else as
+ *   cs_wait_event does.  Ctrl-C and exits meanwhile are handled once the wait is over.
+ * Returns how the wait ended (COOP_*).
+ */
+static int cs_wait_job(pid_t pid, long usec) {
+  int said = (usec > 0) ? coop_wait(pid, usec) : COOP_RAN_OUT;
+  if(said == -1) {
+    cs_wait_event(usec);
+    return COOP_RAN_OUT;
+  }
+  cs_read_signals();
+  return said;
+}
+
+/* Handles any Ctrl-C and exits that have come in (Dispatcher thread only, schedule unlocked) */
+static void cs_read_signals() {
+  struct signalfd_siginfo info;
+  while(read(cs_signal_fd, &info, sizeof(info)) == sizeof(info)) {
+    if(info.ssi_signo == SIGINT) {
+      handle_ctrlc(); // Toggles the Context Switch System on and off.
+    }
+    else if(info.ssi_code != SI_TKILL) {
+      shell_sigchld(); // A child's own SIGCHLD, that no handler has seen
+    }
+  }
+  cs_finish_exits();
+}
+
+/* Wakes the Dispatcher from whatever it's waiting on (safe from any thread) */
+static void cs_wake() {
+  uint64_t one = 1;
+  coop_interrupt(); // Including a cooperating process' slice
+  if(write(cs_wake_fd, &one, sizeof(one)) == -1) {
+    return; // Already has a wake-up pending
+  }
+}
@@ -0,0 +1,454 @@
+#define _GNU_SOURCE // accept4, pipe2
+/* Standard Library Includes */
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdarg.h>
+#include <string.h>
+#include <strings.h>
+#include <errno.h>
+/* Linux System API Includes */
+#include <signal.h>
+#include <unistd.h>
+#include <poll.h>
+#include <fcntl.h>
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <pthread.h>
+/* StrawHat VM Includes */
+#include "vm.h"
+#include "vm_ctl.h"
+#include "vm_cs.h"
+#include "vm_shell.h"
+#include "vm_admit.h"
+#include "vm_snapshot.h"
+#include "vm_support.h"
+#include "vm_settings.h"
+
+/* Local Definitions */
+#define CTL_BUF_SIZE (MAX_CMD_LINE * 16) // Per-client input buffer
+
+/* Growable response buffer */
+typedef struct ctl_out {
+  char *data;
+  size_t len;
+  size_t cap;
+  int lines;  // Number of data lines added (for the OK <n> header)
+} Ctl_out_s;
+
+/* One connected client */
+typedef struct ctl_client {
+  int fd;                  // -1 when the slot is free
+  int batch_left;          // Command lines still expected for a BATCH (0 when not batching)
+  Ctl_out_s batch;         // PIDs collected for the BATCH in progress
+  size_t len;              // Bytes in buf
+  char buf[CTL_BUF_SIZE];  // Unprocessed input
+} Ctl_client_s;
+
+/* Local Globals (private to this source file) */
+static int listen_fd = -1;
+static int wake_pipe[2] = {-1, -1}; // Written by ctl_stop to end the server thread
+static char sock_path[sizeof(((struct sockaddr_un *)0)->sun_path)] = {0};
+static pthread_t pt_ctl;
+static Ctl_client_s clients[CTL_MAX_CLIENTS];
+static long submitted = 0; // Processes launched through the socket
+static long rejected = 0;  // Submissions that failed to parse or launch
+
+/* Local Prototypes */
+static void *ctl_thread(void *args);
+static void ctl_accept();
+static void ctl_read(Ctl_client_s *client);
+static void ctl_close(Ctl_client_s *client);
+static int ctl_request(Ctl_client_s *client, char *line);
+static pid_t ctl_submit(char *line);
+static void ctl_send(Ctl_client_s *client, Ctl_out_s *out);
+static void ctl_error(Ctl_client_s *client, char *reason);
+static void out_printf(Ctl_out_s *out, const char *fmt, ...);
+static void out_free(Ctl_out_s *out);
+static long extract_long(char *str);
+
+/* Creates the control socket at path and starts the server thread.
+ * Returns 0 on success or -1 on any error.
+ */
+int ctl_start(const char *path) {
+  struct sockaddr_un addr = {0};
+
+  if(path == NULL || strlen(path) >= sizeof(addr.sun_path)) {
+    PRINT_WARNING("Control socket path is too long.");
+    return -1;
+  }
+
+  for(int i = 0; i < CTL_MAX_CLIENTS; i++) {
+    clients[i].fd = -1;
+  }
+
+  listen_fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+  if(listen_fd == -1 || pipe2(wake_pipe, O_CLOEXEC) == -1) {
+    PRINT_WARNING("Could not create the control socket: %s", strerror(errno));
+    return -1;
+  }
+
+  // A stale socket from an earlier run would stop the bind.
+  addr.sun_family = AF_UNIX;
+  strncpy(addr.sun_path, path, sizeof(addr.sun_path) - 1);
+  unlink(path);
+  if(bind(listen_fd, (struct sockaddr *)&addr, sizeof(addr)) == -1 || listen(listen_fd, CTL_MAX_CLIENTS) == -1) {
+    PRINT_WARNING("Could not listen on %s: %s", path, strerror(errno));
+    close(listen_fd);
+    listen_fd = -1;
+    return -1;
+  }
+  chmod(path, S_IRUSR | S_IWUSR); // Only our own user may control SHVM
+  strncpy(sock_path, path, sizeof(sock_path) - 1);
+
+  if(pthread_create(&pt_ctl, NULL, &ctl_thread, NULL) != 0) {
+    ABORT_ERROR("Could not create a Thread for the Control Socket.");
+  }
+  PRINT_STATUS("Control socket listening on %s", sock_path);
+  return 0;
+}
+
+/* Stops the server thread and removes the socket.  Registered with atexit */
+void ctl_stop() {
+  if(listen_fd == -1) {
+    return;
+  }
+  if(write(wake_pipe[1], "", 1) == 1) {
+    pthread_join(pt_ctl, NULL);
+  }
+  for(int i = 0; i < CTL_MAX_CLIENTS; i++) {
+    ctl_close(&clients[i]);
+  }
+  close(listen_fd);
+  close(wake_pipe[0]);
+  close(wake_pipe[1]);
+  unlink(sock_path);
+  listen_fd = -1;
+}
+
+/* Control Socket Thread Function: services the listening socket and all clients */
+static void *ctl_thread(void *args) {
+  struct pollfd fds[CTL_MAX_CLIENTS + 2];
+  int slot[CTL_MAX_CLIENTS + 2];
+
+  // SIGCHLD is handled on the shell thread; the Launch Guard covers launches made from here.
+  sigset_t mask;
+  sigemptyset(&mask);
+  sigaddset(&mask, SIGCHLD);
+  sigaddset(&mask, SIGINT);
+  pthread_sigmask(SIG_BLOCK, &mask, NULL);
+
+  while(1) {
+    int nfds = 0;
+    fds[nfds].fd = wake_pipe[0];
+    fds[nfds++].events = POLLIN;
+    fds[nfds].fd = listen_fd;
+    fds[nfds++].events = POLLIN;
+    for(int i = 0; i < CTL_MAX_CLIENTS; i++) {
+      if(clients[i].fd != -1) {
+        slot[nfds] = i;
+        fds[nfds].fd = clients[i].fd;
+        fds[nfds++].events = POLLIN;
+      }
+    }
+
+    if(poll(fds, nfds, -1) == -1) {
+      if(errno == EINTR) {
+        continue;
+      }
+      ABORT_ERROR("Error polling the Control Socket.");
+    }
+
+    // ctl_stop is asking us to exit.
+    if(fds[0].revents) {
+      break;
+    }
+    if(fds[1].revents & POLLIN) {
+      ctl_accept();
+    }
+    for(int i = 2; i < nfds; i++) {
+      if(fds[i].revents) {
+        ctl_read(&clients[slot[i]]);
+      }
+    }
+  }
+  pthread_exit(0);
+}
+
+/* Accepts a new client into a free slot */
+static void ctl_accept() {
+  int fd = accept4(listen_fd, NULL, NULL, SOCK_CLOEXEC);
+  if(fd == -1) {
+    return;
+  }
+  for(int i = 0; i < CTL_MAX_CLIENTS; i++) {
+    if(clients[i].fd == -1) {
+      memset(&clients[i], 0, sizeof(Ctl_client_s));
+      clients[i].fd = fd;
+      return;
+    }
+  }
+  // No room, so turn them away.
+  dprintf(fd, "ERR too many clients\n");
+  close(fd);
+}
+
+/* Reads whatever is available from a client and runs every complete line */
+static void ctl_read(Ctl_client_s *client) {
+  ssize_t got = read(client->fd, client->buf + client->len, CTL_BUF_SIZE - client->len);
+  if(got <= 0) {
+    ctl_close(client);
+    return;
+  }
+  client->len += got;
+
+  // Run each complete line, then keep any partial line for the next read.
+  char *start = client->buf;
+  char *end = NULL;
+  while((end = memchr(start, '\n', client->len - (start - client->buf))) != NULL) {
+    *end = '\0';
+    if(end > start && end[-1] == '\r') {
+      end[-1] = '\0';
+    }
+    if(ctl_request(client, start) == -1) {
+      ctl_close(client);
+      return;
+    }
+    start = end + 1;
+  }
+  client->len -= (start - client->buf);
+  memmove(client->buf, start, client->len);
+
+  // A line that fills the whole buffer can never complete.
+  if(client->len == CTL_BUF_SIZE) {
+    ctl_error(client, "line too long");
+    client->len = 0;
+  }
+}
+
+/* Closes a client connection and frees its slot */
+static void ctl_close(Ctl_client_s *client) {
+  if(client->fd != -1) {
+    // Children forked before their exec still hold a copy of this fd, so close() alone
+    // would not end the connection for the client.
+    shutdown(client->fd, SHUT_RDWR);
+    close(client->fd);
+    client->fd = -1;
+  }
+  out_free(&client->batch);
+  client->batch_left = 0;
+  client->len = 0;
+}
+
+/* Runs one request line from a client.
+ * Returns 0 to keep the connection, or -1 to close it.
+ */
+static int ctl_request(Ctl_client_s *client, char *line) {
+  Ctl_out_s out = {0};
+
+  // Inside a BATCH every line is a command line to launch.
+  if(client->batch_left > 0) {
+    out_printf(&client->batch, "%d\n", ctl_submit(line));
+    client->batch_left--;
+    if(client->batch_left == 0) {
+      ctl_send(client, &client->batch);
+      out_free(&client->batch);
+    }
+    return 0;
+  }
+
+  // Split off the request name from its arguments.
+  char *args = line + strcspn(line, " ");
+  if(*args != '\0') {
+    *args++ = '\0';
+  }
+
+  if(strcasecmp(line, "SUBMIT") == 0) {
+    pid_t pid = ctl_submit(args);
+    if(pid == -1) {
+      ctl_error(client, "could not launch command (or refused by admission control)");
+      return 0;
+    }
+    out_printf(&out, "%d\n", pid);
+  }
+  else if(strcasecmp(line, "BATCH") == 0) {
+    long count = extract_long(args);
+    if(count <= 0) {
+      ctl_error(client, "BATCH needs a count");
+      return 0;
+    }
+    client->batch_left = count;
+    return 0;
+  }
+  else if(strcasecmp(line, "KILL") == 0) {
+    long pid = extract_long(args);
+    if(pid <= 1 || kill(pid, SIGKILL) == -1) {
+      ctl_error(client, "no such process");
+      return 0;
+    }
+  }
+  else if(strcasecmp(line, "REAP") == 0) {
+    long pid = (*args == '\0') ? 0 : extract_long(args);
+    int ec = (pid < 0) ? -1 : cs_reap_code(pid);
+    if(ec == -1) {
+      ctl_error(client, "no such process to reap");
+      return 0;
+    }
+    out_printf(&out, "%d\n", ec);
+  }
+  else if(strcasecmp(line, "STATS") == 0) {
+    Snapshot_summary_s summary; // Never stops the Dispatcher, however often it's asked
+    snapshot_summary(&summary);
+    int *count = summary.count;
+    out_printf(&out, "cs %s\n", cs_is_running() ? "running" : "stopped");
+    out_printf(&out, "runtime %u\n", get_run_usec());
+    out_printf(&out, "delaytime %u\n", get_between_usec());
+    out_printf(&out, "debug %d\n", g_debug_mode);
+    out_printf(&out, "on_cpu %d\n", summary.on_cpu);
+    out_printf(&out, "ready_high %d\n", count[SNAP_HIGH]);
+    out_printf(&out, "ready_normal %d\n", count[SNAP_NORMAL]);
+    out_printf(&out, "waiting %d\n", count[SNAP_WAIT]);
+    out_printf(&out, "pending %d\n", count[SNAP_PENDING]);
+    out_printf(&out, "defunct %d\n", count[SNAP_DEFUNCT]);
+    out_printf(&out, "snapshot %lu\n", summary.version);
+    out_printf(&out, "submitted %ld\n", submitted);
+    out_printf(&out, "rejected %ld\n", rejected);
+    long queued = 0;
+    long refused = 0;
+    admit_totals(&queued, &refused);
+    out_printf(&out, "admit_waiting %d\n", admit_waiting());
+    out_printf(&out, "admit_queued %ld\n", queued);
+    out_printf(&out, "admit_refused %ld\n", refused);
+  }
+  else if(strcasecmp(line, "SCHEDULE") == 0) {
+    const Snapshot_s *snap = cs_snapshot();
+    for(int i = 0; snap != NULL && i < snap->total; i++) {
+      const Process_view_s *view = &snap->procs[i].view;
+      out_printf(&out, "%s %d [%s] %d %d %s\n", snapshot_place_name(snap->procs[i].place), view->pid,
+          view->flags, view->age, view->exit_code, view->cmd);
+    }
+    snapshot_put(snap);
+  }
+  else if(strcasecmp(line, "SET") == 0) {
+    char *value = args + strcspn(args, " ");
+    if(*value != '\0') {
+      *value++ = '\0';
+    }
+    long time = extract_long(value);
+    if(strcasecmp(args, "runtime") == 0 && time >= SLEEP_MIN_USEC && time <= SLEEP_MAX_USEC) {
+      set_run_usec(time);
+    }
+    else if(strcasecmp(args, "delaytime") == 0 && time >= BETWEEN_MIN_USEC && time <= BETWEEN_MAX_USEC) {
+      set_between_usec(time);
+    }
+    else if(strcasecmp(args, "debug") == 0 && (strcasecmp(value, "on") == 0 || strcasecmp(value, "off") == 0)) {
+      g_debug_mode = (strcasecmp(value, "on") == 0);
+    }
+    else {
+      ctl_error(client, "bad setting or value out of range");
+      return 0;
+    }
+  }
+  else if(strcasecmp(line, "START") == 0) {
+    start_cs();
+  }
+  else if(strcasecmp(line, "STOP") == 0) {
+    stop_cs();
+  }
+  else if(strcasecmp(line, "QUIT") == 0) {
+    return -1;
+  }
+  else {
+    ctl_error(client, "unknown request");
+    return 0;
+  }
+
+  ctl_send(client, &out);
+  out_free(&out);
+  return 0;
+}
+
+/* Launches a command line, counting the result.  Returns the PID or -1. */
+static pid_t ctl_submit(char *line) {
+  pid_t pid = shell_launch(line);
+  if(pid == -1) {
+    rejected++;
+  }
+  else {
+    submitted++;
+  }
+  return pid;
+}
+
+/* Sends OK <n> followed by the data lines in out */
+static void ctl_send(Ctl_client_s *client, Ctl_out_s *out) {
+  char header[32] = {0};
+  int len = snprintf(header, sizeof(header), "OK %d\n", out->lines);
+  if(send(client->fd, header, len, MSG_NOSIGNAL) != len) {
+    return;
+  }
+
+  size_t sent = 0;
+  while(sent < out->len) {
+    ssize_t ret = send(client->fd, out->data + sent, out->len - sent, MSG_NOSIGNAL);
+    if(ret == -1) {
+      if(errno == EINTR) {
+        continue;
+      }
+      return;
+    }
+    sent += ret;
+  }
+}
+
+/* Sends ERR <reason> */
+static void ctl_error(Ctl_client_s *client, char *reason) {
+  dprintf(client->fd, "ERR %s\n", reason);
+}
+
+/* Appends one formatted data line to out */
+static void out_printf(Ctl_out_s *out, const char *fmt, ...) {
+  va_list ap;
+  va_start(ap, fmt);
+  int need = vsnprintf(NULL, 0, fmt, ap);
+  va_end(ap);
+
+  if(out->len + need + 1 > out->cap) {
+    size_t cap = out->cap ? out->cap * 2 : 1024;
+    while(cap < out->len + need + 1) {
+      cap *= 2;
+    }
+    char *data = realloc(out->data, cap);
+    if(data == NULL) {
+      ABORT_ERROR("Failed to Allocate Memory for a Control Socket Response");
+    }
+    out->data = data;
+    out->cap = cap;
+  }
+
+  va_start(ap, fmt);
+  vsnprintf(out->data + out->len, need + 1, fmt, ap);
+  va_end(ap);
+  out->len += need;
+  out->lines++;
+}
+
+/* Frees a response buffer and resets it to empty */
+static void out_free(Ctl_out_s *out) {
+  free(out->data);
+  memset(out, 0, sizeof(Ctl_out_s));
+}
+
+/* Converts a base-10 argument.  Returns -1 on error. */
+static long extract_long(char *str) {
+  if(str == NULL || *str == '\0') {
+    return -1;
+  }
+  char *end = NULL;
+  long value = strtol(str, &end, 10);
+  if(*end != '\0') {
+    return -1;
+  }
+  return value;
+}
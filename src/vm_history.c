@@ -0,0 +1,286 @@
+/* Standard Library Includes */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <time.h>
+/* Linux System API Includes */
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+/* StrawHat VM Includes */
+#include "vm.h"
+#include "vm_history.h"
+#include "vm_support.h"
+#include "vm_settings.h"
+
+/* Local Definitions */
+#define HISTORY_MAGIC   "SHVMHIST"
+#define HISTORY_VERSION 1
+#define HISTORY_PROBE   16 // Records a command may be kept in, counting on from its hash
+#define HISTORY_CMD     40 // Start of the command line kept for show
+
+/* One command, as stored in the file */
+typedef struct history_record {
+  unsigned long long hash;     // Of the command line, 0 for an unused record
+  unsigned long long cpu_usec; // Average CPU time per run
+  unsigned int wall_ms;        // Average wall time per run, from launch to exit
+  unsigned int runs;           // Runs recorded (the averages count the first one in full)
+  unsigned int used;           // header->clock when it was last updated, so the stalest goes first
+  char cmd[HISTORY_CMD];
+} History_record_s;
+
+/* Start of the file */
+typedef struct history_header {
+  char magic[8];
+  unsigned int version;
+  unsigned int slots;
+  unsigned int clock;          // Runs recorded over the file's lifetime
+} History_header_s;
+
+/* One process being timed (never stored) */
+typedef struct history_run {
+  pid_t pid;
+  unsigned long long hash;
+  struct timespec start;
+  char cmd[HISTORY_CMD];
+  int next;                    // Next run in the same hash bucket (or on the free list)
+} History_run_s;
+
+/* The Mapping */
+static History_header_s *header = NULL;
+static History_record_s *records = NULL;
+static size_t map_size = 0;
+static char history_path[MAX_PATH] = "";
+
+/* Processes being timed */
+static History_run_s runs[HISTORY_RUNS];
+static int run_buckets[HISTORY_RUNS]; // pid -> run index
+static int run_free = -1;
+
+/* Local Prototypes */
+static unsigned long long hash_command(char **argv, char *cmd, size_t size);
+static int find_record(unsigned long long hash);
+static int claim_record(unsigned long long hash);
+static int take_run(pid_t pid);
+
+/* Maps the history file, creating it if needed (an unusable one is started again, empty).
+ * Returns 0 on success or -1 if there's no history (the VM still runs without one).
+ */
+int history_open(const char *path) {
+  for(int i = 0; i < HISTORY_RUNS; i++) {
+    run_buckets[i] = -1;
+    runs[i].next = (i + 1 < HISTORY_RUNS) ? i + 1 : -1;
+  }
+  run_free = 0;
+  map_size = sizeof(History_header_s) + sizeof(History_record_s) * HISTORY_SLOTS;
+  snprintf(history_path, sizeof(history_path), "%s", path);
+
+  int fd = open(path, O_RDWR | O_CREAT | O_CLOEXEC, S_IRUSR | S_IWUSR);
+  if(fd == -1) {
+    PRINT_WARNING("Could not open the runtime history %s: %s", path, strerror(errno));
+    return -1;
+  }
+
+  History_header_s old = {0};
+  struct stat st = {0};
+  fstat(fd, &st);
+  int valid = (size_t)st.st_size == map_size &&
+              pread(fd, &old, sizeof(old), 0) == sizeof(old) &&
+              memcmp(old.magic, HISTORY_MAGIC, sizeof(old.magic)) == 0 &&
+              old.version == HISTORY_VERSION && old.slots == HISTORY_SLOTS;
+  if(!valid && st.st_size > 0) {
+    PRINT_WARNING("Discarding the runtime history in %s (not one this shvm can read)", path);
+  }
+  if(!valid && (ftruncate(fd, 0) == -1 || ftruncate(fd, map_size) == -1)) {
+    PRINT_WARNING("Could not size the runtime history %s: %s", path, strerror(errno));
+    close(fd);
+    return -1;
+  }
+
+  void *map = mmap(NULL, map_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+  close(fd);
+  if(map == MAP_FAILED) {
+    PRINT_WARNING("Could not map the runtime history %s: %s", path, strerror(errno));
+    return -1;
+  }
+  header = map;
+  records = (History_record_s *)(header + 1);
+  if(!valid) {
+    memcpy(header->magic, HISTORY_MAGIC, sizeof(header->magic));
+    header->version = HISTORY_VERSION;
+    header->slots = HISTORY_SLOTS;
+  }
+  return 0;
+}
+
+/* Starts timing a newly launched process.
+ * Returns the CPU time (usec) its command has averaged, or -1 if it has never been seen to finish.
+ */
+long long history_start(pid_t pid, char **argv) {
+  if(header == NULL) {
+    return -1;
+  }
+  char cmd[HISTORY_CMD];
+  unsigned long long hash = hash_command(argv, cmd, sizeof(cmd));
+
+  if(run_free == -1) {
+    PRINT_DEBUG("Too many processes being timed, PID %d won't be recorded", pid);
+  }
+  else {
+    int index = run_free;
+    History_run_s *run = &runs[index];
+    run_free = run->next;
+    run->pid = pid;
+    run->hash = hash;
+    clock_gettime(CLOCK_MONOTONIC, &run->start);
+    memcpy(run->cmd, cmd, sizeof(run->cmd));
+    run->next = run_buckets[pid % HISTORY_RUNS];
+    run_buckets[pid % HISTORY_RUNS] = index;
+  }
+
+  int found = find_record(hash);
+  return (found == -1 || records[found].runs == 0) ? -1 : (long long)records[found].cpu_usec;
+}
+
+/* Stops timing a process.  With success, its command's averages are updated with this run:
+ * cpu_usec (-1 if it couldn't be measured) and the wall time since history_start.
+ */
+void history_finish(pid_t pid, long long cpu_usec, int success) {
+  int index = take_run(pid);
+  if(index == -1 || header == NULL || !success || cpu_usec < 0) {
+    return;
+  }
+  History_run_s *run = &runs[index];
+  struct timespec now;
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  long long wall_ms = (now.tv_sec - run->start.tv_sec) * 1000LL + (now.tv_nsec - run->start.tv_nsec) / 1000000;
+
+  int slot = claim_record(run->hash);
+  History_record_s *record = &records[slot];
+  if(record->hash != run->hash || record->runs == 0) {
+    memset(record, 0, sizeof(*record));
+    record->hash = run->hash;
+    record->cpu_usec = cpu_usec;
+    record->wall_ms = wall_ms;
+    memcpy(record->cmd, run->cmd, sizeof(record->cmd));
+  }
+  else {
+    record->cpu_usec = (long long)record->cpu_usec + (cpu_usec - (long long)record->cpu_usec) / 4;
+    record->wall_ms = (long long)record->wall_ms + (wall_ms - (long long)record->wall_ms) / 4;
+  }
+  record->runs++;
+  record->used = ++header->clock;
+  PRINT_DEBUG("History: %s now averages %llu usec CPU, %u ms wall over %u runs",
+      record->cmd, record->cpu_usec, record->wall_ms, record->runs);
+}
+
+/* Prints how many commands are remembered, and the ones run most */
+void print_history() {
+  if(header == NULL) {
+    PRINT_STATUS("History: none (no runtime history file)");
+    return;
+  }
+  int count = 0;
+  int top[3] = {-1, -1, -1};
+  for(int i = 0; i < HISTORY_SLOTS; i++) {
+    if(records[i].runs == 0) {
+      continue;
+    }
+    count++;
+    for(int j = 0; j < 3; j++) {
+      if(top[j] == -1 || records[i].runs > records[top[j]].runs) {
+        memmove(&top[j + 1], &top[j], sizeof(top[0]) * (2 - j));
+        top[j] = i;
+        break;
+      }
+    }
+  }
+  PRINT_STATUS("History: %d command%s remembered in %s (%u runs recorded)",
+      count, count == 1 ? "" : "s", history_path, header->clock);
+  for(int j = 0; j < 3 && top[j] != -1; j++) {
+    History_record_s *record = &records[top[j]];
+    PRINT_STATUS("     %-40.40s Runs: %6u, CPU: %9.3f sec, Wall: %9.3f sec",
+        record->cmd, record->runs, record->cpu_usec / 1000000.0, record->wall_ms / 1000.0);
+  }
+}
+
+/* Unmaps the history (the file stays behind for the next shvm) */
+void history_close() {
+  if(header != NULL) {
+    munmap(header, map_size);
+    header = NULL;
+    records = NULL;
+  }
+}
+
+/* Hashes a command line (FNV-1a, never 0), keeping the start of it in cmd */
+static unsigned long long hash_command(char **argv, char *cmd, size_t size) {
+  unsigned long long hash = 14695981039346656037ULL;
+  size_t len = 0;
+  cmd[0] = '\0';
+  for(int i = 0; i < MAX_ARGS && argv[i] != NULL; i++) {
+    for(const char *c = argv[i]; ; c++) {
+      char ch = *c ? *c : ' '; // Each argument ends with a space, so "a b" and "ab" differ
+      hash = (hash ^ (unsigned char)ch) * 1099511628211ULL;
+      if(len + 1 < size && (*c || (i + 1 < MAX_ARGS && argv[i + 1] != NULL))) {
+        cmd[len++] = ch;
+        cmd[len] = '\0';
+      }
+      if(*c == '\0') {
+        break;
+      }
+    }
+  }
+  return hash ? hash : 1;
+}
+
+/* Returns the index of the record for this hash, or -1 if there is none */
+static int find_record(unsigned long long hash) {
+  for(int i = 0; i < HISTORY_PROBE; i++) {
+    int slot = (hash + i) & (HISTORY_SLOTS - 1);
+    if(records[slot].hash == hash) {
+      return slot;
+    }
+  }
+  return -1;
+}
+
+/* Returns the record for this hash if there is one, or else the one it should replace:
+ * an unused record if any, or the one updated least recently.
+ */
+static int claim_record(unsigned long long hash) {
+  int found = find_record(hash);
+  if(found != -1) {
+    return found;
+  }
+  int stalest = hash & (HISTORY_SLOTS - 1);
+  for(int i = 0; i < HISTORY_PROBE; i++) {
+    int slot = (hash + i) & (HISTORY_SLOTS - 1);
+    if(records[slot].hash == 0) {
+      return slot;
+    }
+    if(records[slot].used < records[stalest].used) {
+      stalest = slot;
+    }
+  }
+  return stalest;
+}
+
+/* Unlinks the run timing this pid.  Returns its index (valid until the next history_start), or -1. */
+static int take_run(pid_t pid) {
+  int *link = &run_buckets[pid % HISTORY_RUNS];
+  while(*link != -1 && runs[*link].pid != pid) {
+    link = &runs[*link].next;
+  }
+  int index = *link;
+  if(index == -1) {
+    return -1;
+  }
+  *link = runs[index].next;
+  runs[index].next = run_free;
+  run_free = index;
+  return index;
+}
@@ -0,0 +1,286 @@
+/* Standard Library Includes */
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdarg.h>
+#include <string.h>
+#include <strings.h>
+#include <errno.h>
+#include <limits.h>
+/* Linux System API Includes */
+#include <signal.h>
+#include <unistd.h>
+#include <sched.h>
+#include <semaphore.h>
+#include <pthread.h>
+#include <sys/types.h>
+#include <sys/uio.h>
+/* StrawHat VM Includes */
+#include "vm.h"
+#include "vm_log.h"
+#include "vm_settings.h"
+#include "vm_printing.h"
+
+/* Local Definitions */
+#define LOG_ENTRY_LEN  (MAX_STATUS + 64) // Room for the message plus its tag and colors
+#define LOG_BATCH_IOVS 64                // Most entries handed to a single writev
+
+/* One formatted message */
+typedef struct log_entry {
+  int len;
+  char text[LOG_ENTRY_LEN];
+} Log_entry_s;
+
+/* Single-producer (the owning thread), single-consumer (the writer) ring of messages.
+ * - tail is only written by the producer, head only by the writer.
+ */
+typedef struct log_ring {
+  Log_entry_s slots[LOG_RING_SLOTS];
+  unsigned int head; // Next slot the writer will drain
+  unsigned int tail; // Next slot the producer will fill
+} Log_ring_s;
+
+/* Project Globals */
+int g_log_level = DEFAULT_LOG_LEVEL;
+
+/* Writer State */
+static Log_ring_s rings[LOG_MAX_RINGS];
+static int ring_count = 0;           // Rings handed out by log_thread_async
+static int log_running = 0;          // 1 while the writer thread is draining rings
+static pid_t log_pid = 0;            // Forked children must never use the rings
+static int log_color = -1;           // -1 until stdout has been checked for a terminal
+static sem_t log_sem;                // Posted once per queued message
+static pthread_t pt_log;
+
+static __thread Log_ring_s *my_ring = NULL; // This thread's ring, or NULL to log directly
+static __thread int in_log = 0;             // Set while filling a slot, so a signal handler logs directly
+
+/* Local Prototypes */
+static int format_entry(char *buf, int level, const char *fmt, va_list args);
+static void *log_thread(void *args);
+static int drain_rings();
+static void write_all(struct iovec *iov, int count);
+
+/* Formats a message with its level tag into buf (LOG_ENTRY_LEN bytes).
+ * Returns the length of the formatted message.
+ */
+static int format_entry(char *buf, int level, const char *fmt, va_list args) {
+  static const char *tags[] = { "[DEBUG ]", "[Info ]", "[Status]", "[Warn  ]" };
+  static const char *colors[] = { CYAN, GREEN, YELLOW, MAGENTA };
+
+  if(log_color == -1) {
+    log_color = isatty(STDOUT_FILENO);
+  }
+  const char *tag_color = log_color ? colors[level] : "";
+  const char *text_color = log_color ? YELLOW : "";
+  const char *reset = log_color ? RST : "";
+
+  // Leave room at the end for the reset and newline, even if the message is truncated.
+  int room = LOG_ENTRY_LEN - (int)strlen(reset) - 2;
+  int len = snprintf(buf, room, "  %s%s%s ", tag_color, tags[level], text_color);
+  int body = vsnprintf(buf + len, room - len, fmt, args);
+  len = (body < 0) ? len : (len + body < room ? len + body : room - 1);
+  len += sprintf(buf + len, "%s\n", reset);
+  return len;
+}
+
+/* Logs one message at the given level.
+ * - Level filtering is done by the PRINT_* macros before the arguments are even evaluated.
+ */
+void vm_log(int level, const char *fmt, ...) {
+  va_list args;
+  va_start(args, fmt);
+
+  // Queue it for the writer if this thread has a ring and we're not re-entering from a handler.
+  Log_ring_s *ring = my_ring;
+  if(ring && !in_log && __atomic_load_n(&log_running, __ATOMIC_ACQUIRE) && getpid() == log_pid) {
+    in_log = 1;
+    unsigned int tail = ring->tail;
+    // If the ring is full, nudge the writer and wait for a free slot.
+    while(tail - __atomic_load_n(&ring->head, __ATOMIC_ACQUIRE) >= LOG_RING_SLOTS) {
+      if(!__atomic_load_n(&log_running, __ATOMIC_ACQUIRE)) {
+        break;
+      }
+      sem_post(&log_sem);
+      sched_yield();
+    }
+    if(tail - __atomic_load_n(&ring->head, __ATOMIC_ACQUIRE) < LOG_RING_SLOTS) {
+      Log_entry_s *entry = &ring->slots[tail % LOG_RING_SLOTS];
+      entry->len = format_entry(entry->text, level, fmt, args);
+      __atomic_store_n(&ring->tail, tail + 1, __ATOMIC_RELEASE);
+      sem_post(&log_sem);
+      in_log = 0;
+      va_end(args);
+      return;
+    }
+    in_log = 0;
+  }
+
+  // Otherwise write it directly with one stdio call, so it stays in order with printf output.
+  char buf[LOG_ENTRY_LEN];
+  format_entry(buf, level, fmt, args);
+  fputs(buf, stdout);
+  va_end(args);
+}
+
+/* Starts the background writer.  Until this is called, every message is written directly.
+ * - Call from the main thread before creating any thread that uses log_thread_async.
+ */
+void log_start() {
+  if(log_running) {
+    return;
+  }
+  if(sem_init(&log_sem, 0, 0) == -1) {
+    return; // Everything just keeps logging directly.
+  }
+  log_pid = getpid();
+
+  // The writer never handles signals; they belong to the shell and CS threads.
+  sigset_t mask, old_mask;
+  sigfillset(&mask);
+  pthread_sigmask(SIG_BLOCK, &mask, &old_mask);
+  __atomic_store_n(&log_running, 1, __ATOMIC_RELEASE);
+  if(pthread_create(&pt_log, NULL, &log_thread, NULL) != 0) {
+    __atomic_store_n(&log_running, 0, __ATOMIC_RELEASE);
+  }
+  pthread_sigmask(SIG_SETMASK, &old_mask, NULL);
+}
+
+/* Drains every queued message and stops the writer.  Registered with atexit */
+void log_stop() {
+  if(!log_running || getpid() != log_pid) {
+    return;
+  }
+  __atomic_store_n(&log_running, 0, __ATOMIC_RELEASE);
+  sem_post(&log_sem);
+  pthread_join(pt_log, NULL);
+  drain_rings(); // Anything queued while the writer was exiting
+  fflush(stdout);
+}
+
+/* Waits until the writer has written out every message queued so far. */
+void log_flush() {
+  int count = __atomic_load_n(&ring_count, __ATOMIC_ACQUIRE);
+  if(count > LOG_MAX_RINGS) {
+    count = LOG_MAX_RINGS;
+  }
+  for(int i = 0; i < count; i++) {
+    unsigned int tail = __atomic_load_n(&rings[i].tail, __ATOMIC_ACQUIRE);
+    while(__atomic_load_n(&log_running, __ATOMIC_ACQUIRE) &&
+          (int)(tail - __atomic_load_n(&rings[i].head, __ATOMIC_ACQUIRE)) > 0) {
+      sem_post(&log_sem);
+      sched_yield();
+    }
+  }
+}
+
+/* Gives the calling thread its own ring, so its messages no longer block on terminal I/O.
+ * - Once all LOG_MAX_RINGS are handed out, later threads keep logging directly.
+ */
+void log_thread_async() {
+  if(my_ring != NULL) {
+    return;
+  }
+  int index = __atomic_fetch_add(&ring_count, 1, __ATOMIC_ACQ_REL);
+  if(index < LOG_MAX_RINGS) {
+    my_ring = &rings[index];
+  }
+}
+
+/* Converts a level name (debug, info, status, warn) to its level.
+ * Returns the level, or -1 if the name is not recognized.
+ */
+int log_level_from_string(const char *str) {
+  for(int level = LOG_DEBUG; level <= LOG_WARN; level++) {
+    if(strcasecmp(str, log_level_name(level)) == 0) {
+      return level;
+    }
+  }
+  return -1;
+}
+
+/* Returns the name of a level */
+const char *log_level_name(int level) {
+  static const char *names[] = { "debug", "info", "status", "warn" };
+  if(level < LOG_DEBUG || level > LOG_WARN) {
+    return "unknown";
+  }
+  return names[level];
+}
+
+/* Writer Thread Function: sleeps until messages are queued, then writes them out in batches */
+static void *log_thread(void *args) {
+  while(1) {
+    while(sem_wait(&log_sem) == -1 && errno == EINTR) {
+      continue;
+    }
+    // Soak up the posts for everything we're about to drain in one go.
+    while(sem_trywait(&log_sem) == 0) {
+      continue;
+    }
+    drain_rings();
+    if(!__atomic_load_n(&log_running, __ATOMIC_ACQUIRE)) {
+      break;
+    }
+  }
+  pthread_exit(0);
+}
+
+/* Writes out everything currently queued in every ring.
+ * Returns the number of messages written.
+ */
+static int drain_rings() {
+  struct iovec iov[LOG_BATCH_IOVS];
+  int written = 0;
+  int count = __atomic_load_n(&ring_count, __ATOMIC_ACQUIRE);
+  if(count > LOG_MAX_RINGS) {
+    count = LOG_MAX_RINGS;
+  }
+
+  for(int i = 0; i < count; i++) {
+    Log_ring_s *ring = &rings[i];
+    unsigned int head = ring->head;
+    unsigned int tail = __atomic_load_n(&ring->tail, __ATOMIC_ACQUIRE);
+
+    while(head != tail) {
+      int batch = 0;
+      while(head + batch != tail && batch < LOG_BATCH_IOVS) {
+        Log_entry_s *entry = &ring->slots[(head + batch) % LOG_RING_SLOTS];
+        iov[batch].iov_base = entry->text;
+        iov[batch].iov_len = entry->len;
+        batch++;
+      }
+      // Hold stdout so direct messages and printf output can't land in the middle of the batch.
+      flockfile(stdout);
+      fflush(stdout);
+      write_all(iov, batch);
+      funlockfile(stdout);
+
+      head += batch;
+      written += batch;
+      __atomic_store_n(&ring->head, head, __ATOMIC_RELEASE);
+    }
+  }
+  return written;
+}
+
+/* writev that carries on after short writes and interruptions */
+static void write_all(struct iovec *iov, int count) {
+  while(count > 0) {
+    ssize_t done = writev(STDOUT_FILENO, iov, count);
+    if(done == -1) {
+      if(errno == EINTR) {
+        continue;
+      }
+      return; // Nowhere left to log to
+    }
+    while(count > 0 && (size_t)done >= iov->iov_len) {
+      done -= iov->iov_len;
+      iov++;
+      count--;
+    }
+    if(count > 0) {
+      iov->iov_base = (char *)iov->iov_base + done;
+      iov->iov_len -= done;
+    }
+  }
+}
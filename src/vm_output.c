@@ -0,0 +1,297 @@
+#define _GNU_SOURCE // pipe2
+/* Standard Library Includes */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+/* Linux System API Includes */
+#include <signal.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <sys/types.h>
+#include <sys/uio.h>
+#include <sys/epoll.h>
+/* StrawHat VM Includes */
+#include "vm.h"
+#include "vm_output.h"
+#include "vm_support.h"
+#include "vm_settings.h"
+
+/* Local Definitions */
+#define OUTPUT_WAKE     OUTPUT_SLOTS // epoll tag of the wake pipe (slots are tagged with their index)
+#define OUTPUT_EVENTS   64           // Most ready pipes handled per epoll_wait
+#define OUTPUT_READS     4           // Most reads from one pipe before moving on to the next
+
+/* One process' output
+ * - pid is 0 while the slot is free, and -1 between output_prepare and output_attach.
+ */
+typedef struct output_slot {
+  pid_t pid;
+  int fd;                 // Read end of its pipe, -1 once every writer has closed it
+  char *ring;             // OUTPUT_RING_BYTES, allocated the first time the slot is used
+  size_t head;            // Offset of the oldest byte kept
+  size_t len;             // Bytes kept
+  long long total;        // Bytes written
+  unsigned long seq;      // Launch order, the latest wins if a pid is reused
+  unsigned long closed;   // Close order once done (0 while still being written)
+} Output_slot_s;
+
+/* Capture State
+ * - Slots are only claimed under the shell's Launch Guard; output_m keeps them consistent with the
+ *   reader thread and whoever shows them.
+ */
+static pthread_mutex_t output_m = PTHREAD_MUTEX_INITIALIZER;
+static Output_slot_s slots[OUTPUT_SLOTS];
+static int capture = DEFAULT_CAPTURE; // 1 captures the output of new launches
+static int output_running = 0;        // 1 while the reader thread is up
+static int epoll_fd = -1;
+static int wake_pipe[2] = { -1, -1 };
+static pthread_t pt_output;
+static int pending = -1;              // Slot claimed by output_prepare
+static int pending_write = -1;        // and the write end handed to the launch
+static unsigned long launch_seq = 0;
+static unsigned long close_seq = 0;
+static long long total_dropped = 0;   // Bytes overwritten, over every slot ever used
+static long to_terminal = 0;          // Launches left on the terminal, every slot being written
+
+/* Local Prototypes */
+static void *output_thread(void *args);
+static void drain_slot(int index);
+static void reset_slot(Output_slot_s *slot);
+
+/* Starts the reader thread.  Until this is called (or if it fails), processes write to the terminal.
+ * Returns 0 on success, or -1 on any error.
+ */
+int output_start() {
+  if(output_running) {
+    return 0;
+  }
+  epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+  if(epoll_fd == -1 || pipe2(wake_pipe, O_CLOEXEC | O_NONBLOCK) == -1) {
+    PRINT_WARNING("Could not set up output capture (%s), processes write to the terminal", strerror(errno));
+    return -1;
+  }
+  struct epoll_event ev = {0};
+  ev.events = EPOLLIN;
+  ev.data.u32 = OUTPUT_WAKE;
+  epoll_ctl(epoll_fd, EPOLL_CTL_ADD, wake_pipe[0], &ev);
+
+  // The reader never handles signals; they belong to the shell and CS threads.
+  sigset_t mask, old_mask;
+  sigfillset(&mask);
+  pthread_sigmask(SIG_BLOCK, &mask, &old_mask);
+  __atomic_store_n(&output_running, 1, __ATOMIC_RELEASE);
+  if(pthread_create(&pt_output, NULL, &output_thread, NULL) != 0) {
+    __atomic_store_n(&output_running, 0, __ATOMIC_RELEASE);
+    PRINT_WARNING("Could not start the output reader, processes write to the terminal");
+  }
+  pthread_sigmask(SIG_SETMASK, &old_mask, NULL);
+  return output_running ? 0 : -1;
+}
+
+/* Claims a slot for the next launch.  Call under the Launch Guard, and follow with output_attach.
+ * - A free slot first, then the one whose process finished longest ago.
+ * Returns the fd the process should write to, or -1 to leave it on the terminal.
+ */
+int output_prepare() {
+  if(!__atomic_load_n(&output_running, __ATOMIC_ACQUIRE)) {
+    return -1;
+  }
+  pthread_mutex_lock(&output_m);
+  int index = -1;
+  for(int i = 0; i < OUTPUT_SLOTS && capture; i++) {
+    if(slots[i].pid == 0) {
+      index = i;
+      break;
+    }
+    if(slots[i].pid > 0 && slots[i].closed && (index == -1 || slots[i].closed < slots[index].closed)) {
+      index = i;
+    }
+  }
+  if(index == -1) {
+    to_terminal += capture;
+    pthread_mutex_unlock(&output_m);
+    return -1;
+  }
+  Output_slot_s *slot = &slots[index];
+  if(slot->ring == NULL) {
+    slot->ring = malloc(OUTPUT_RING_BYTES);
+  }
+  int p[2];
+  if(slot->ring == NULL || pipe2(p, O_CLOEXEC) == -1) {
+    pthread_mutex_unlock(&output_m);
+    return -1;
+  }
+  fcntl(p[0], F_SETFL, fcntl(p[0], F_GETFL) | O_NONBLOCK);
+  reset_slot(slot);
+  slot->pid = -1;
+  slot->fd = p[0];
+  pending = index;
+  pending_write = p[1];
+  pthread_mutex_unlock(&output_m);
+  return p[1];
+}
+
+/* Gives the slot claimed by output_prepare to the process just launched (pid <= 0 if it failed) */
+void output_attach(pid_t pid) {
+  if(pending == -1) {
+    return;
+  }
+  close(pending_write); // Only the process holds the write end now
+  pthread_mutex_lock(&output_m);
+  Output_slot_s *slot = &slots[pending];
+  if(pid <= 0) {
+    close(slot->fd);
+    reset_slot(slot);
+  }
+  else {
+    slot->pid = pid;
+    slot->seq = ++launch_seq;
+    struct epoll_event ev = {0};
+    ev.events = EPOLLIN;
+    ev.data.u32 = pending;
+    epoll_ctl(epoll_fd, EPOLL_CTL_ADD, slot->fd, &ev);
+  }
+  pthread_mutex_unlock(&output_m);
+  pending = -1;
+  pending_write = -1;
+}
+
+/* Copies the newest output kept for a process, up to size bytes, into buf.
+ * - info (if not NULL) gets how much it has written, and whether it's still writing.
+ * Returns the number of bytes copied, or -1 if none of its output was captured.
+ */
+long output_copy(pid_t pid, char *buf, size_t size, Output_info_s *info) {
+  pthread_mutex_lock(&output_m);
+  int index = -1;
+  for(int i = 0; i < OUTPUT_SLOTS; i++) {
+    if(pid > 0 && slots[i].pid == pid && (index == -1 || slots[i].seq > slots[index].seq)) {
+      index = i;
+    }
+  }
+  if(index == -1) {
+    pthread_mutex_unlock(&output_m);
+    return -1;
+  }
+  Output_slot_s *slot = &slots[index];
+  size_t count = (slot->len < size) ? slot->len : size;
+  size_t start = (slot->head + slot->len - count) % OUTPUT_RING_BYTES;
+  size_t first = (start + count > OUTPUT_RING_BYTES) ? OUTPUT_RING_BYTES - start : count;
+  memcpy(buf, slot->ring + start, first);
+  memcpy(buf + first, slot->ring, count - first);
+  if(info != NULL) {
+    info->total = slot->total;
+    info->dropped = slot->total - (long long)slot->len;
+    info->writing = (slot->fd != -1);
+  }
+  pthread_mutex_unlock(&output_m);
+  return count;
+}
+
+/* Sets whether new launches have their output captured (1) or write to the terminal (0) */
+void output_set_capture(int on) {
+  pthread_mutex_lock(&output_m);
+  capture = on;
+  pthread_mutex_unlock(&output_m);
+}
+
+/* Prints whether output is captured, and how much is kept and was dropped */
+void print_output() {
+  int writing = 0, kept = 0;
+  long long bytes = 0;
+  pthread_mutex_lock(&output_m);
+  for(int i = 0; i < OUTPUT_SLOTS; i++) {
+    if(slots[i].pid > 0) {
+      kept++;
+      writing += (slots[i].fd != -1);
+      bytes += slots[i].len;
+    }
+  }
+  PRINT_STATUS("Output: %s (%d KB kept per process, the newest %d processes)",
+      !output_running ? "to the terminal (capture is unavailable)" : (capture ? "captured" : "to the terminal"),
+      OUTPUT_RING_BYTES / 1024, OUTPUT_SLOTS);
+  PRINT_STATUS("     Kept: %d (%d still writing), %lld KB; Dropped: %lld KB; Sent to the terminal, every slot busy: %ld",
+      kept, writing, bytes / 1024, total_dropped / 1024, to_terminal);
+  pthread_mutex_unlock(&output_m);
+}
+
+/* Stops the reader thread; whatever is still in the pipes is left there */
+void output_stop() {
+  if(!__atomic_load_n(&output_running, __ATOMIC_ACQUIRE)) {
+    return;
+  }
+  __atomic_store_n(&output_running, 0, __ATOMIC_RELEASE);
+  char c = 0;
+  if(write(wake_pipe[1], &c, 1) == 1) {
+    pthread_join(pt_output, NULL);
+  }
+}
+
+/* Reader Thread Function: moves whatever arrives on any pipe into its slot's ring */
+static void *output_thread(void *args) {
+  struct epoll_event events[OUTPUT_EVENTS];
+  while(__atomic_load_n(&output_running, __ATOMIC_ACQUIRE)) {
+    int n = epoll_wait(epoll_fd, events, OUTPUT_EVENTS, -1);
+    for(int i = 0; i < n; i++) {
+      if(events[i].data.u32 == OUTPUT_WAKE) {
+        char c;
+        while(read(wake_pipe[0], &c, 1) == 1) {
+          continue;
+        }
+      }
+      else {
+        drain_slot(events[i].data.u32);
+      }
+    }
+  }
+  pthread_exit(0);
+}
+
+/* Reads a slot's pipe straight into its ring, overwriting the oldest bytes once it's full */
+static void drain_slot(int index) {
+  pthread_mutex_lock(&output_m);
+  Output_slot_s *slot = &slots[index];
+  for(int reads = 0; reads < OUTPUT_READS && slot->fd != -1; reads++) {
+    // Everything after the newest byte, wrapping around over the oldest
+    size_t tail = (slot->head + slot->len) % OUTPUT_RING_BYTES;
+    struct iovec iov[2] = {
+      { slot->ring + tail, OUTPUT_RING_BYTES - tail },
+      { slot->ring, tail }
+    };
+    ssize_t got = readv(slot->fd, iov, 2);
+    if(got > 0) {
+      slot->total += got;
+      if(slot->len + got > OUTPUT_RING_BYTES) {
+        total_dropped += slot->len + got - OUTPUT_RING_BYTES;
+        slot->head = (tail + got) % OUTPUT_RING_BYTES;
+        slot->len = OUTPUT_RING_BYTES;
+      }
+      else {
+        slot->len += got;
+      }
+    }
+    else if(got == 0 || (errno != EAGAIN && errno != EINTR)) {
+      // Every writer has closed its end: the process (and anything it forked) is done
+      epoll_ctl(epoll_fd, EPOLL_CTL_DEL, slot->fd, NULL);
+      close(slot->fd);
+      slot->fd = -1;
+      slot->closed = ++close_seq;
+    }
+    else {
+      break;
+    }
+  }
+  pthread_mutex_unlock(&output_m);
+}
+
+/* Empties a slot, keeping its ring for the next process (output_m held) */
+static void reset_slot(Output_slot_s *slot) {
+  slot->pid = 0;
+  slot->fd = -1;
+  slot->head = 0;
+  slot->len = 0;
+  slot->total = 0;
+  slot->seq = 0;
+  slot->closed = 0;
+}
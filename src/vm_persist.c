@@ -0,0 +1,496 @@
+/* Standard Library Includes */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <limits.h>
+/* Linux System API Includes */
+#include <signal.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+/* StrawHat VM Includes */
+#include "vm.h"
+#include "vm_persist.h"
+#include "vm_support.h"
+#include "vm_settings.h"
+#include "otur_sched.h"
+
+/* Local Definitions */
+#define PERSIST_MAGIC   "SHVMSNAP"
+#define PERSIST_VERSION 1
+#define PERSIST_NIL     (-1)                // End of a list, or an empty hash bucket
+#define PERSIST_BUCKETS (PERSIST_SLOTS * 2) // Power of two, so the hash can mask
+#define STARTTIME_UNKNOWN ULLONG_MAX        // /proc/<pid>/stat couldn't be read (or parsed)
+
+/* One tracked process, as stored in the file */
+typedef struct persist_record {
+  pid_t pid;
+  unsigned short state;        // Low 16 bits of the process' state word (OTUR_STATE_LOW)
+  unsigned char where;         // PERSIST_CPU ... PERSIST_DEFUNCT, or PERSIST_FREE
+  unsigned char adopted;       // 1 if this process was re-adopted by --recover
+  int age;
+  int prev;                    // Record indexes of the neighbours in the same list
+  int next;
+  unsigned long long starttime; // From /proc/<pid>/stat, so a reused PID is never adopted
+  char cmd[MAX_CMD_LINE];
+} Persist_record_s;
+
+/* Start of the file */
+typedef struct persist_header {
+  char magic[8];
+  unsigned int version;
+  unsigned int slots;
+  pid_t owner;                  // PID of the shvm using the file, 0 once it has exited
+  unsigned int updates;         // Odd while a record is being changed
+  int head[PERSIST_LISTS];      // Lists are kept in the same order as the Scheduler's Queues
+  int tail[PERSIST_LISTS];
+  int count[PERSIST_LISTS];
+} Persist_header_s;
+
+/* The Mapping */
+static Persist_header_s *header = NULL;
+static Persist_record_s *records = NULL;
+static size_t map_size = 0;
+
+/* Rebuilt from the records on every open, so never stored */
+static int buckets[PERSIST_BUCKETS]; // pid -> record index
+static int free_slots[PERSIST_SLOTS];
+static int free_count = 0;
+static int full_warned = 0;
+
+/* Local Prototypes */
+static void begin_update();
+static void end_update();
+static unsigned int hash_pid(pid_t pid);
+static int hash_find(pid_t pid);
+static void hash_insert(pid_t pid, int index);
+static void hash_remove(pid_t pid);
+static void list_link(int index, int where);
+static void list_unlink(int index);
+static void rebuild_index();
+static int collect_records(Persist_record_s *saved);
+static unsigned long long read_starttime(pid_t pid, char *proc_state);
+static int same_process(pid_t pid, unsigned long long starttime);
+
+/* Maps the snapshot file, creating it if needed.
+ * - Without recover, any earlier snapshot is discarded.
+ * Returns 0 on success or -1 if the snapshot can't be used (the VM still runs without one).
+ */
+int persist_open(const char *path, int recover) {
+  map_size = sizeof(Persist_header_s) + sizeof(Persist_record_s) * PERSIST_SLOTS;
+
+  int fd = open(path, O_RDWR | O_CREAT | O_CLOEXEC, S_IRUSR | S_IWUSR);
+  if(fd == -1) {
+    PRINT_WARNING("Could not open the schedule snapshot %s: %s", path, strerror(errno));
+    return -1;
+  }
+
+  // Check whether what's there already is a snapshot we can use.
+  Persist_header_s old = {0};
+  struct stat st = {0};
+  fstat(fd, &st);
+  int valid = (size_t)st.st_size == map_size &&
+              pread(fd, &old, sizeof(old), 0) == sizeof(old) &&
+              memcmp(old.magic, PERSIST_MAGIC, sizeof(old.magic)) == 0 &&
+              old.version == PERSIST_VERSION && old.slots == PERSIST_SLOTS;
+
+  if(valid && old.owner != 0 && old.owner != getpid() && kill(old.owner, 0) == 0) {
+    PRINT_WARNING("The schedule snapshot %s is in use by PID %d", path, old.owner);
+    close(fd);
+    return -1;
+  }
+  if(recover && !valid) {
+    PRINT_WARNING("No usable schedule snapshot in %s, starting empty", path);
+  }
+  else if(!recover && valid && old.count[PERSIST_CPU] + old.count[PERSIST_HIGH] + old.count[PERSIST_NORMAL] > 0) {
+    PRINT_WARNING("Discarding the schedule snapshot in %s (start with --recover to keep it)", path);
+  }
+
+  // Anything we aren't recovering starts again from a zeroed file.
+  if(!recover || !valid) {
+    if(ftruncate(fd, 0) == -1 || ftruncate(fd, map_size) == -1) {
+      PRINT_WARNING("Could not size the schedule snapshot %s: %s", path, strerror(errno));
+      close(fd);
+      return -1;
+    }
+  }
+
+  void *map = mmap(NULL, map_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+  close(fd);
+  if(map == MAP_FAILED) {
+    PRINT_WARNING("Could not map the schedule snapshot %s: %s", path, strerror(errno));
+    return -1;
+  }
+  header = map;
+  records = (Persist_record_s *)(header + 1);
+
+  if(!recover || !valid) {
+    memcpy(header->magic, PERSIST_MAGIC, sizeof(header->magic));
+    header->version = PERSIST_VERSION;
+    header->slots = PERSIST_SLOTS;
+    for(int i = 0; i < PERSIST_LISTS; i++) {
+      header->head[i] = header->tail[i] = PERSIST_NIL;
+    }
+  }
+  header->owner = getpid();
+  rebuild_index();
+  return 0;
+}
+
+/* Rebuilds the Schedule from the snapshot, re-adopting every process that is still alive.
+ * - Call once, after persist_open(path, 1) and before the CS System is started.
+ * - Processes that were Running are put back into a Ready Queue.
+ * Returns the number of processes adopted, or -1 on any error.
+ */
+int persist_recover(Otur_schedule_s *schedule) {
+  if(header == NULL || schedule == NULL) {
+    return -1;
+  }
+
+  // Copy the records out in Queue order, then start the snapshot again as they're re-tracked.
+  Persist_record_s *saved = malloc(sizeof(Persist_record_s) * (PERSIST_SLOTS - free_count + 1));
+  if(saved == NULL) {
+    return -1;
+  }
+  int total = collect_records(saved);
+
+  begin_update();
+  memset(records, 0, sizeof(Persist_record_s) * PERSIST_SLOTS);
+  for(int i = 0; i < PERSIST_LISTS; i++) {
+    header->head[i] = header->tail[i] = PERSIST_NIL;
+    header->count[i] = 0;
+  }
+  end_update();
+  rebuild_index();
+
+  int adopted = 0;
+  int lost = 0;
+  for(int i = 0; i < total; i++) {
+    Persist_record_s *rec = &saved[i];
+    int is_high = (rec->state & OTUR_HIGH) != 0;
+    int is_critical = (rec->state & OTUR_CRITICAL) != 0;
+    Otur_process_s *node = otur_invoke(rec->pid, is_high, is_critical, rec->cmd);
+    if(node == NULL) {
+      free(saved);
+      return -1;
+    }
+
+    if(rec->where == PERSIST_DEFUNCT) {
+      if(otur_exited(schedule, node, rec->state & OTUR_EXIT_MASK) == -1) {
+        free(saved);
+        return -1;
+      }
+      persist_track(node, PERSIST_DEFUNCT);
+    }
+    else if(same_process(rec->pid, rec->starttime)) {
+      // It may have been left running, so hold it until the Dispatcher picks it again.
+      kill(rec->pid, SIGTSTP);
+      otur_set_age(node, rec->age);
+      if(otur_enqueue(schedule, node) == -1) {
+        free(saved);
+        return -1;
+      }
+      persist_track(node, is_high || is_critical ? PERSIST_HIGH : PERSIST_NORMAL);
+      int index = hash_find(rec->pid);
+      if(index != PERSIST_NIL) {
+        records[index].adopted = 1;
+      }
+      adopted++;
+    }
+    else {
+      if(otur_exited(schedule, node, PERSIST_LOST_EXIT) == -1) {
+        free(saved);
+        return -1;
+      }
+      persist_track(node, PERSIST_DEFUNCT);
+      lost++;
+    }
+  }
+  free(saved);
+
+  PRINT_STATUS("Recovered %d processes: %d adopted, %d finished while away, %d already defunct",
+               total, adopted, lost, total - adopted - lost);
+  return adopted;
+}
+
+/* Records that a process is now in the given list (PERSIST_CPU ... PERSIST_DEFUNCT).
+ * - The first call for a pid creates its record.
+ * - Call after the Scheduler has moved the node, so its state and age are current.
+ */
+void persist_track(Otur_process_s *node, int where) {
+  if(header == NULL || node == NULL) {
+    return;
+  }
+
+  begin_update();
+  int index = hash_find(node->pid);
+  if(index == PERSIST_NIL) {
+    if(free_count == 0) {
+      end_update();
+      if(!full_warned) {
+        PRINT_WARNING("The schedule snapshot is full; PID %d and later processes won't be recoverable", node->pid);
+        full_warned = 1;
+      }
+      return;
+    }
+    index = free_slots[--free_count];
+    Persist_record_s *rec = &records[index];
+    rec->pid = node->pid;
+    rec->adopted = 0;
+    rec->starttime = read_starttime(node->pid, NULL);
+    strncpy(rec->cmd, otur_cmd(node), sizeof(rec->cmd) - 1);
+    rec->cmd[sizeof(rec->cmd) - 1] = '\0';
+    hash_insert(node->pid, index);
+  }
+  else {
+    list_unlink(index);
+  }
+
+  records[index].state = otur_state(node) & OTUR_STATE_LOW;
+  records[index].age = otur_age(node);
+  list_link(index, where);
+  end_update();
+}
+
+/* Drops the record of a process once it has been reaped. */
+void persist_forget(pid_t pid) {
+  if(header == NULL) {
+    return;
+  }
+  int index = hash_find(pid);
+  if(index == PERSIST_NIL) {
+    return;
+  }
+
+  begin_update();
+  list_unlink(index);
+  hash_remove(pid);
+  records[index].where = PERSIST_FREE;
+  records[index].pid = 0;
+  free_slots[free_count++] = index;
+  end_update();
+}
+
+/* Returns 1 if pid was adopted by --recover and hasn't been seen to finish yet, else 0. */
+int persist_adopted(pid_t pid) {
+  if(header == NULL) {
+    return 0;
+  }
+  int index = hash_find(pid);
+  return index != PERSIST_NIL && records[index].adopted && records[index].where != PERSIST_DEFUNCT;
+}
+
+/* Returns 1 if the process recorded for pid is still alive (and is the same process), else 0.
+ * - Needed for adopted processes, which no longer send us SIGCHLD.
+ */
+int persist_alive(pid_t pid) {
+  if(header == NULL) {
+    return 0;
+  }
+  int index = hash_find(pid);
+  if(index == PERSIST_NIL) {
+    return 0;
+  }
+  return same_process(pid, records[index].starttime);
+}
+
+/* Marks the snapshot as no longer in use and unmaps it.  The file is kept for --recover. */
+void persist_close() {
+  if(header == NULL) {
+    return;
+  }
+  header->owner = 0;
+  munmap(header, map_size);
+  header = NULL;
+  records = NULL;
+}
+
+/* Marks the start and end of a change, so a recovery can tell if the lists may be half-linked. */
+static void begin_update() {
+  __atomic_add_fetch(&header->updates, 1, __ATOMIC_SEQ_CST);
+}
+static void end_update() {
+  __atomic_add_fetch(&header->updates, 1, __ATOMIC_SEQ_CST);
+}
+
+/* Multiplicative hash of a pid into a bucket number */
+static unsigned int hash_pid(pid_t pid) {
+  return ((unsigned int)pid * 2654435761u) & (PERSIST_BUCKETS - 1);
+}
+
+/* Returns the record index for pid, or PERSIST_NIL if there is none. */
+static int hash_find(pid_t pid) {
+  for(unsigned int b = hash_pid(pid); buckets[b] != PERSIST_NIL; b = (b + 1) & (PERSIST_BUCKETS - 1)) {
+    if(records[buckets[b]].pid == pid) {
+      return buckets[b];
+    }
+  }
+  return PERSIST_NIL;
+}
+
+static void hash_insert(pid_t pid, int index) {
+  unsigned int b = hash_pid(pid);
+  while(buckets[b] != PERSIST_NIL) {
+    b = (b + 1) & (PERSIST_BUCKETS - 1);
+  }
+  buckets[b] = index;
+}
+
+/* Removes pid, shifting later entries of the probe run back so no tombstones are needed. */
+static void hash_remove(pid_t pid) {
+  unsigned int b = hash_pid(pid);
+  while(buckets[b] != PERSIST_NIL && records[buckets[b]].pid != pid) {
+    b = (b + 1) & (PERSIST_BUCKETS - 1);
+  }
+  buckets[b] = PERSIST_NIL;
+
+  for(unsigned int next = (b + 1) & (PERSIST_BUCKETS - 1); buckets[next] != PERSIST_NIL;
+      next = (next + 1) & (PERSIST_BUCKETS - 1)) {
+    unsigned int home = hash_pid(records[buckets[next]].pid);
+    // Move it back if its home bucket is not between the hole and where it sits now.
+    if(((next - home) & (PERSIST_BUCKETS - 1)) >= ((next - b) & (PERSIST_BUCKETS - 1))) {
+      buckets[b] = buckets[next];
+      buckets[next] = PERSIST_NIL;
+      b = next;
+    }
+  }
+}
+
+/* Appends a record to the tail of a list */
+static void list_link(int index, int where) {
+  Persist_record_s *rec = &records[index];
+  rec->where = where;
+  rec->next = PERSIST_NIL;
+  rec->prev = header->tail[where];
+  if(header->tail[where] == PERSIST_NIL) {
+    header->head[where] = index;
+  }
+  else {
+    records[header->tail[where]].next = index;
+  }
+  header->tail[where] = index;
+  header->count[where]++;
+}
+
+/* Removes a record from whichever list it is in */
+static void list_unlink(int index) {
+  Persist_record_s *rec = &records[index];
+  int where = rec->where;
+  if(where == PERSIST_FREE) {
+    return;
+  }
+  if(rec->prev == PERSIST_NIL) {
+    header->head[where] = rec->next;
+  }
+  else {
+    records[rec->prev].next = rec->next;
+  }
+  if(rec->next == PERSIST_NIL) {
+    header->tail[where] = rec->prev;
+  }
+  else {
+    records[rec->next].prev = rec->prev;
+  }
+  header->count[where]--;
+  rec->prev = rec->next = PERSIST_NIL;
+}
+
+/* Rebuilds the pid hash and free list from the records in one pass */
+static void rebuild_index() {
+  for(int b = 0; b < PERSIST_BUCKETS; b++) {
+    buckets[b] = PERSIST_NIL;
+  }
+  free_count = 0;
+  // Push in reverse, so records are handed out from the front of the file first.
+  for(int i = PERSIST_SLOTS - 1; i >= 0; i--) {
+    if(records[i].where == PERSIST_FREE) {
+      free_slots[free_count++] = i;
+    }
+    else {
+      hash_insert(records[i].pid, i);
+    }
+  }
+}
+
+/* Copies every record into saved: CPU first, then the Ready Queues, then the Defunct Queue.
+ * - If the last shvm died in the middle of an update the links can't be trusted, so the
+ *   records are gathered by a scan instead (same lists, but not necessarily in Queue order).
+ * Returns the number of records copied.
+ */
+static int collect_records(Persist_record_s *saved) {
+  int total = 0;
+  int in_use = PERSIST_SLOTS - free_count;
+  int torn = header->updates & 1;
+
+  for(int where = PERSIST_CPU; where < PERSIST_LISTS && !torn; where++) {
+    int steps = 0;
+    for(int i = header->head[where]; i != PERSIST_NIL; i = records[i].next) {
+      if(i < 0 || i >= PERSIST_SLOTS || records[i].where != where || ++steps > in_use) {
+        torn = 1;
+        break;
+      }
+      saved[total++] = records[i];
+    }
+  }
+  if(torn) {
+    PRINT_WARNING("The schedule snapshot was mid-update; Queue order will not be kept");
+    total = 0;
+    for(int where = PERSIST_CPU; where < PERSIST_LISTS; where++) {
+      for(int i = 0; i < PERSIST_SLOTS; i++) {
+        if(records[i].where == where) {
+          saved[total++] = records[i];
+        }
+      }
+    }
+  }
+  return total;
+}
+
+/* Reads the start time (in clock ticks since boot) of pid from /proc.
+ * - If proc_state is given, it's set to the process' state letter (eg. R, S, T, Z).
+ * Returns the start time, or STARTTIME_UNKNOWN if there is no such process (or it can't be read).
+ */
+static unsigned long long read_starttime(pid_t pid, char *proc_state) {
+  char path[64] = {0};
+  char buf[1024] = {0};
+  snprintf(path, sizeof(path), "/proc/%d/stat", pid);
+
+  int fd = open(path, O_RDONLY | O_CLOEXEC);
+  if(fd == -1) {
+    return STARTTIME_UNKNOWN;
+  }
+  ssize_t got = read(fd, buf, sizeof(buf) - 1);
+  close(fd);
+  if(got <= 0) {
+    return STARTTIME_UNKNOWN;
+  }
+
+  // The command name may contain spaces, so count fields from after its closing paren.
+  char *field = strrchr(buf, ')');
+  if(field == NULL) {
+    return STARTTIME_UNKNOWN;
+  }
+  if(proc_state) {
+    *proc_state = field[2];
+  }
+  // State is field 3 and starttime is field 22.
+  for(int i = 2; i < 22 && field != NULL; i++) {
+    field = strchr(field + 1, ' ');
+  }
+  return field ? strtoull(field + 1, NULL, 10) : STARTTIME_UNKNOWN;
+}
+
+/* Returns 1 if pid is a live (not zombie) process that started at starttime, else 0.
+ * - A start time that was never read (one that exited before it was first tracked) matches nothing,
+ *   and nor does the 0 older snapshots recorded for one.
+ */
+static int same_process(pid_t pid, unsigned long long starttime) {
+  if(starttime == STARTTIME_UNKNOWN || starttime == 0) {
+    return 0;
+  }
+  char proc_state = 0;
+  return read_starttime(pid, &proc_state) == starttime && proc_state != 'Z';
+}
@@ -0,0 +1,212 @@
+/* Standard Library Includes */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <time.h>
+/* Linux System API Includes */
+#include <unistd.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <sys/types.h>
+/* StrawHat VM Includes */
+#include "vm.h"
+#include "vm_pressure.h"
+#include "vm_support.h"
+#include "vm_settings.h"
+
+/* Local Definitions */
+#define PSI_PATH "/proc/pressure/memory"
+
+/* Pressure State
+ * - Sampled by the Dispatcher only; pressure_m keeps the thresholds and what's shown consistent for
+ *   the threads that change or show them.
+ */
+static pthread_mutex_t pressure_m = PTHREAD_MUTEX_INITIALIZER;
+static int enabled = DEFAULT_PRESSURE;
+static double on_pct = PRESSURE_ON_PCT;    // Under pressure from some avg10 this high (percent)
+static double off_pct = PRESSURE_OFF_PCT;  // until it falls below this
+static uint32_t large_kb = PRESSURE_LARGE_KB;
+static int hold = PRESSURE_HOLD_ADMIT;     // 1 holds launches other than critical ones under pressure
+static int active = 0;                     // 1 while under pressure
+static int psi_fd = -2;                    // -2 until first opened, -1 if the host has no PSI
+static double last_avg10 = 0;
+static struct timespec last_sample;        // When PSI was last read
+static struct timespec active_since;
+static long samples = 0;
+static long episodes = 0;                  // Times the host came under pressure
+static double active_sec = 0;              // Time spent under pressure, before the current episode
+static long page_kb = 0;
+
+/* Local Prototypes */
+static int read_avg10(double *avg10);
+static double elapsed_sec(struct timespec *since, struct timespec *now);
+
+/* Reads the host's memory pressure, if PRESSURE_SAMPLE_MSEC have passed since it was last read.
+ * - Call from the Dispatcher, with the schedule locked.
+ * Returns 1 while under pressure and 0 otherwise, or -1 if it wasn't time to sample again.
+ */
+int pressure_sample() {
+  struct timespec now;
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  if(samples > 0 && elapsed_sec(&last_sample, &now) * 1000 < PRESSURE_SAMPLE_MSEC) {
+    return -1;
+  }
+  last_sample = now;
+
+  double avg10 = 0;
+  int have = read_avg10(&avg10);
+  pthread_mutex_lock(&pressure_m);
+  samples++;
+  last_avg10 = avg10;
+  int was = active;
+  if(!enabled || have == -1) {
+    active = 0;
+  }
+  else if(!active && avg10 >= on_pct) {
+    active = 1;
+  }
+  else if(active && avg10 < off_pct) {
+    active = 0;
+  }
+  if(active && !was) {
+    episodes++;
+    active_since = now;
+    PRINT_STATUS("Memory pressure: %.2f%% of the last 10 sec stalled (past %.2f%%), processes of %u MB or more wait%s",
+        avg10, on_pct, large_kb / 1024, hold ? ", and launches are held" : "");
+  }
+  else if(was && !active) {
+    active_sec += elapsed_sec(&active_since, &now);
+    PRINT_STATUS("Memory pressure eased: %.2f%% of the last 10 sec stalled", avg10);
+  }
+  int result = active;
+  pthread_mutex_unlock(&pressure_m);
+  return result;
+}
+
+/* Returns 1 while the host is under memory pressure */
+int pressure_active() {
+  pthread_mutex_lock(&pressure_m);
+  int result = active;
+  pthread_mutex_unlock(&pressure_m);
+  return result;
+}
+
+/* Returns 1 if launches other than critical ones should wait for the pressure to ease */
+int pressure_holds_admission() {
+  pthread_mutex_lock(&pressure_m);
+  int result = active && hold;
+  pthread_mutex_unlock(&pressure_m);
+  return result;
+}
+
+/* Returns the footprint (KB) from which processes wait for smaller ones under pressure */
+uint32_t pressure_large_kb() {
+  pthread_mutex_lock(&pressure_m);
+  uint32_t kb = large_kb;
+  pthread_mutex_unlock(&pressure_m);
+  return kb;
+}
+
+/* Returns the resident set of a process (KB), or 0 if it can't be read (eg. it has exited) */
+long pressure_rss_kb(pid_t pid) {
+  if(page_kb == 0) {
+    page_kb = sysconf(_SC_PAGESIZE) / 1024;
+  }
+  char path[64];
+  char buf[128];
+  snprintf(path, sizeof(path), "/proc/%d/statm", pid);
+  int fd = open(path, O_RDONLY | O_CLOEXEC);
+  if(fd == -1) {
+    return 0;
+  }
+  ssize_t n = read(fd, buf, sizeof(buf) - 1);
+  close(fd);
+  long size = 0, resident = 0;
+  if(n <= 0) {
+    return 0;
+  }
+  buf[n] = '\0';
+  if(sscanf(buf, "%ld %ld", &size, &resident) != 2) {
+    return 0;
+  }
+  return resident * page_kb;
+}
+
+/* Sets whether memory pressure is acted on at all */
+void pressure_set_enabled(int on) {
+  pthread_mutex_lock(&pressure_m);
+  enabled = on;
+  pthread_mutex_unlock(&pressure_m);
+}
+
+/* Sets the stall share (percent, some avg10) the host is under pressure from, and the one it eases below */
+void pressure_set_threshold(double on, double off) {
+  pthread_mutex_lock(&pressure_m);
+  on_pct = on;
+  off_pct = (off > on) ? on : off;
+  pthread_mutex_unlock(&pressure_m);
+}
+
+/* Sets the footprint (KB) from which processes wait for smaller ones under pressure */
+void pressure_set_large(long kb) {
+  pthread_mutex_lock(&pressure_m);
+  large_kb = (kb > UINT32_MAX) ? UINT32_MAX : (kb < 1 ? 1 : (uint32_t)kb);
+  pthread_mutex_unlock(&pressure_m);
+}
+
+/* Sets whether launches other than critical ones wait while under pressure */
+void pressure_set_hold(int on) {
+  pthread_mutex_lock(&pressure_m);
+  hold = on;
+  pthread_mutex_unlock(&pressure_m);
+}
+
+/* Prints the thresholds, the last sample and what has been deferred
+ * - large_ready: ready processes past the large size now, deferred: selections that passed one over
+ */
+void print_pressure(int large_ready, long deferred) {
+  struct timespec now;
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  pthread_mutex_lock(&pressure_m);
+  double total_sec = active_sec + (active ? elapsed_sec(&active_since, &now) : 0);
+  if(psi_fd == -1) {
+    PRINT_STATUS("Memory Pressure: unavailable (no %s), nothing is deferred", PSI_PATH);
+  }
+  else if(!enabled) {
+    PRINT_STATUS("Memory Pressure: off, footprints are ignored");
+  }
+  else {
+    PRINT_STATUS("Memory Pressure: %s (%.2f%% stalled; from %.2f%% until below %.2f%%), %u MB or more waits%s",
+        active ? "UNDER PRESSURE" : "none", last_avg10, on_pct, off_pct, large_kb / 1024,
+        hold ? ", launches held" : "");
+  }
+  PRINT_STATUS("     Samples: %ld, Episodes: %ld (%.1f sec), Large and ready now: %d, Selections deferred: %ld",
+      samples, episodes, total_sec, large_ready, deferred);
+  pthread_mutex_unlock(&pressure_m);
+}
+
+/* Reads some avg10 from PSI into avg10.
+ * Returns 0 on success, or -1 if the host has no PSI.
+ */
+static int read_avg10(double *avg10) {
+  if(psi_fd == -2) {
+    psi_fd = open(PSI_PATH, O_RDONLY | O_CLOEXEC);
+  }
+  if(psi_fd == -1) {
+    return -1;
+  }
+  // "some avg10=0.00 avg60=0.00 avg300=0.00 total=0", re-read from the start each time
+  char buf[256];
+  ssize_t n = pread(psi_fd, buf, sizeof(buf) - 1, 0);
+  if(n <= 0) {
+    return -1;
+  }
+  buf[n] = '\0';
+  return (sscanf(buf, "some avg10=%lf", avg10) == 1) ? 0 : -1;
+}
+
+/* Returns the seconds from since to now */
+static double elapsed_sec(struct timespec *since, struct timespec *now) {
+  return (now->tv_sec - since->tv_sec) + (now->tv_nsec - since->tv_nsec) / 1e9;
+}
@@ -3,18 +3,28 @@
 #include <stdlib.h>
 #include <string.h>
 #include <errno.h>
+#include <time.h>
 /* Linux System API Includes */
 #include <signal.h>
 #include <unistd.h>
 #include <sys/types.h>
 #include <sys/wait.h>
 #include <sys/time.h>
+#include <pthread.h>
+#include <sched.h>
 /* StrawHat VM Includes */
 #include "vm.h"
 #include "vm_support.h"
 #include "vm_process.h"
 #include "vm_printing.h"
 #include "vm_cs.h"
+#include "vm_shell.h"
+#include "vm_archive.h"
+#include "vm_admit.h"
+#include "vm_zygote.h"
+#include "vm_output.h"
+#include "vm_pressure.h"
+#include "vm_coop.h"
 
 /* Local Definitions */
 
@@ -22,13 +32,37 @@
 enum builtin_commands {
   QUIT, EXIT, HELP, DEBUG, START, STOP, SUSPEND, RESUME,
   SCHEDULE, STATUS, TERMINATE, DELAYTIME, RUNTIME, REAP,
+  WAIT, SLEEP, LOGLEVEL, AUTOREAP, QUANTUM, ENGINE, TENANT, POLICY, ADMIT, ZYGOTE,
+  OUTPUT, TAIL, PRESSURE, COOP,
   NUM_BUILTINS
 };
 static char *builtin_commands[] = {
   "quit", "exit", "help", "debug", "start", "stop", "suspend", "resume", 
-  "schedule", "status", "kill", "delaytime", "runtime", "reap"
+  "schedule", "status", "kill", "delaytime", "runtime", "reap",
+  "wait", "sleep", "loglevel", "autoreap", "quantum", "engine", "tenant", "policy", "admit", "zygote",
+  "output", "tail", "pressure", "coop"
 };
 
+/* Launch Guard
+ * The Process System keeps its Jobs Queue without any locking, and its SIGCHLD handler
+ * edits that queue.  Launches from any thread are serialized with launch_m, and while one
+ * is in progress the SIGCHLD handler is deferred until it completes.
+ * - The handler may also be run from a thread (see shell_sigchld), so only one runs it at a time:
+ *   any other just leaves it pending, for the one running it to go over again.
+ */
+static pthread_mutex_t launch_m = PTHREAD_MUTEX_INITIALIZER;
+static void (*process_sigchld)(int) = NULL; // The Process System's own SIGCHLD handler
+static int launch_active = 0;               // 1 while a launch is in progress
+static int in_sigchld = 0;                  // 1 while the SIGCHLD handler is running (on any thread)
+static volatile sig_atomic_t sigchld_pending = 0;
+
+/* Batch Mode Tracking */
+static int batch_commands = 0; // Number of lines executed in batch mode
+static int batch_launched = 0; // Number of processes launched in batch mode
+static int batch_refused = 0;  // Number of launches refused by admission control in batch mode
+static long batch_archived = 0; // Auto-reaped processes (and failures) before the batch started
+static long batch_archived_failed = 0;
+
 /* Local Prototypes */
 static int get_user_input(char *line, char *hline);
 static void execute_builtin(Process_data_s *data);
@@ -44,22 +78,43 @@ static void run_reap(Process_data_s *data);
 static void run_kill(Process_data_s *data);
 static void run_delaytime(Process_data_s *data);
 static void run_runtime(Process_data_s *data);
-static void execute_command(Process_data_s *data);
+static void run_wait(Process_data_s *data);
+static void run_sleep(Process_data_s *data);
+static void run_loglevel(Process_data_s *data);
+static void run_autoreap(Process_data_s *data);
+static void run_quantum(Process_data_s *data);
+static void run_engine(Process_data_s *data);
+static void run_tenant(Process_data_s *data);
+static void run_policy(Process_data_s *data);
+static void run_admit(Process_data_s *data);
+static void run_zygote(Process_data_s *data);
+static void run_output(Process_data_s *data);
+static void run_tail(Process_data_s *data);
+static void run_pressure(Process_data_s *data);
+static void run_coop(Process_data_s *data);
+static void launch_process(Process_data_s *data);
+static pid_t execute_command(Process_data_s *data);
+static void hnd_sigchld_guard(int sig);
+static void launch_begin(sigset_t *saved);
+static void launch_end(sigset_t *saved);
 static int builtin_string_to_enum(char *str);
 static int is_builtin(char *str);
 static pid_t extract_pid(char *str);
 static suseconds_t extract_time(char *str);
+static int extract_cpus(char *str, uint64_t *cpus);
 static void print_process_data(Process_data_s *data);
 static int is_whitespace(char *str);
 static void print_help();
 static Process_data_s *initialize_data(const char *str);
 static Process_data_s *parse_input(char *str);
+static int parse_flag(Process_data_s *data, char *flag, char **p_save);
+static void execute_line(char *line);
+static int print_batch_summary(struct timeval *start);
 
 /* Run the Virtual System with User Shell Access */
 void shell() {
   char buffer[MAX_CMD_LINE] = {0};
   char hist_buffer[MAX_CMD_LINE] = {0};
-  Process_data_s *proc_data = NULL;
   int ret = 0;
 
   print_cs_status();
@@ -85,32 +140,108 @@ void shell() {
       }
     } while(ret != 0);
 
-    // Step 2: Parse the User Input
-    proc_data = parse_input(buffer);
-    // If there was an issue parsing it, ignore the input and get a new command
-    if(proc_data == NULL) {
+    // Steps 2-4: Parse and Execute the User Input
+    execute_line(buffer);
+  }
+  
+  return;
+}
+
+/* Run the Virtual System non-interactively from a script or pipe.
+ * - No prompts; each line is executed as soon as it is read.
+ * - Lines starting with # are comments.
+ * - At the end of input, waits for every job to finish, reaps them, prints a summary and exits:
+ *   with EXIT_FAILURE if any job exited non-zero or any launch was refused, else EXIT_SUCCESS.
+ */
+void shell_batch(FILE *script) {
+  char buffer[MAX_CMD_LINE] = {0};
+  struct timeval start = {0};
+
+  gettimeofday(&start, NULL);
+  archive_totals(&batch_archived, &batch_archived_failed);
+
+  // Read until the end of the script (or the pipe is closed)
+  while(fgets(buffer, MAX_CMD_LINE, script) != NULL) {
+    // Clean up the remainder of any overlong line
+    if(strchr(buffer, '\n') == NULL && !feof(script)) {
+      int c = 0;
+      while((c = fgetc(script)) != '\n' && c != EOF);
+    }
+    buffer[strcspn(buffer, "\r\n")] = '\0';
+    if(buffer[0] == '#') {
       continue;
     }
+    batch_commands++;
+    execute_line(buffer);
+  }
 
-    // Only prints if DEBUG mode is ON
-    print_process_data(proc_data);
+  // Out of input: let every remaining job run to completion, then reap them all.
+  if(cs_live_count() > 0 && !cs_is_running()) {
+    run_start();
+  }
+  cs_wait(0);
+  exit(print_batch_summary(&start) > 0 ? EXIT_FAILURE : EXIT_SUCCESS);
+}
 
-    // Step 3: Execute the Input
-    if(is_builtin(proc_data->cmd)) {
-      // The input was a built-in command; run the function.
-      execute_builtin(proc_data);
-      // Free Command (if Built-In)
-      free_data_proc(proc_data);
-      proc_data = NULL;
+/* Parses and executes one line of input (Built-In or Command) */
+static void execute_line(char *line) {
+  // Step 2: Parse the User Input
+  Process_data_s *proc_data = parse_input(line);
+  // If there was an issue parsing it, ignore the input and get a new command
+  if(proc_data == NULL) {
+    return;
+  }
+
+  // Only prints if DEBUG mode is ON
+  print_process_data(proc_data);
+
+  // Step 3: Execute the Input
+  if(is_builtin(proc_data->cmd)) {
+    // The input was a built-in command; run the function.
+    execute_builtin(proc_data);
+    // Free Command (if Built-In)
+    free_data_proc(proc_data);
+    proc_data = NULL;
+  }
+  // Otherwise, it's a program to run (Command).
+  else {
+    // Step 4: Add the Command to the Jobs Tracker then Execute It
+    if(execute_command(proc_data) != -1) { // Not refused by admission control
+      batch_launched++;
     }
-    // Otherwise, it's a program to run (Command).
     else {
-      // Step 4: Add the Command to the Jobs Tracker then Execute It
-      execute_command(proc_data);
+      batch_refused++;
     }
   }
-  
-  return;
+}
+
+/* Reaps everything left in the Defunct Queue and prints the Batch Mode results
+ * Returns how many jobs failed: exited non-zero, or were refused a launch.
+ */
+static int print_batch_summary(struct timeval *start) {
+  struct timeval end = {0};
+  int reaped = 0;
+  int failed = 0;
+  int ec = 0;
+
+  while((ec = cs_reap_code(0)) != -1) {
+    reaped++;
+    if(ec != 0) {
+      failed++;
+    }
+  }
+  // Count the ones auto-reaped along the way too
+  long archived = 0;
+  long archived_failed = 0;
+  archive_totals(&archived, &archived_failed);
+  reaped += archived - batch_archived;
+  failed += archived_failed - batch_archived_failed;
+
+  gettimeofday(&end, NULL);
+  long usec = (end.tv_sec - start->tv_sec) * 1000000L + (end.tv_usec - start->tv_usec);
+  PRINT_STATUS("Batch Complete: %d lines, %d processes launched, %d refused, %d reaped (%d non-zero exit), %ld.%06ld sec",
+      batch_commands, batch_launched, batch_refused, reaped, failed, usec / 1000000, usec % 1000000);
+  return failed + batch_refused;
 }
 
 /* Executes a StrawHat Built-In Instruction */
@@ -138,12 +269,26 @@ static void execute_builtin(Process_data_s *data) {
     case SUSPEND:
     case RESUME:                          break;
 #endif
-    case SCHEDULE: print_schedule(get_schedule(), get_on_cpu()); break; // Self-contained action.
+    case SCHEDULE: cs_print_schedule();   break; // Self-contained action.
     case STATUS: print_cs_status();       break; // Self-contained action.
     case TERMINATE: run_kill(data);       break;
     case DELAYTIME: run_delaytime(data);  break;
     case RUNTIME: run_runtime(data);      break;
     case REAP: run_reap(data);            break;
+    case WAIT: run_wait(data);            break;
+    case SLEEP: run_sleep(data);          break;
+    case LOGLEVEL: run_loglevel(data);    break;
+    case AUTOREAP: run_autoreap(data);    break;
+    case QUANTUM: run_quantum(data);      break;
+    case ENGINE: run_engine(data);        break;
+    case TENANT: run_tenant(data);        break;
+    case POLICY: run_policy(data);        break;
+    case ADMIT: run_admit(data);          break;
+    case ZYGOTE: run_zygote(data);        break;
+    case OUTPUT: run_output(data);        break;
+    case TAIL: run_tail(data);            break;
+    case PRESSURE: run_pressure(data);    break;
+    case COOP: run_coop(data);            break;
     default: // This should never happen, but if it does, assume user entered something wrong.
       print_help();   
   }
@@ -267,6 +412,319 @@ static void run_runtime(Process_data_s *data) {
   }
 }
 
+/* Handle the built-in for WAIT (block the shell until processes have finished) */
+static void run_wait(Process_data_s *data) {
+  // Get PID from Arguments
+  pid_t pid = extract_pid(data->argv[1]);
+
+  // If no argument, use 0 (which is a code for waiting on every process)
+  if(pid == -1) {
+    pid = 0;
+  }
+
+  // Nothing will ever finish while the CS System is stopped.
+  if(!cs_is_running() && cs_live_count() > 0) {
+    PRINT_WARNING("The CS System is stopped, start it before waiting.");
+    return;
+  }
+  cs_wait(pid);
+}
+
+/* Handle the built-in for SLEEP (pause the shell for a fixed time) */
+static void run_sleep(Process_data_s *data) {
+  // Get time from Arguments
+  suseconds_t time = extract_time(data->argv[1]);
+
+  if(time < 0) {
+    PRINT_WARNING("You need a valid time in usec.\n\teg. sleep %d", SLEEP_USEC);
+    return;
+  }
+
+  // Sleep for the full time, even if interrupted by signals
+  struct timespec req = { time / 1000000, (time % 1000000) * 1000 };
+  struct timespec rem = {0};
+  while(nanosleep(&req, &rem) == -1 && errno == EINTR) {
+    req = rem;
+  }
+}
+
+/* Handle the built-in for LOGLEVEL (show or set the lowest level of message printed) */
+static void run_loglevel(Process_data_s *data) {
+  // Reported with vm_log directly, so it shows even when Status messages are filtered out.
+  if(data->argv[1] == NULL) {
+    vm_log(LOG_STATUS, "Log Level: %s", log_level_name(g_log_level));
+    return;
+  }
+
+  int level = log_level_from_string(data->argv[1]);
+  if(level == -1) {
+    PRINT_WARNING("You need a valid level: debug, info, status or warn.\n\teg. loglevel warn");
+    return;
+  }
+  g_log_level = level;
+  vm_log(LOG_STATUS, "Log Level: %s", log_level_name(g_log_level));
+}
+
+/* Handle the built-in for AUTOREAP (show or set when Defunct processes are reaped automatically) */
+static void run_autoreap(Process_data_s *data) {
+  static char *limits[] = { "off", "count", "age", "mem" }; // In autoreap_limits order
+  if(data->argv[1] == NULL) {
+    print_autoreap();
+    return;
+  }
+
+  int limit = -1;
+  for(int i = 0; i < sizeof(limits) / sizeof(limits[0]); i++) {
+    if(strcmp(data->argv[1], limits[i]) == 0) {
+      limit = i;
+    }
+  }
+  long value = 0;
+  if(limit != AUTOREAP_OFF) {
+    char *end = NULL;
+    value = (data->argv[2] == NULL) ? -1 : strtol(data->argv[2], &end, 10);
+    if(end == NULL || *end != '\0' || end == data->argv[2]) {
+      value = -1;
+    }
+  }
+  if(limit == -1 || value < 0) {
+    PRINT_WARNING("You need off, or a limit and a value (0 for no limit).\n\teg. autoreap count %d", DEFAULT_AUTOREAP_COUNT);
+    PRINT_INFO("count X  Keep at most X processes in the Defunct Queue.");
+    PRINT_INFO("age X    Keep processes at most X sec after they exit.");
+    PRINT_INFO("mem X    Keep at most X KB of processes in the Defunct Queue.");
+    return;
+  }
+  cs_set_autoreap(limit, value);
+}
+
+/* Handle the built-in for QUANTUM (learn each process' quantum, or run all for the runtime) */
+static void run_quantum(Process_data_s *data) {
+  if(data->argv[1] != NULL && strcmp(data->argv[1], "adaptive") == 0) {
+    set_adaptive_quantum(1);
+  }
+  else if(data->argv[1] != NULL && strcmp(data->argv[1], "fixed") == 0) {
+    set_adaptive_quantum(0);
+  }
+  else {
+    PRINT_WARNING("You need a valid mode: adaptive or fixed.\n\teg. quantum fixed");
+  }
+}
+
+/* Handle the built-in for ENGINE (show, or run processes one at a time or several at once) */
+static void run_engine(Process_data_s *data) {
+  if(data->argv[1] == NULL) {
+    print_engine();
+    return;
+  }
+  if(strcmp(data->argv[1], "serial") == 0) {
+    cs_set_engine(1);
+    return;
+  }
+  char *end = NULL;
+  long slots = (data->argv[2] == NULL) ? 0 : strtol(data->argv[2], &end, 10);
+  if(strcmp(data->argv[1], "concurrent") != 0 || end == NULL || *end != '\0' || slots < 2 || slots > ENGINE_MAX_SLOTS) {
+    PRINT_WARNING("You need serial, or concurrent and how many processes (2 to %d) may run at once.\n\teg. engine concurrent 4",
+        ENGINE_MAX_SLOTS);
+    return;
+  }
+  cs_set_engine(slots);
+}
+
+/* Handle the built-in for TENANT (show every tenant's shares and usage, or set one's shares) */
+static void run_tenant(Process_data_s *data) {
+  if(data->argv[1] == NULL) {
+    print_tenants();
+    return;
+  }
+  char *end = NULL;
+  long shares = (data->argv[2] == NULL) ? 0 : strtol(data->argv[2], &end, 10);
+  if(end == NULL || *end != '\0' || shares < 1 || shares > 10000 || strlen(data->argv[1]) >= MAX_TENANT_NAME) {
+    PRINT_WARNING("You need a tenant name and its shares (1 to 10000).\n\teg. tenant web %d", DEFAULT_TENANT_SHARES * 3);
+    return;
+  }
+  cs_set_tenant(data->argv[1], shares);
+}
+
+/* Handle the built-in for POLICY (show, or order the Ready Queues first come first served or shortest job first) */
+static void run_policy(Process_data_s *data) {
+  if(data->argv[1] == NULL) {
+    print_policy();
+  }
+  else if(strcmp(data->argv[1], "fifo") == 0) {
+    cs_set_policy(OTUR_POLICY_FIFO);
+  }
+  else if(strcmp(data->argv[1], "sjf") == 0) {
+    cs_set_policy(OTUR_POLICY_SJF);
+  }
+  else {
+    PRINT_WARNING("You need a valid policy: fifo or sjf.\n\teg. policy sjf");
+  }
+}
+
+/* Handle the built-in for ADMIT (show, set a class' most live processes, or queue or refuse past them) */
+static void run_admit(Process_data_s *data) {
+  char *classes[] = { "critical", "high", "normal" };
+  if(data->argv[1] == NULL) {
+    print_admit();
+    return;
+  }
+  if(strcmp(data->argv[1], "queue") == 0 || strcmp(data->argv[1], "reject") == 0) {
+    admit_set_refuse(strcmp(data->argv[1], "reject") == 0);
+    print_admit();
+    return;
+  }
+  int class = -1;
+  for(int i = 0; i < ADMIT_CLASSES; i++) {
+    if(strcmp(data->argv[1], classes[i]) == 0) {
+      class = i;
+    }
+  }
+  char *end = NULL;
+  long limit = (data->argv[2] == NULL) ? -1 : strtol(data->argv[2], &end, 10);
+  if(class == -1 || end == NULL || *end != '\0' || end == data->argv[2] || limit < 0 || limit > 1000000) {
+    PRINT_WARNING("You need queue, reject, or a class (critical, high, normal) and its most live processes (0 for no limit).\n\teg. admit normal 64");
+    return;
+  }
+  admit_set_limit(class, limit);
+  shell_admit_waiting(); // A higher limit lets some in right away
+  print_admit();
+}
+
+/* Handle the built-in for ZYGOTE (show, or launch from the zygote's stubs or by forking shvm) */
+static void run_zygote(Process_data_s *data) {
+  if(data->argv[1] != NULL && (strcmp(data->argv[1], "on") == 0 || strcmp(data->argv[1], "off") == 0)) {
+    zygote_set_enabled(strcmp(data->argv[1], "on") == 0);
+  }
+  else if(data->argv[1] != NULL) {
+    PRINT_WARNING("You need on (launch from the zygote's stubs) or off (fork shvm).\n\teg. zygote off");
+    return;
+  }
+  print_zygote();
+}
+
+/* Handle the built-in for OUTPUT (show, capture or not, or print everything kept of a process' output) */
+static void run_output(Process_data_s *data) {
+  if(data->argv[1] == NULL) {
+    print_output();
+    return;
+  }
+  if(strcmp(data->argv[1], "on") == 0 || strcmp(data->argv[1], "off") == 0) {
+    output_set_capture(strcmp(data->argv[1], "on") == 0);
+    print_output();
+    return;
+  }
+  pid_t pid = extract_pid(data->argv[1]);
+  if(pid <= 0) {
+    PRINT_WARNING("You need on, off, or the PID of a process to show its output.\n\teg. output 1234");
+    return;
+  }
+  char *buf = malloc(OUTPUT_RING_BYTES);
+  if(buf == NULL) {
+    ABORT_ERROR("Failed to Allocate Memory for a Process' Output");
+  }
+  Output_info_s info;
+  long len = output_copy(pid, buf, OUTPUT_RING_BYTES, &info);
+  if(len == -1) {
+    PRINT_WARNING("No output was captured for PID %d", pid);
+  }
+  else {
+    PRINT_STATUS("Output of PID %d: %lld bytes%s%s", pid, info.total,
+        info.dropped ? ", the oldest dropped" : "", info.writing ? ", still writing" : "");
+    fwrite(buf, 1, len, stdout);
+    if(len > 0 && buf[len - 1] != '\n') {
+      putchar('\n');
+    }
+    fflush(stdout);
+  }
+  free(buf);
+}
+
+/* Handle the built-in for TAIL (print the last lines of a process' output) */
+static void run_tail(Process_data_s *data) {
+  pid_t pid = extract_pid(data->argv[1]);
+  char *end = NULL;
+  long lines = (data->argv[2] == NULL) ? OUTPUT_TAIL_LINES : strtol(data->argv[2], &end, 10);
+  if(pid <= 0 || (end != NULL && (*end != '\0' || end == data->argv[2])) || lines < 1) {
+    PRINT_WARNING("You need the PID of a process, and optionally how many lines.\n\teg. tail 1234 %d", OUTPUT_TAIL_LINES);
+    return;
+  }
+  char *buf = malloc(OUTPUT_RING_BYTES);
+  if(buf == NULL) {
+    ABORT_ERROR("Failed to Allocate Memory for a Process' Output");
+  }
+  Output_info_s info;
+  long len = output_copy(pid, buf, OUTPUT_RING_BYTES, &info);
+  if(len == -1) {
+    PRINT_WARNING("No output was captured for PID %d", pid);
+    free(buf);
+    return;
+  }
+  // Back up from the end past lines newlines (not counting one ending the last line)
+  long start = (len > 0 && buf[len - 1] == '\n') ? len - 1 : len;
+  while(start > 0 && (buf[start - 1] != '\n' || --lines > 0)) {
+    start--;
+  }
+  PRINT_STATUS("Last lines of PID %d (%lld bytes%s)", pid, info.total, info.writing ? ", still writing" : "");
+  fwrite(buf + start, 1, len - start, stdout);
+  if(len > start && buf[len - 1] != '\n') {
+    putchar('\n');
+  }
+  fflush(stdout);
+  free(buf);
+}
+
+/* Handle the built-in for PRESSURE (show, act on memory pressure or not, and its thresholds) */
+static void run_pressure(Process_data_s *data) {
+  char *arg = data->argv[1];
+  char *value = (arg == NULL) ? NULL : data->argv[2];
+  char *end = NULL;
+  double number = (value == NULL) ? -1 : strtod(value, &end);
+  int valid = (value != NULL && end != value && *end == '\0' && number >= 0);
+
+  if(arg == NULL) {
+    // Just show it
+  }
+  else if(strcmp(arg, "on") == 0 || strcmp(arg, "off") == 0) {
+    pressure_set_enabled(strcmp(arg, "on") == 0);
+  }
+  else if(strcmp(arg, "at") == 0 && valid && number <= 100) {
+    double off = number / 2;
+    char *off_str = data->argv[3];
+    if(off_str != NULL) {
+      off = strtod(off_str, &end);
+      if(end == off_str || *end != '\0' || off < 0) {
+        PRINT_WARNING("You need the stall share to ease below (percent).\n\teg. pressure at %.0f %.0f", PRESSURE_ON_PCT, PRESSURE_OFF_PCT);
+        return;
+      }
+    }
+    pressure_set_threshold(number, off);
+  }
+  else if(strcmp(arg, "large") == 0 && valid && number >= 1) {
+    pressure_set_large((long)(number * 1024));
+  }
+  else if(strcmp(arg, "hold") == 0 && value != NULL && (strcmp(value, "on") == 0 || strcmp(value, "off") == 0)) {
+    pressure_set_hold(strcmp(value, "on") == 0);
+  }
+  else {
+    PRINT_WARNING("You need on, off, at X [Y] (stall percent), large X (MB), or hold on/off.\n\teg. pressure large %d",
+        PRESSURE_LARGE_KB / 1024);
+    return;
+  }
+  cs_print_pressure();
+}
+
+/* Handle the built-in for COOP (show every cooperating process, or give new launches a control page or not) */
+static void run_coop(Process_data_s *data) {
+  if(data->argv[1] != NULL && (strcmp(data->argv[1], "on") == 0 || strcmp(data->argv[1], "off") == 0)) {
+    coop_set_enabled(strcmp(data->argv[1], "on") == 0);
+  }
+  else if(data->argv[1] != NULL) {
+    PRINT_WARNING("You need on (launches get a control page to yield or block with) or off.\n\teg. coop off");
+    return;
+  }
+  print_coop(1);
+}
+
 /* Change the Delay (how long to sleep between each process running) */
 static void run_delaytime(Process_data_s *data) {
   // Get time from Arguments
@@ -290,10 +748,138 @@ static void run_delaytime(Process_data_s *data) {
   }
 }
 
-/* Executes a local (or /usr/bin) command */
-static void execute_command(Process_data_s *data) {
-  // Creates the process and loads it into the Ready Queue
-  create_process(data);
+/* Executes a local (or /usr/bin) command
+ * Returns the PID of the new process.
+ */
+static pid_t execute_command(Process_data_s *data) {
+  sigset_t saved;
+
+  // Creates the process and loads it into the Ready Queue, if admission control lets it in now
+  launch_begin(&saved);
+  int admit = admit_check(data);
+  if(admit != ADMIT_NOW) {
+    launch_end(&saved);
+    free_data_proc(data);
+    return (admit == ADMIT_WAITING) ? 0 : -1;
+  }
+  launch_process(data);
+  pid_t pid = data->pid; // data now belongs to the Jobs Queue, read it before it can be freed
+  launch_end(&saved);
+  return pid;
+}
+
+/* Forks the process, its output going into a ring of its own if it's captured.  Call under the Launch Guard */
+static void launch_process(Process_data_s *data) {
+  int out = output_prepare();
+  zygote_create_process(data, out);
+  output_attach(data->pid);
+}
+
+/* Parses and launches a command line on behalf of another thread (eg. the control socket).
+ * - Built-In commands are not accepted here.
+ * Returns the PID of the new process, or -1 on any error.
+ */
+pid_t shell_launch(char *line) {
+  Process_data_s *data = parse_input(line);
+  if(data == NULL) {
+    return -1;
+  }
+  if(is_builtin(data->cmd)) {
+    free_data_proc(data);
+    return -1;
+  }
+  print_process_data(data);
+  return execute_command(data);
+}
+
+/* Launches the command lines waiting for admission that there's now room for (see vm_admit.h).
+ * Returns how many were launched.
+ */
+int shell_admit_waiting() {
+  char line[MAX_CMD_LINE];
+  int launched = 0;
+  sigset_t saved;
+
+  while(1) {
+    launch_begin(&saved);
+    if(!admit_next(line, sizeof(line))) {
+      launch_end(&saved);
+      break;
+    }
+    Process_data_s *data = parse_input(line);
+    if(data != NULL) {
+      launch_process(data);
+      launched++;
+    }
+    launch_end(&saved);
+  }
+  return launched;
+}
+
+/* Replaces the process system's SIGCHLD handler with one that respects the Launch Guard.
+ * - Call after initialize_process_system()
+ */
+void shell_guard_launches() {
+  struct sigaction sa = {0};
+  sigaction(SIGCHLD, NULL, &sa);
+  if(sa.sa_handler == SIG_DFL || sa.sa_handler == SIG_IGN) {
+    ABORT_ERROR("The Process System has no SIGCHLD Handler to guard.");
+  }
+  process_sigchld = sa.sa_handler;
+  register_signal(SIGCHLD, hnd_sigchld_guard);
+}
+
+/* SIGCHLD handler that defers to the end of any launch in progress on another thread */
+static void hnd_sigchld_guard(int sig) {
+  int idle = 0;
+  while(__atomic_compare_exchange_n(&in_sigchld, &idle, 1, 0, __ATOMIC_SEQ_CST, __ATOMIC_SEQ_CST)) {
+    if(__atomic_load_n(&launch_active, __ATOMIC_SEQ_CST)) {
+      sigchld_pending = 1; // launch_end() will re-raise it
+      __atomic_store_n(&in_sigchld, 0, __ATOMIC_SEQ_CST);
+      return;
+    }
+    sigchld_pending = 0;
+    zygote_reap(); // The zygote's own children were never launched, the Process System can't know them
+    process_sigchld(sig);
+    __atomic_store_n(&in_sigchld, 0, __ATOMIC_SEQ_CST);
+    if(!sigchld_pending) {
+      return;
+    }
+    idle = 0; // Another came in on another thread meanwhile: go over it again
+  }
+  sigchld_pending = 1; // Running on another thread, which goes over it again when it's done
+}
+
+/* Runs the SIGCHLD handler from a thread that has SIGCHLD blocked, for a SIGCHLD it took some other
+ *   way (eg. the Dispatcher's signalfd, see vm_cs.c).  The Launch Guard applies as it does to the handler.
+ */
+void shell_sigchld() {
+  hnd_sigchld_guard(SIGCHLD);
+}
+
+/* Serializes launches and holds off the SIGCHLD handler until launch_end()
+ * - Saves this thread's signal mask, since create_process() always leaves SIGCHLD unblocked.
+ */
+static void launch_begin(sigset_t *saved) {
+  pthread_sigmask(SIG_SETMASK, NULL, saved);
+  pthread_mutex_lock(&launch_m);
+  __atomic_store_n(&launch_active, 1, __ATOMIC_SEQ_CST);
+  // Let a handler already running on another thread finish with the Jobs Queue first.
+  while(__atomic_load_n(&in_sigchld, __ATOMIC_SEQ_CST)) {
+    sched_yield();
+  }
+}
+
+/* Ends a launch, delivering any SIGCHLD that arrived while it was in progress */
+static void launch_end(sigset_t *saved) {
+  // Threads that block SIGCHLD must not start taking it just because they launched a job.
+  pthread_sigmask(SIG_SETMASK, saved, NULL);
+  __atomic_store_n(&launch_active, 0, __ATOMIC_SEQ_CST);
+  if(sigchld_pending) {
+    sigchld_pending = 0;
+    kill(getpid(), SIGCHLD);
+  }
+  pthread_mutex_unlock(&launch_m);
 }
 
 /* Gets line from user, ensures is valid, and strips the newline from it.
@@ -418,6 +1004,40 @@ static suseconds_t extract_time(char *str) {
   }
 }
 
+/* Converts a CPU list (eg. 0,2-3) into one bit per CPU in cpus.
+ * Returns 0 on success, or -1 if it isn't a list of CPUs below MAX_PIN_CPUS.
+ */
+static int extract_cpus(char *str, uint64_t *cpus) {
+  if(str == NULL || is_whitespace(str)) {
+    return -1;
+  }
+  *cpus = 0;
+  char *next = str;
+  do {
+    char *end = NULL;
+    long first = strtol(next, &end, 10);
+    long last = first;
+    if(end == next) {
+      return -1;
+    }
+    if(*end == '-') {
+      next = end + 1;
+      last = strtol(next, &end, 10);
+      if(end == next) {
+        return -1;
+      }
+    }
+    if(first < 0 || last < first || last >= MAX_PIN_CPUS || (*end != ',' && *end != '\0')) {
+      return -1;
+    }
+    for(long cpu = first; cpu <= last; cpu++) {
+      *cpus |= 1ULL << cpu;
+    }
+    next = end + 1;
+  } while(next[-1] == ',');
+  return 0;
+}
+
 /* Prints out the Command Information */
 static void print_process_data(Process_data_s *data) {
   if(g_debug_mode == 0 || data == NULL) {
@@ -430,6 +1050,12 @@ static void print_process_data(Process_data_s *data) {
   PRINT_DEBUG( "| - [CMD: %s]", data->cmd);
   PRINT_DEBUG( "| - [Is High-Pri: %s]", data->is_high?"Yes":"No");
   PRINT_DEBUG( "| - [Is Critical: %s]", data->is_critical?"Yes":"No");
+  PRINT_DEBUG( "| - [Gang: %s]", data->gang[0]?data->gang:"None");
+  PRINT_DEBUG( "| - [Tenant: %s]", data->tenant[0]?data->tenant:"default");
+  PRINT_DEBUG( "| - [Name: %s]", data->name[0]?data->name:"None");
+  for(int i = 0; i < MAX_AFTER && data->after[i][0]; i++) {
+    PRINT_DEBUG( "| - [After: %s]", data->after[i]);
+  }
   for(int i = 0; i < MAX_ARGS && data->argv[i] != NULL; i++) {
     PRINT_DEBUG( "| - [Arg %2d: %s]", i, data->argv[i]);
   }
@@ -450,11 +1076,29 @@ static Process_data_s *parse_input(char *str) {
     ABORT_ERROR("Failed to Allocate Memory for new Command String");
   }
 
-  // Step 2: Extract Command
-  char *p_tok = strtok(data->input_toks, " "); 
-  data->cmd = p_tok;  // Guaranteed in-scope as it's pointing to data->input_toks
+  // Step 2: Take StrawHat's own flags, which come before the command (a -- ends them early)
+  char *p_save = NULL; // strtok_r state, commands can be parsed on more than one thread
+  char *p_tok = strtok_r(data->input_toks, " ", &p_save);
   data->is_critical = 0; // Initialize to Non-Critical
   data->is_high = 0; // Initialize to Normal Priority
+  while(p_tok != NULL && p_tok[0] == '-') {
+    if(strcmp(p_tok, "--") == 0) {
+      p_tok = strtok_r(NULL, " ", &p_save);
+      break;
+    }
+    if(parse_flag(data, p_tok, &p_save) == -1) {
+      PRINT_WARNING("Unknown flag %s (type help for the flags a command may have)", p_tok);
+      free_data_proc(data);
+      return NULL;
+    }
+    p_tok = strtok_r(NULL, " ", &p_save);
+  }
+  if(p_tok == NULL) {
+    PRINT_WARNING("No command to run after the flags.");
+    free_data_proc(data);
+    return NULL;
+  }
+  data->cmd = p_tok;  // Guaranteed in-scope as it's pointing to data->input_toks
   data->argv[0] = data->cmd;
   
   // Optionally restrict commands to local directory binaries only (set in inc/vm_settings.h)
@@ -472,34 +1116,113 @@ static Process_data_s *parse_input(char *str) {
 #endif
 
   // Step 3: Populate Arguments
+  // - Everything after the command is the command's own, except a bare -c or -h (taken anywhere, as they
+  //   always were) until the first --, which is dropped.
   int arg = 1;
-  data->is_critical = 0;  // Without -c, non-critical process
-  data->is_high = 0;      // Without -h, normal-level process
-
-  // Iterate through all input tokens to perform the population
-  do {
-    p_tok = strtok(NULL, " ");
-    if(p_tok != NULL) {
-      // Look for the critical flag
-      if(strncmp(p_tok, "-c", 2) == 0) {
-        data->is_critical = 1;
-        data->is_high = 1;  // All -c are by definition -h too!
-      }
-      // Look for the high-priority flag
-      else if(strncmp(p_tok, "-h", 2) == 0) {
-        data->is_high = 1;
-      }
-      // Must be an argument if not a flag, so add it to the list of args
-      else {
-        data->argv[arg++] = p_tok; // All pointers reference data->input_toks
-      }
+  int passing = 0; // 1 once the -- is seen
+  while((p_tok = strtok_r(NULL, " ", &p_save)) != NULL) {
+    if(!passing && strcmp(p_tok, "--") == 0) {
+      passing = 1;
+    }
+    else if(!passing && strcmp(p_tok, "-c") == 0) {
+      data->is_critical = 1;
+      data->is_high = 1;  // All -c are by definition -h too!
+    }
+    else if(!passing && strcmp(p_tok, "-h") == 0) {
+      data->is_high = 1;
     }
-    // Repeat until we're out of tokens (words) the user entered
-  } while(p_tok != NULL);
+    else if(arg < MAX_ARGS - 1) {
+      data->argv[arg++] = p_tok; // All pointers reference data->input_toks
+    }
+    else {
+      PRINT_WARNING("At most %d arguments are passed on, ignoring %s", MAX_ARGS - 2, p_tok);
+    }
+  }
 
   return data;
 }
 
+/* Takes one of StrawHat's own flags (given before the command) into data, with its value from p_save.
+ * Returns 0 on success, or -1 if it isn't one.  A flag with a bad or missing value is warned about and ignored.
+ */
+static int parse_flag(Process_data_s *data, char *flag, char **p_save) {
+  // Critical (always high too) and high priority
+  if(strcmp(flag, "-c") == 0) {
+    data->is_critical = 1;
+    data->is_high = 1;
+    return 0;
+  }
+  if(strcmp(flag, "-h") == 0) {
+    data->is_high = 1;
+    return 0;
+  }
+
+  // Every other flag has a value
+  const char *with_value[] = { "-g", "-n", "-a", "-u", "-q", "-p", "-cpu" };
+  int known = 0;
+  for(int i = 0; i < (int)(sizeof(with_value) / sizeof(with_value[0])); i++) {
+    known |= (strcmp(flag, with_value[i]) == 0);
+  }
+  if(!known) {
+    return -1;
+  }
+  char *value = strtok_r(NULL, " ", p_save);
+  if(value == NULL) {
+    PRINT_WARNING("%s needs a value, ignoring it", flag);
+    return 0;
+  }
+
+  // The gang to run with, the job name others can run after, and the tenant it runs for
+  if(strcmp(flag, "-g") == 0) {
+    snprintf(data->gang, sizeof(data->gang), "%s", value);
+  }
+  else if(strcmp(flag, "-n") == 0) {
+    snprintf(data->name, sizeof(data->name), "%s", value);
+  }
+  else if(strcmp(flag, "-u") == 0) {
+    snprintf(data->tenant, sizeof(data->tenant), "%s", value);
+  }
+  // A job (name or pid) to run after
+  else if(strcmp(flag, "-a") == 0) {
+    int after = 0;
+    while(after < MAX_AFTER && data->after[after][0] != '\0') {
+      after++;
+    }
+    if(after < MAX_AFTER) {
+      snprintf(data->after[after], sizeof(data->after[0]), "%s", value);
+    }
+    else {
+      PRINT_WARNING("A process can run after at most %d others, ignoring -a %s", MAX_AFTER, value);
+    }
+  }
+  // How long each of its slices is
+  else if(strcmp(flag, "-q") == 0) {
+    suseconds_t time = extract_time(value);
+    if(time >= LAUNCH_MIN_QUANTUM && time <= SLEEP_MAX_USEC) {
+      data->quantum_usec = time;
+    }
+    else {
+      PRINT_WARNING("-q needs a quantum from %d to %d usec, ignoring it", LAUNCH_MIN_QUANTUM, SLEEP_MAX_USEC);
+    }
+  }
+  // Its priority level: 1 is the most urgent
+  else if(strcmp(flag, "-p") == 0) {
+    suseconds_t level = extract_time(value);
+    if(level >= MIN_PRIORITY && level <= MAX_PRIORITY) {
+      data->level = level;
+    }
+    else {
+      PRINT_WARNING("-p needs a level from %d (most urgent) to %d, ignoring it", MIN_PRIORITY, MAX_PRIORITY);
+    }
+  }
+  // The CPUs it may run on
+  else if(extract_cpus(value, &data->cpus) == -1) {
+    data->cpus = 0;
+    PRINT_WARNING("-cpu needs a list of CPUs from 0 to %d (eg. 0,2-3), ignoring it", MAX_PIN_CPUS - 1);
+  }
+  return 0;
+}
+
 /* Initializes a clean input data structure */
 static Process_data_s *initialize_data(const char *str) {
   Process_data_s *data = calloc(1, sizeof(Process_data_s));
@@ -546,13 +1269,41 @@ static void print_help() {
   PRINT_STATUS( "| Ctrl-C      Toggle (Start/Stop) the CS Engine.");
   PRINT_STATUS( "+-------[Process Commands]");
   PRINT_STATUS( "| schedule    Prints out the Current State of all Queues.");
+  PRINT_STATUS( "| -c cmd      Runs cmd as critical (and high); -h cmd runs it high.  Either may follow cmd too.");
+  PRINT_STATUS( "| -g G cmd    Runs cmd in gang G: the gang is selected, resumed and suspended all together.");
+  PRINT_STATUS( "| -n N cmd    Names cmd N, so other Processes can run after it.");
+  PRINT_STATUS( "| -a J cmd    Holds cmd until job J (a name or PID) exits successfully (cancelled if it fails).");
+  PRINT_STATUS( "| -u T cmd    Runs cmd as tenant T, which gets its share of the CPUs whatever its number of Processes.");
+  PRINT_STATUS( "| -q X cmd    Runs cmd for X usec each time the serial engine dispatches it, whatever the runtime or its learned quantum.");
+  PRINT_STATUS( "| -p X cmd    Runs cmd at priority level X, %d (first in its queue) to %d (last); %d without -p.",
+      MIN_PRIORITY, MAX_PRIORITY, DEFAULT_PRIORITY);
+  PRINT_STATUS( "| -cpu L cmd  Runs cmd only on the CPUs in list L (eg. 0,2-3).");
+  PRINT_STATUS( "| cmd -- A    Passes all of A to cmd as it is, even a -c or -h.");
   PRINT_STATUS( "| kill X      Kill Running or Ready Process with PID X.");
   PRINT_STATUS( "| reap X      Reap Defunct Process with PID X.");
   PRINT_STATUS( "| reap        Reap the First Process in the Defunct Queue.");
+  PRINT_STATUS( "| wait X      Wait until Process with PID X has Finished.");
+  PRINT_STATUS( "| wait        Wait until all Processes have Finished.");
+  PRINT_STATUS( "| sleep X     Pause the Shell for X usec.");
+  PRINT_STATUS( "| autoreap    Shows or Sets (off, count X, age X, mem X) when Defunct Processes are Reaped for you.");
   PRINT_STATUS( "+-------[StrawHat Commands]");
   PRINT_STATUS( "| status      Prints out the Current Settings.");
   PRINT_STATUS( "| debug       Toggles Debug Information.");
+  PRINT_STATUS( "| loglevel X  Only prints messages at level X (debug, info, status, warn) or above.");
   PRINT_STATUS( "| runtime X   Sets the runtime to X usec.");
+  PRINT_STATUS( "| quantum X   Runs each Process for its learned quantum (adaptive) or the runtime (fixed).");
+  PRINT_STATUS( "| engine X    Shows or Sets the CS Engine: serial, or concurrent K (up to K Processes at once).");
+  PRINT_STATUS( "| tenant T X  Shows every Tenant's shares and CPU usage, or Sets Tenant T's shares to X.");
+  PRINT_STATUS( "| policy X    Shows or Sets the Ready Queue order: fifo, or sjf (shortest predicted job first).");
+  PRINT_STATUS( "| admit C X   Shows or Sets admission: class C (critical, high, normal) may have X live Processes (0 for any).");
+  PRINT_STATUS( "| admit X     Past the limits, launches wait unforked (queue) or are refused (reject).");
+  PRINT_STATUS( "| pressure X  Shows or Sets memory pressure handling (on, off); at X Y: under it from X%% stalled until below Y%%.");
+  PRINT_STATUS( "| pressure X  large X: Processes of X MB or more wait for smaller ones; hold on: launches wait (but critical).");
+  PRINT_STATUS( "| coop X      Shows cooperating Processes (yields, blocks, progress), or Sets whether launches may cooperate (on, off).");
+  PRINT_STATUS( "| zygote X    Shows or Sets whether launches take a stub forked ahead by the zygote (on) or fork shvm (off).");
+  PRINT_STATUS( "| output X    Shows or Sets whether Process output is kept in memory (on) or goes to the terminal (off).");
+  PRINT_STATUS( "| output X    Prints all the output kept for the Process with PID X.");
+  PRINT_STATUS( "| tail X N    Prints the last N lines (default %d) of the output of the Process with PID X.", OUTPUT_TAIL_LINES);
   PRINT_STATUS( "| delaytime X Sets the delaytime to X usec.");
   PRINT_STATUS( "| quit        Exits StrawHat-VM.");
   PRINT_STATUS( "+------------------");
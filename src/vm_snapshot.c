@@ -0,0 +1,254 @@
+/* Standard Library Includes */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+/* Linux System API Includes */
+#include <pthread.h>
+/* StrawHat VM Includes */
+#include "vm.h"
+#include "vm_snapshot.h"
+#include "vm_support.h"
+#include "vm_settings.h"
+
+/* The Summary
+ * - Only written by snapshot_changed, with the schedule locked, so there's one writer at a time.
+ *   Readers take no lock: updates is odd while it's being written, and a reader retries if it was
+ *   odd or has moved on by the time it's done.
+ */
+static Snapshot_summary_s summary = {0};
+static unsigned long updates = 0;
+
+/* Published Copies
+ * - Publishers are already serialized by the schedule lock.  snap_m is only ever held to swap the
+ *   latest copy or count references, never while a copy is made or printed.
+ */
+static pthread_mutex_t snap_m = PTHREAD_MUTEX_INITIALIZER;
+static Snapshot_s *latest = NULL;
+static Snapshot_s *spare = NULL;   // Replaced and unread, kept for the next copy
+static const char *place_names[SNAP_PLACES] = { "cpu", "cpu", "high", "normal", "wait", "pending", "defunct" };
+
+/* Local Prototypes */
+static int add_process(Snapshot_s *snap, Otur_process_s *node, int place);
+static void release(Snapshot_s *snap);
+static void free_snapshot(Snapshot_s *snap);
+
+/* Records a change to the schedule (call with the schedule locked, as it's unlocked).
+ * Only counts are read and nothing is allocated, so this is safe in the SIGCHLD handler.
+ */
+void snapshot_changed(Otur_schedule_s *schedule, Otur_process_s *on_cpu, int also_count) {
+  __atomic_add_fetch(&updates, 1, __ATOMIC_SEQ_CST);
+  summary.version++;
+  summary.count[SNAP_CPU] = (on_cpu != NULL);
+  summary.count[SNAP_ALSO] = also_count;
+  summary.count[SNAP_HIGH] = schedule->ready_queue_high->count;
+  summary.count[SNAP_NORMAL] = schedule->ready_queue_normal->count;
+  summary.count[SNAP_WAIT] = schedule->wait_queue->count;
+  summary.count[SNAP_PENDING] = schedule->pending_queue->count;
+  summary.count[SNAP_DEFUNCT] = schedule->defunct_queue->count;
+  summary.on_cpu = (on_cpu != NULL) ? on_cpu->pid : 0;
+  __atomic_add_fetch(&updates, 1, __ATOMIC_SEQ_CST);
+}
+
+/* Copies out the summary as of the last change, from any thread, without the schedule lock */
+void snapshot_summary(Snapshot_summary_s *out) {
+  unsigned long before = 0;
+  do {
+    before = __atomic_load_n(&updates, __ATOMIC_SEQ_CST);
+    memcpy(out, &summary, sizeof(Snapshot_summary_s));
+  } while((before & 1) || __atomic_load_n(&updates, __ATOMIC_SEQ_CST) != before);
+}
+
+/* Returns 1 if the schedule has changed since the latest copy was made (or there is none yet) */
+int snapshot_stale() {
+  Snapshot_summary_s now;
+  snapshot_summary(&now);
+  pthread_mutex_lock(&snap_m);
+  int stale = (latest == NULL || latest->version != now.version);
+  pthread_mutex_unlock(&snap_m);
+  return stale;
+}
+
+/* Publishes a copy of the schedule as it is now (call with the schedule locked, only when it's stale) */
+void snapshot_publish(Otur_schedule_s *schedule, Otur_process_s *on_cpu, Otur_process_s **also, int also_count) {
+  pthread_mutex_lock(&snap_m);
+  Snapshot_s *snap = spare;
+  spare = NULL;
+  pthread_mutex_unlock(&snap_m);
+  if(snap == NULL && (snap = calloc(1, sizeof(Snapshot_s))) == NULL) {
+    return; // Readers keep the last copy
+  }
+  memset(snap->count, 0, sizeof(snap->count));
+  snap->total = 0;
+
+  // Views first (pointing into the intern table), adding up the strings they need
+  Otur_queue_s *queues[] = { schedule->ready_queue_high, schedule->ready_queue_normal, schedule->wait_queue,
+                             schedule->pending_queue, schedule->defunct_queue };
+  size_t bytes = 0;
+  int ok = (on_cpu == NULL || (bytes += add_process(snap, on_cpu, SNAP_CPU)) > 0);
+  for(int i = 0; i < also_count && ok; i++) {
+    ok = ((bytes += add_process(snap, also[i], SNAP_ALSO)) > 0);
+  }
+  for(int i = 0; i < 5 && ok; i++) {
+    for(Otur_process_s *walker = otur_first(queues[i]); walker != NULL && ok; walker = otur_next(walker)) {
+      int added = add_process(snap, walker, SNAP_HIGH + i);
+      bytes += added;
+      ok = (added > 0);
+    }
+  }
+
+  // Then the strings, so the copy no longer points at anything that can change
+  if(ok && bytes > snap->strings_size) {
+    char *strings = realloc(snap->strings, bytes);
+    ok = (strings != NULL);
+    if(ok) {
+      snap->strings = strings;
+      snap->strings_size = bytes;
+    }
+  }
+  if(!ok) {
+    free_snapshot(snap);
+    return;
+  }
+  char *next = snap->strings;
+  for(int i = 0; i < snap->total; i++) {
+    Process_view_s *view = &snap->procs[i].view;
+    size_t len = strlen(view->cmd) + 1;
+    memcpy(next, view->cmd, len);
+    view->cmd = next;
+    next += len;
+    if(view->gang != NULL) {
+      len = strlen(view->gang) + 1;
+      memcpy(next, view->gang, len);
+      view->gang = next;
+      next += len;
+    }
+  }
+  clock_gettime(CLOCK_MONOTONIC, &snap->taken);
+  snap->version = summary.version; // Can't move while the schedule is locked
+  snap->refs = 1;
+
+  pthread_mutex_lock(&snap_m);
+  Snapshot_s *old = latest;
+  latest = snap;
+  if(old != NULL) {
+    release(old);
+  }
+  pthread_mutex_unlock(&snap_m);
+}
+
+/* Returns the latest copy of the schedule (or NULL before the first), held until snapshot_put */
+const Snapshot_s *snapshot_get() {
+  pthread_mutex_lock(&snap_m);
+  Snapshot_s *snap = latest;
+  if(snap != NULL) {
+    snap->refs++;
+  }
+  pthread_mutex_unlock(&snap_m);
+  return snap;
+}
+
+/* Lets go of a copy from snapshot_get */
+void snapshot_put(const Snapshot_s *snap) {
+  if(snap == NULL) {
+    return;
+  }
+  pthread_mutex_lock(&snap_m);
+  release((Snapshot_s *)snap);
+  pthread_mutex_unlock(&snap_m);
+}
+
+/* Returns the name of a place (SNAP_*), as the control socket reports it */
+const char *snapshot_place_name(int place) {
+  return (place >= 0 && place < SNAP_PLACES) ? place_names[place] : "unknown";
+}
+
+/* Prints a copy of the schedule, laid out as print_schedule lays out the live one */
+void print_snapshot(const Snapshot_s *snap) {
+  if(snap == NULL) {
+    return;
+  }
+  struct timespec now;
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  double age = (now.tv_sec - snap->taken.tv_sec) * 1000.0 + (now.tv_nsec - snap->taken.tv_nsec) / 1000000.0;
+  int queued = snap->total - snap->count[SNAP_CPU] - snap->count[SNAP_ALSO];
+
+  PRINT_STATUS("Printing the current Status... (version %lu, %.1f ms ago)", snap->version, age);
+  PRINT_STATUS("Running Process (Note: Processes run briefly, so this is usually empty.)");
+  const char *headers[SNAP_PLACES] = {
+    "...[CPU Execution    - %2d Process%s]",
+    "...[Also on the CPUs - %2d Process%s]",
+    "...[Ready Queue - High   - %2d Process%s]",
+    "...[Ready Queue - Normal - %2d Process%s]",
+    "...[Wait Queue           - %2d Process%s]",
+    "...[Pending Queue        - %2d Process%s]",
+    "...[Defunct Queue        - %2d Process%s]"
+  };
+  int i = 0;
+  for(int place = SNAP_CPU; place < SNAP_PLACES; place++) {
+    if(place == SNAP_ALSO && snap->count[SNAP_ALSO] == 0) {
+      continue;
+    }
+    if(place == SNAP_HIGH) {
+      PRINT_STATUS("Schedule - %d Processes across all Queues", queued);
+    }
+    PRINT_STATUS(headers[place], snap->count[place], snap->count[place] == 1 ? "" : "es");
+    for(; i < snap->total && snap->procs[i].place == place; i++) {
+      print_process_view(&snap->procs[i].view);
+    }
+  }
+}
+
+/* Frees the latest copy and the spare (at shutdown, with no readers left) */
+void snapshot_free() {
+  pthread_mutex_lock(&snap_m);
+  if(latest != NULL) {
+    release(latest);
+    latest = NULL;
+  }
+  if(spare != NULL) {
+    free_snapshot(spare);
+    spare = NULL;
+  }
+  pthread_mutex_unlock(&snap_m);
+}
+
+/* Adds a process' view to a copy being made.
+ * Returns the bytes its strings need, or 0 if there was no room for it.
+ */
+static int add_process(Snapshot_s *snap, Otur_process_s *node, int place) {
+  if((size_t)snap->total == snap->procs_size) {
+    size_t size = snap->procs_size ? snap->procs_size * 2 : 64;
+    Snapshot_process_s *procs = realloc(snap->procs, size * sizeof(Snapshot_process_s));
+    if(procs == NULL) {
+      return 0;
+    }
+    snap->procs = procs;
+    snap->procs_size = size;
+  }
+  Snapshot_process_s *proc = &snap->procs[snap->total++];
+  proc->place = place;
+  process_view(node, &proc->view);
+  snap->count[place]++;
+  return strlen(proc->view.cmd) + 1 + (proc->view.gang ? strlen(proc->view.gang) + 1 : 0);
+}
+
+/* Drops a reference to a copy; the last one keeps it as the spare, or frees it (snap_m held) */
+static void release(Snapshot_s *snap) {
+  if(--snap->refs > 0) {
+    return;
+  }
+  if(spare == NULL) {
+    spare = snap;
+  }
+  else {
+    free_snapshot(snap);
+  }
+}
+
+/* Frees a copy and everything in it */
+static void free_snapshot(Snapshot_s *snap) {
+  free(snap->procs);
+  free(snap->strings);
+  free(snap);
+}
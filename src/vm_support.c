@@ -1,12 +1,18 @@
 /* Standard Library Includes */
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 /* Linux System API Includes */
 #include <signal.h>
 #include <unistd.h>
+#include <fcntl.h>
 #include <sys/types.h>
 #include <sys/wait.h>
 #include <sys/time.h>
+#include <sys/resource.h>
+#include <sys/syscall.h>
+#include <sched.h>
+#include <errno.h>
 /* StrawHat Function Includes */
 #include "vm.h"
 #include "vm_cs.h"
@@ -15,28 +21,6 @@
 #include "vm_printing.h"
 #include "vm_support.h"
 
-static int is_high(Otur_process_s *node) {
-  return(node && ((node->state >> 15)&1));
-}
-static int is_running(Otur_process_s *node) {
-  return(node && ((node->state >> 14)&1));
-}
-static int is_ready(Otur_process_s *node) {
-  return(node && ((node->state >> 13)&1));
-}
-static int is_defunct(Otur_process_s *node) {
-  return(node && ((node->state >> 12)&1));
-}
-static int is_critical(Otur_process_s *node) {
-  return(node && ((node->state >> 11)&1));
-}
-static int get_ec(Otur_process_s *node) {
-  if(!node) {
-    return -1;
-  }
-  return (node->state & ((1 << 8)-1));
-}
-
 /* Quickly registers a new signal with the given signal number and handler
  * Exits the program on errors with signal registration.
  */
@@ -118,12 +102,14 @@ void print_schedule(Otur_schedule_s *schedule, Otur_process_s *on_cpu) {
   int rqh_count = otur_count(schedule->ready_queue_high);
   int rqn_count = otur_count(schedule->ready_queue_normal);
   int dq_count = otur_count(schedule->defunct_queue);
+  int wq_count = otur_count(schedule->wait_queue);
+  int pq_count = otur_count(schedule->pending_queue);
 
-  if(rqh_count == -1 || rqn_count == -1 || dq_count == -1) {
+  if(rqh_count == -1 || rqn_count == -1 || dq_count == -1 || wq_count == -1 || pq_count == -1) {
     ABORT_ERROR("otur_count returned an Error Condition.");
   }
 
-  int total_scheduled_processes = rqh_count + rqn_count + dq_count;
+  int total_scheduled_processes = rqh_count + rqn_count + dq_count + wq_count + pq_count;
   PRINT_STATUS("Printing the current Status...");
   PRINT_STATUS("Running Process (Note: Processes run briefly, so this is usually empty.)");
 
@@ -153,6 +139,12 @@ void print_schedule(Otur_schedule_s *schedule, Otur_process_s *on_cpu) {
   }
   PRINT_STATUS("...[Ready Queue - Normal - %2d Process%s]", count, count==1?"":"es");
   print_otur_queue(schedule->ready_queue_normal);
+  // Wait Queue (Blocked)
+  PRINT_STATUS("...[Wait Queue           - %2d Process%s]", wq_count, wq_count==1?"":"es");
+  print_otur_queue(schedule->wait_queue);
+  // Pending Queue (waiting on other processes to finish)
+  PRINT_STATUS("...[Pending Queue        - %2d Process%s]", pq_count, pq_count==1?"":"es");
+  print_otur_queue(schedule->pending_queue);
   // Defunct Queue
   count = otur_count(schedule->defunct_queue);
   if(count == -1) {
@@ -170,10 +162,10 @@ void print_otur_queue(Otur_queue_s *queue) {
   }
 
   // Iterate the queue and print each process
-  Otur_process_s *walker = queue->head;
+  Otur_process_s *walker = otur_first(queue);
   while(walker != NULL) {
     print_process_node(walker);
-    walker = walker->next;
+    walker = otur_next(walker);
   }
 }
 
@@ -183,27 +175,176 @@ void print_process_node(Otur_process_s *node) {
   if(node == NULL) {
     return;
   }
+  Process_view_s view;
+  print_process_view(process_view(node, &view));
+}
+
+/* Copies what is printed about a process out of the schedule into view.  Returns view.
+ * - cmd and gang still point into the intern table; copy them too if view has to outlive the node.
+ */
+Process_view_s *process_view(Otur_process_s *node, Process_view_s *view) {
+  view->pid = node->pid;
+  process_flags_string(node, view->flags);
+  view->age = otur_age(node);
+  view->exit_code = process_exit_code(node);
+  view->quantum = otur_quantum(node);
+  view->usage = otur_usage(node);
+  view->path = otur_path(node);
+  view->predicted = otur_predicted(node);
+  view->fixed = otur_fixed_quantum(node);
+  view->level = otur_level(node);
+  view->cpus = otur_cpus(node);
+  view->cmd = otur_cmd(node);
+  view->gang = (otur_gang(node) != OTUR_STR_NIL) ? otur_gang_name(node) : NULL;
+  return view;
+}
+
+// Prints a process as copied out of the schedule (see process_view)
+void print_process_view(const Process_view_s *view) {
+  // What the Scheduler has learned about it so far (see otur_learn)
+  char learned[160 + MAX_GANG_NAME] = ", Quantum:    - ms, CPU:   -%";
+  if(view->usage != OTUR_USAGE_UNKNOWN) {
+    snprintf(learned, sizeof(learned), ", Quantum: %4u ms, CPU: %3u%%",
+        view->quantum / 1000, (view->usage + 5) / 10);
+  }
+
+  // Processes others wait on are listed with the longest chain waiting behind them
+  if(view->path > 0) {
+    size_t len = strlen(learned);
+    snprintf(learned + len, sizeof(learned) - len, ", Path: %u", view->path);
+  }
+  // What earlier runs of its command predict it needs, while it's still running (see policy sjf)
+  if(view->predicted > 0 && view->exit_code == -1) {
+    size_t len = strlen(learned);
+    snprintf(learned + len, sizeof(learned) - len, ", Predict: %u ms", view->predicted / 1000);
+  }
+  // What it asked for at launch (-q, -p, -cpu)
+  if(view->fixed > 0) {
+    size_t len = strlen(learned);
+    snprintf(learned + len, sizeof(learned) - len, ", Fixed: %u ms", view->fixed / 1000);
+  }
+  if(view->level > 0) {
+    size_t len = strlen(learned);
+    snprintf(learned + len, sizeof(learned) - len, ", Level: %d", view->level);
+  }
+  if(view->cpus != 0) {
+    size_t len = strlen(learned);
+    snprintf(learned + len, sizeof(learned) - len, ", CPUs: %#llx", (unsigned long long)view->cpus);
+  }
+  // Gang mates are listed with the gang's name
+  if(view->gang != NULL) {
+    size_t len = strlen(learned);
+    snprintf(learned + len, sizeof(learned) - len, ", Gang: %s", view->gang);
+  }
+
   // If Process has Terminated
-  if(is_defunct(node)) {
-    PRINT_STATUS("     [PID: %7d] %-26s ... Flags: [%c%c%c%c%c], Age: %2d, Exit Code: %d",
-        node->pid, node->cmd,  
-        is_high(node)?    'H':' ',
-        is_running(node)? 'U':' ',
-        is_ready(node)?   'R':' ',
-        is_defunct(node)? 'D':' ',
-        is_critical(node)?'C':' ',
-        node->age,
-        get_ec(node));
+  if(view->exit_code != -1) {
+    PRINT_STATUS("     [PID: %7d] %-26s ... Flags: [%s], Age: %2d%s, Exit Code: %d",
+        view->pid, view->cmd, view->flags, view->age, learned, view->exit_code);
   }
   // If Process has not Terminated Yet
   else {
-    PRINT_STATUS("     [PID: %7d] %-26s ... Flags: [%c%c%c%c%c], Age: %2d",
-        node->pid, node->cmd,  
-        is_high(node)?    'H':' ',
-        is_running(node)? 'U':' ',
-        is_ready(node)?   'R':' ',
-        is_defunct(node)? 'D':' ',
-        is_critical(node)?'C':' ',
-        node->age);
+    PRINT_STATUS("     [PID: %7d] %-26s ... Flags: [%s], Age: %2d%s",
+        view->pid, view->cmd, view->flags, view->age, learned);
+  }
+}
+
+/* Writes the [H,U,R,D,C] flags of a process into flags (PROCESS_FLAGS_LEN bytes).
+ * Unset flags are written as spaces.  Returns flags.
+ */
+char *process_flags_string(Otur_process_s *node, char *flags) {
+  uint32_t state = node ? otur_state(node) : 0; // One read, so the flags all come from the same moment
+  flags[0] = (state & OTUR_HIGH)?    'H':' ';
+  flags[1] = (state & OTUR_RUNNING)? 'U':' ';
+  flags[2] = (state & OTUR_READY)?   'R':' ';
+  flags[3] = (state & OTUR_DEFUNCT)? 'D':' ';
+  flags[4] = (state & OTUR_CRITICAL)?'C':' ';
+  flags[5] = '\0';
+  return flags;
+}
+
+/* Returns the Exit Code of a defunct process, or -1 if it has not terminated. */
+int process_exit_code(Otur_process_s *node) {
+  uint32_t state = node ? otur_state(node) : 0;
+  if(!(state & OTUR_DEFUNCT)) {
+    return -1;
+  }
+  return state & OTUR_EXIT_MASK;
+}
+
+/* Returns the kernel's state letter for a process (eg. R running, S sleeping, D waiting on I/O,
+ * T stopped, Z zombie), read from /proc/<pid>/stat with a single read, or 0 if it can't be read.
+ */
+char proc_run_state(pid_t pid) {
+  char path[64];
+  char buf[512];
+  snprintf(path, sizeof(path), "/proc/%d/stat", pid);
+
+  int fd = open(path, O_RDONLY);
+  if(fd == -1) {
+    return 0;
+  }
+  ssize_t len = read(fd, buf, sizeof(buf) - 1);
+  close(fd);
+  if(len <= 0) {
+    return 0;
+  }
+  buf[len] = '\0';
+
+  // The command name is in parentheses and may hold anything, so find the last ')'.
+  char *end = strrchr(buf, ')');
+  if(end == NULL || end[1] != ' ' || end[2] == '\0') {
+    return 0;
+  }
+  return end[2];
+}
+
+/* Returns the CPU time a process has used so far in usec, from the first field of
+ * /proc/<pid>/schedstat (nanoseconds on the CPU), or -1 if it can't be read.
+ */
+long long proc_cpu_usec(pid_t pid) {
+  char path[64];
+  char buf[128];
+  snprintf(path, sizeof(path), "/proc/%d/schedstat", pid);
+
+  int fd = open(path, O_RDONLY);
+  if(fd == -1) {
+    return -1;
+  }
+  ssize_t len = read(fd, buf, sizeof(buf) - 1);
+  close(fd);
+  if(len <= 0) {
+    return -1;
+  }
+  buf[len] = '\0';
+  return strtoll(buf, NULL, 10) / 1000;
+}
+
+/* Sets the kernel's scheduling class (SCHED_OTHER, SCHED_BATCH or SCHED_IDLE) and nice value for a process,
+ *   with one sched_setattr call where the kernel has it.
+ * Returns 0 on success, or -1 if the kernel refused (eg. lowering nice needs CAP_SYS_NICE or RLIMIT_NICE).
+ */
+int proc_set_sched(pid_t pid, int policy, int nice) {
+#ifdef SYS_sched_setattr
+  // glibc has no wrapper on older systems, so this is the kernel's own layout (SCHED_ATTR_SIZE_VER0).
+  struct {
+    uint32_t size;
+    uint32_t sched_policy;
+    uint64_t sched_flags;
+    int32_t sched_nice;
+    uint32_t sched_priority;
+    uint64_t sched_runtime, sched_deadline, sched_period;
+  } attr = { .size = 48, .sched_policy = policy, .sched_nice = nice };
+  if(syscall(SYS_sched_setattr, pid, &attr, 0) == 0) {
+    return 0;
+  }
+  if(errno != ENOSYS) {
+    return -1;
+  }
+#endif
+  struct sched_param param = { .sched_priority = 0 };
+  if(sched_setscheduler(pid, policy, &param) == -1) {
+    return -1;
   }
+  return setpriority(PRIO_PROCESS, pid, nice);
 }
@@ -0,0 +1,491 @@
+#define _GNU_SOURCE // CLONE_PARENT
+/* Standard Library Includes */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stddef.h>
+#include <errno.h>
+#include <time.h>
+/* Linux System API Includes */
+#include <signal.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sched.h>
+#include <poll.h>
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <sys/uio.h>
+#include <sys/syscall.h>
+#include <sys/wait.h>
+/* StrawHat VM Includes */
+#include "vm.h"
+#include "vm_zygote.h"
+#include "vm_support.h"
+#include "vm_settings.h"
+
+/* Local Definitions */
+enum zygote_messages { ZYGOTE_STUB = 0, ZYGOTE_LAUNCHED };
+
+/* A command for a stub, from shvm through the zygote (with the fd for its output, if captured) */
+typedef struct zygote_request {
+  char path[MAX_PATH];           // Where it was found, empty if it wasn't
+  char cmd[MAX_CMD];             // As given, for the library's own search if path fails
+  int argc;
+  char args[MAX_CMD + MAX_ARGS]; // Each argument ending in '\0'
+} Zygote_request_s;
+
+/* From the zygote: a new idle stub, or the stub that took a command (-1 if none could) */
+typedef struct zygote_message {
+  int kind;
+  pid_t pid;
+} Zygote_message_s;
+
+/* A resolved command */
+typedef struct zygote_path {
+  char cmd[MAX_CMD];
+  char path[MAX_PATH];
+} Zygote_path_s;
+
+/* The Zygote, as seen from shvm */
+static int zygote_fd = -1;       // Socket to the zygote (kept after it's gone, for its last messages)
+static pid_t zygote_pid = -1;
+static int zygote_up = 0;        // 0 once it has exited or been stopped
+static int enabled = DEFAULT_ZYGOTE;
+static pid_t idle[ZYGOTE_STUBS]; // Stubs it has announced and not handed out
+static int idle_count = 0;
+static Process_data_s *armed = NULL; // The launch the next fork() is for
+static int armed_out = -1;           // Its stdout and stderr, -1 to keep shvm's
+
+/* Launch Statistics */
+static long zygote_launches = 0;
+static long long zygote_nsec = 0;
+static long direct_launches = 0;
+static long long direct_nsec = 0;
+
+/* Resolved Paths (hashed by command, a collision replaces) */
+static Zygote_path_s paths[ZYGOTE_PATHS];
+static long path_hits = 0;
+
+/* Local Prototypes */
+pid_t __real_fork(void);
+pid_t __wrap_fork(void);
+static pid_t zygote_launch(Process_data_s *proc);
+static void resolve_path(const char *cmd, char *path, size_t size);
+static void note_message(Zygote_message_s *msg);
+static void drain_messages();
+static void zygote_main(int fd);
+static int fork_stub(int fd, int links[], int count, pid_t *stub, int *link);
+static void stub_main(int in, int ready);
+static ssize_t send_with_fd(int fd, const void *buf, size_t len, int pass_fd);
+static ssize_t recv_with_fd(int fd, void *buf, size_t len, int *got_fd);
+
+/* Forks the zygote.  Call before shvm has any threads or signal handlers.
+ * Returns 0 on success or -1 if there's no zygote (launches then fork shvm, as before).
+ */
+int zygote_start() {
+  int fds[2];
+  if(socketpair(AF_UNIX, SOCK_SEQPACKET | SOCK_CLOEXEC, 0, fds) == -1) {
+    PRINT_WARNING("Could not start the launch zygote: %s", strerror(errno));
+    return -1;
+  }
+  fflush(NULL); // Nothing buffered may be printed twice
+  pid_t pid = __real_fork();
+  if(pid == -1) {
+    PRINT_WARNING("Could not start the launch zygote: %s", strerror(errno));
+    close(fds[0]);
+    close(fds[1]);
+    return -1;
+  }
+  if(pid == 0) {
+    close(fds[0]);
+    zygote_main(fds[1]);
+  }
+  close(fds[1]);
+  zygote_fd = fds[0];
+  zygote_pid = pid;
+  zygote_up = 1;
+  return 0;
+}
+
+/* Runs create_process with its fork answered by an idle stub, when the zygote is up.
+ * - out becomes its stdout and stderr (-1 to keep shvm's); the caller still owns and closes it.
+ */
+void zygote_create_process(Process_data_s *proc, int out) {
+  armed = proc;
+  armed_out = out;
+  create_process(proc);
+  armed = NULL;
+  armed_out = -1;
+}
+
+/* Sets whether launches go through the zygote (1) or fork shvm (0) */
+void zygote_set_enabled(int on) {
+  enabled = on;
+}
+
+/* Reaps the zygote and its idle stubs if they've exited, so the Process System's SIGCHLD handler
+ *   never sees them (it only knows the children it launched).
+ * - Call from the SIGCHLD handler, before the Process System's own.
+ * Returns how many were reaped.
+ */
+int zygote_reap() {
+  if(zygote_fd == -1) {
+    return 0;
+  }
+  drain_messages();
+  int reaped = 0;
+  if(zygote_pid != -1 && waitpid(zygote_pid, NULL, WNOHANG) == zygote_pid) {
+    if(zygote_up) {
+      PRINT_WARNING("The launch zygote (PID %d) exited, launches fork shvm again", zygote_pid);
+    }
+    zygote_up = 0;
+    zygote_pid = -1;
+    reaped++;
+    drain_messages(); // Its last stubs, which exit with it
+  }
+  for(int i = 0; i < idle_count; ) {
+    if(waitpid(idle[i], NULL, WNOHANG) == idle[i]) {
+      PRINT_DEBUG("Idle launch stub PID %d exited", idle[i]);
+      idle[i] = idle[--idle_count];
+      reaped++;
+    }
+    else {
+      i++;
+    }
+  }
+  return reaped;
+}
+
+/* Prints where launches fork from, and how long the fork has taken each way */
+void print_zygote() {
+  if(zygote_up) {
+    PRINT_STATUS("Launcher: %s (zygote PID %d, %d stubs ready, %ld paths resolved from cache)",
+        enabled ? "zygote stubs" : "fork shvm", zygote_pid, idle_count, path_hits);
+  }
+  else {
+    PRINT_STATUS("Launcher: fork shvm (no launch zygote)");
+  }
+  PRINT_STATUS("     %6ld launches from stubs, averaging %8.1f usec to fork",
+      zygote_launches, zygote_launches ? zygote_nsec / 1000.0 / zygote_launches : 0.0);
+  PRINT_STATUS("     %6ld launches forking shvm, averaging %8.1f usec to fork",
+      direct_launches, direct_launches ? direct_nsec / 1000.0 / direct_launches : 0.0);
+}
+
+/* Stops the zygote (it exits when it sees this, and its idle stubs with it) */
+void zygote_stop() {
+  if(zygote_up) {
+    zygote_up = 0;
+    shutdown(zygote_fd, SHUT_WR);
+  }
+}
+
+/* Replaces fork() for the Process System: the armed launch gets an idle stub instead.
+ * - The stub is already stopped, and execs the command once it's continued.
+ */
+pid_t __wrap_fork(void) {
+  struct timespec start, end;
+  clock_gettime(CLOCK_MONOTONIC, &start);
+
+  pid_t pid = -1;
+  if(armed != NULL && enabled && zygote_up) {
+    pid = zygote_launch(armed);
+  }
+  int from_stub = (pid > 0);
+  if(!from_stub) {
+    pid = __real_fork();
+  }
+  if(pid == 0) {
+    // shvm keeps SIGINT blocked for the Dispatcher to read (see vm_cs.c), and the mask survives exec
+    sigset_t mask;
+    sigemptyset(&mask);
+    sigaddset(&mask, SIGINT);
+    sigprocmask(SIG_UNBLOCK, &mask, NULL);
+  }
+  if(pid == 0 && armed != NULL && armed_out != -1) {
+    dup2(armed_out, STDOUT_FILENO); // The copies don't close on exec, the original does
+    dup2(armed_out, STDERR_FILENO);
+  }
+  if(pid > 0) {
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    long long nsec = (end.tv_sec - start.tv_sec) * 1000000000LL + (end.tv_nsec - start.tv_nsec);
+    if(from_stub) {
+      zygote_launches++;
+      zygote_nsec += nsec;
+    }
+    else {
+      direct_launches++;
+      direct_nsec += nsec;
+    }
+  }
+  return pid;
+}
+
+/* Hands a command to an idle stub.  Returns its pid, or -1 to fork shvm instead. */
+static pid_t zygote_launch(Process_data_s *proc) {
+  Zygote_request_s req;
+  memset(&req, 0, offsetof(Zygote_request_s, args));
+  resolve_path(proc->cmd, req.path, sizeof(req.path));
+  snprintf(req.cmd, sizeof(req.cmd), "%s", proc->cmd);
+  size_t used = 0;
+  for(int i = 0; i < MAX_ARGS && proc->argv[i] != NULL; i++) {
+    size_t len = strlen(proc->argv[i]) + 1;
+    if(used + len > sizeof(req.args)) {
+      return -1;
+    }
+    memcpy(req.args + used, proc->argv[i], len);
+    used += len;
+    req.argc++;
+  }
+
+  size_t size = offsetof(Zygote_request_s, args) + used;
+  ssize_t n;
+  do {
+    n = send_with_fd(zygote_fd, &req, size, armed_out);
+  } while(n == -1 && errno == EINTR);
+  if(n != (ssize_t)size) {
+    return -1; // Its SIGCHLD will say it's gone
+  }
+
+  // Stubs it has forked since the last launch come first
+  while(1) {
+    Zygote_message_s msg;
+    do {
+      n = recv(zygote_fd, &msg, sizeof(msg), 0);
+    } while(n == -1 && errno == EINTR);
+    if(n != sizeof(msg)) {
+      return -1;
+    }
+    note_message(&msg);
+    if(msg.kind == ZYGOTE_LAUNCHED) {
+      return msg.pid;
+    }
+  }
+}
+
+/* Finds a command where the library would: as given, then in /usr/bin.  Found paths are cached. */
+static void resolve_path(const char *cmd, char *path, size_t size) {
+  unsigned int hash = 2166136261u;
+  for(const char *c = cmd; *c; c++) {
+    hash = (hash ^ (unsigned char)*c) * 16777619u;
+  }
+  Zygote_path_s *entry = &paths[hash % ZYGOTE_PATHS];
+  if(entry->path[0] != '\0' && strcmp(entry->cmd, cmd) == 0) {
+    snprintf(path, size, "%s", entry->path);
+    path_hits++;
+    return;
+  }
+
+  char found[MAX_PATH];
+  snprintf(found, sizeof(found), "%s", cmd);
+  if(access(found, X_OK) == -1) {
+    snprintf(found, sizeof(found), "/usr/bin/%s", cmd);
+    if(access(found, X_OK) == -1) {
+      path[0] = '\0'; // Not cached, it may turn up later
+      return;
+    }
+  }
+  snprintf(entry->cmd, sizeof(entry->cmd), "%s", cmd);
+  snprintf(entry->path, sizeof(entry->path), "%s", found);
+  snprintf(path, size, "%s", found);
+}
+
+/* Keeps track of the idle stubs from a message */
+static void note_message(Zygote_message_s *msg) {
+  if(msg->kind == ZYGOTE_STUB) {
+    if(idle_count < ZYGOTE_STUBS) {
+      idle[idle_count++] = msg->pid;
+    }
+    return;
+  }
+  for(int i = 0; i < idle_count; i++) {
+    if(idle[i] == msg->pid) {
+      idle[i] = idle[--idle_count];
+      break;
+    }
+  }
+}
+
+/* Reads the stubs announced since the last launch, without waiting */
+static void drain_messages() {
+  Zygote_message_s msg;
+  while(recv(zygote_fd, &msg, sizeof(msg), MSG_DONTWAIT) == sizeof(msg)) {
+    note_message(&msg);
+  }
+}
+
+/* The zygote: keeps ZYGOTE_STUBS stubs ready, handing one out for each request, until shvm is gone */
+static void zygote_main(int fd) {
+  setpgid(0, 0);            // Out of the terminal's foreground group, so Ctrl-C is shvm's alone
+  signal(SIGPIPE, SIG_IGN); // A stub that dies just as it gets its command must not take us with it
+
+  pid_t stubs[ZYGOTE_STUBS];
+  int links[ZYGOTE_STUBS];
+  int count = 0;
+  while(count < ZYGOTE_STUBS && fork_stub(fd, links, count, &stubs[count], &links[count]) == 0) {
+    count++;
+  }
+
+  while(1) {
+    Zygote_request_s req;
+    int out = -1;
+    ssize_t n = recv_with_fd(fd, &req, sizeof(req), &out);
+    if(n == -1 && errno == EINTR) {
+      continue;
+    }
+    if(n <= 0) {
+      break; // shvm has stopped us, or is gone
+    }
+    if(count == 0 && fork_stub(fd, links, count, &stubs[count], &links[count]) == 0) {
+      count++;
+    }
+
+    Zygote_message_s reply = { ZYGOTE_LAUNCHED, -1 };
+    while(count > 0 && reply.pid == -1) {
+      count--;
+      // One that died has closed its end of the link (and its pid may be anyone's by now)
+      struct pollfd alive = { links[count], POLLOUT, 0 };
+      if(poll(&alive, 1, 0) == 1 && !(alive.revents & (POLLERR | POLLHUP))) {
+        // Stopped before it has the command, so it's held until it's scheduled, like the library's own children
+        kill(stubs[count], SIGSTOP);
+        if(send_with_fd(links[count], &req, n, out) == n) {
+          reply.pid = stubs[count];
+        }
+      }
+      close(links[count]);
+    }
+    if(out != -1) {
+      close(out); // Before the refill, so only the stub that took it holds it
+    }
+    send(fd, &reply, sizeof(reply), MSG_NOSIGNAL);
+    sched_yield(); // Let the launch finish first when we share a CPU with it
+
+    // Refill after answering, so the launch never waits on a fork
+    while(count < ZYGOTE_STUBS && fork_stub(fd, links, count, &stubs[count], &links[count]) == 0) {
+      count++;
+    }
+  }
+  _exit(EXIT_SUCCESS); // The idle stubs see their links close and exit too
+}
+
+/* Forks one stub as shvm's child (CLONE_PARENT) and tells shvm about it, once it leads its own
+ *   process group (which is what gets signalled once it's scheduled).
+ * Returns 0 on success or -1 on error.
+ */
+static int fork_stub(int fd, int links[], int count, pid_t *stub, int *link) {
+  int p[2], ready[2];
+  if(socketpair(AF_UNIX, SOCK_SEQPACKET | SOCK_CLOEXEC, 0, p) == -1) {
+    return -1;
+  }
+  if(pipe2(ready, O_CLOEXEC) == -1) {
+    close(p[0]);
+    close(p[1]);
+    return -1;
+  }
+  pid_t pid = syscall(SYS_clone, CLONE_PARENT | SIGCHLD, NULL, NULL, NULL, NULL);
+  if(pid == 0) {
+    close(p[1]);
+    close(ready[0]);
+    close(fd);
+    for(int i = 0; i < count; i++) {
+      close(links[i]);
+    }
+    stub_main(p[0], ready[1]);
+  }
+  close(p[0]);
+  close(ready[1]);
+  if(pid != -1) {
+    char c;
+    while(read(ready[0], &c, 1) == -1 && errno == EINTR); // EOF once it's ready (or gone)
+    Zygote_message_s msg = { ZYGOTE_STUB, pid };
+    send(fd, &msg, sizeof(msg), MSG_NOSIGNAL);
+  }
+  close(ready[0]);
+  if(pid == -1) {
+    close(p[1]);
+    return -1;
+  }
+  *stub = pid;
+  *link = p[1];
+  return 0;
+}
+
+/* A stub: waits for its command, then execs it the way the library's own children do */
+static void stub_main(int in, int ready) {
+  setpgid(0, 0); // Leader of its own process group, as create_process makes every process
+  close(ready);
+
+  Zygote_request_s req;
+  int out = -1;
+  ssize_t n;
+  do {
+    n = recv_with_fd(in, &req, sizeof(req), &out);
+  } while(n == -1 && errno == EINTR);
+  if(n < (ssize_t)offsetof(Zygote_request_s, args)) {
+    _exit(EXIT_SUCCESS); // The zygote is gone
+  }
+  close(in);
+  if(out != -1) {
+    dup2(out, STDOUT_FILENO);
+    dup2(out, STDERR_FILENO);
+    close(out);
+  }
+
+  char *argv[MAX_ARGS + 1] = {NULL};
+  char *arg = req.args;
+  for(int i = 0; i < req.argc && i < MAX_ARGS && arg < (char *)&req + n; i++) {
+    argv[i] = arg;
+    arg += strlen(arg) + 1;
+  }
+  signal(SIGPIPE, SIG_DFL); // Not ignored by what it runs
+
+  if(req.path[0] != '\0') {
+    execv(req.path, argv);
+  }
+  // The file moved since it was found: search again, as the library does
+  char path[MAX_PATH];
+  snprintf(path, sizeof(path), "%s", req.cmd);
+  execv(path, argv);
+  snprintf(path, sizeof(path), "/usr/bin/%s", req.cmd);
+  execv(path, argv);
+
+  PRINT_WARNING("Command %s not found!", req.cmd);
+  fflush(stdout);
+  kill(getpid(), SIGTERM);
+  _exit(EXIT_FAILURE);
+}
+
+/* Sends one message, passing pass_fd along with it unless it's -1 */
+static ssize_t send_with_fd(int fd, const void *buf, size_t len, int pass_fd) {
+  struct iovec iov = { (void *)buf, len };
+  char control[CMSG_SPACE(sizeof(int))] = {0};
+  struct msghdr msg = {0};
+  msg.msg_iov = &iov;
+  msg.msg_iovlen = 1;
+  if(pass_fd != -1) {
+    msg.msg_control = control;
+    msg.msg_controllen = sizeof(control);
+    struct cmsghdr *cmsg = CMSG_FIRSTHDR(&msg);
+    cmsg->cmsg_level = SOL_SOCKET;
+    cmsg->cmsg_type = SCM_RIGHTS;
+    cmsg->cmsg_len = CMSG_LEN(sizeof(int));
+    memcpy(CMSG_DATA(cmsg), &pass_fd, sizeof(int));
+  }
+  return sendmsg(fd, &msg, MSG_NOSIGNAL);
+}
+
+/* Receives one message, and the fd passed with it in got_fd (left alone if there was none) */
+static ssize_t recv_with_fd(int fd, void *buf, size_t len, int *got_fd) {
+  struct iovec iov = { buf, len };
+  char control[CMSG_SPACE(sizeof(int))];
+  struct msghdr msg = {0};
+  msg.msg_iov = &iov;
+  msg.msg_iovlen = 1;
+  msg.msg_control = control;
+  msg.msg_controllen = sizeof(control);
+  ssize_t n = recvmsg(fd, &msg, MSG_CMSG_CLOEXEC);
+  struct cmsghdr *cmsg = (n > 0) ? CMSG_FIRSTHDR(&msg) : NULL;
+  if(cmsg != NULL && cmsg->cmsg_level == SOL_SOCKET && cmsg->cmsg_type == SCM_RIGHTS) {
+    memcpy(got_fd, CMSG_DATA(cmsg), sizeof(int));
+  }
+  return n;
+}
@@ -0,0 +1,238 @@
+/* Standard Libraries */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <time.h>
+/* System Libraries */
+#include <unistd.h>
+#include <signal.h>
+#include <sys/types.h>
+#include <sys/time.h>
+#include <sys/resource.h>
+/* Project Libraries */
+#include "vm_printing.h"
+#include "shvm_job.h"
+
+/* Local Definitions */
+#define DEFAULT_SPIN_USEC   50000 // Length of one CPU-bound burst (50ms of CPU time)
+#define DEFAULT_SLEEP_USEC  50000 // Length of one I/O-bound sleep (50ms of wall time)
+#define DEFAULT_PATTERN     "c"   // c = CPU burst, i = I/O sleep, repeated in order
+#define DEFAULT_WORK_MSEC   1000  // Without -t or -w, stop after 1 sec of CPU work (of wall time if only 'i')
+#define PAGE_STRIDE         4096  // Touch one byte per page when walking the footprint
+
+/* Counters updated from the signal handlers */
+static volatile sig_atomic_t g_stops = 0; // SIGTSTP deliveries (scheduler suspends)
+static volatile sig_atomic_t g_conts = 0; // SIGCONT deliveries (scheduler resumes)
+
+/* Prints out the usage for this helper */
+static void print_usage(char *name) {
+  printf("Usage: %s [-s usec] [-i usec] [-p pattern] [-m KB] [-t msec] [-w msec] [-e code] [-y] [-v]\n", name);
+  printf("  -s usec     CPU time spent spinning in each 'c' phase (default %d)\n", DEFAULT_SPIN_USEC);
+  printf("  -i usec     Wall time spent sleeping in each 'i' phase (default %d)\n", DEFAULT_SLEEP_USEC);
+  printf("  -p pattern  Phases to repeat, eg. ccci (default %s)\n", DEFAULT_PATTERN);
+  printf("  -m KB       Memory footprint allocated and walked while spinning (default 0)\n");
+  printf("  -t msec     Stop once this much wall time has elapsed (default %d without -w, if the pattern is all 'i')\n",
+         DEFAULT_WORK_MSEC);
+  printf("  -w msec     Stop once this much CPU time has been used (default %d without -t, needs a 'c' phase)\n",
+         DEFAULT_WORK_MSEC);
+  printf("  -e code     Exit code to return when finished (default 0)\n");
+  printf("  -y          Cooperate with shvm: yield after each 'c' phase, block around each 'i' phase\n");
+  printf("  -v          Print a line after every pass through the pattern\n");
+}
+
+/* Handler for SIGTSTP: count it, then actually stop using the default action. */
+static void hnd_sigtstp(int sig) {
+  int saved_errno = errno;
+  g_stops++;
+
+  // Stop for real: restore the default action and let the pending signal through.
+  struct sigaction sa = {0};
+  sa.sa_handler = SIG_DFL;
+  sigaction(SIGTSTP, &sa, NULL);
+  sigset_t mask;
+  sigemptyset(&mask);
+  sigaddset(&mask, SIGTSTP);
+  raise(SIGTSTP);
+  sigprocmask(SIG_UNBLOCK, &mask, NULL); // Stops here until a SIGCONT arrives
+
+  // Resumed, so catch the next one again.
+  sa.sa_handler = hnd_sigtstp;
+  sigaction(SIGTSTP, &sa, NULL);
+  errno = saved_errno;
+}
+
+/* Handler for SIGCONT: count it and carry on. */
+static void hnd_sigcont(int sig) {
+  g_conts++;
+}
+
+/* Converts a base-10 argument, exiting with the usage on bad input. */
+static long extract_long(char *str, char *name) {
+  char *endptr = NULL;
+  long value = strtol(str, &endptr, 10);
+  if(*endptr != '\0' || *str == '\0' || value < 0) {
+    print_usage(name);
+    exit(EXIT_FAILURE);
+  }
+  return value;
+}
+
+/* Returns the given clock in microseconds. */
+static long long clock_usec(clockid_t clock) {
+  struct timespec ts = {0};
+  clock_gettime(clock, &ts);
+  return (long long)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+/* Spins on the CPU until usec of CPU time has been consumed.
+ * - Time spent stopped by the scheduler does not count towards the burst.
+ */
+static void spin_burst(long usec, char *mem, size_t mem_size) {
+  long long goal = clock_usec(CLOCK_PROCESS_CPUTIME_ID) + usec;
+  volatile unsigned long acc = 0;
+  size_t offset = 0;
+
+  while(clock_usec(CLOCK_PROCESS_CPUTIME_ID) < goal) {
+    for(int i = 0; i < 4096; i++) {
+      acc = acc * 2862933555777941757UL + 3037000493UL;
+    }
+    // Walk the footprint so the working set actually stays resident.
+    if(mem_size > 0) {
+      mem[offset] += (char)acc;
+      offset = (offset + PAGE_STRIDE) % mem_size;
+    }
+  }
+}
+
+/* Sleeps for usec of wall time, resuming the sleep if a signal interrupts it. */
+static void io_sleep(long usec) {
+  struct timespec req = { usec / 1000000, (usec % 1000000) * 1000 };
+  struct timespec rem = {0};
+  while(nanosleep(&req, &rem) == -1 && errno == EINTR) {
+    req = rem;
+  }
+}
+
+// Runs a synthetic mix of CPU bursts and I/O sleeps, then reports what it achieved.
+// Returns the exit code given with -e (0 by default).
+int main(int argc, char *argv[]) {
+  long spin_usec = DEFAULT_SPIN_USEC;
+  long sleep_usec = DEFAULT_SLEEP_USEC;
+  char *pattern = DEFAULT_PATTERN;
+  long mem_kb = 0;
+  long wall_msec = 0;
+  long work_msec = 0;
+  int exit_code = 0;
+  int verbose = 0;
+  int cooperate = 0;
+  int opt = 0;
+
+  while((opt = getopt(argc, argv, "s:i:p:m:t:w:e:yv")) != -1) {
+    switch(opt) {
+      case 's': spin_usec = extract_long(optarg, argv[0]);        break;
+      case 'i': sleep_usec = extract_long(optarg, argv[0]);       break;
+      case 'p': pattern = optarg;                                 break;
+      case 'm': mem_kb = extract_long(optarg, argv[0]);           break;
+      case 't': wall_msec = extract_long(optarg, argv[0]);        break;
+      case 'w': work_msec = extract_long(optarg, argv[0]);        break;
+      case 'e': exit_code = (int)extract_long(optarg, argv[0]);   break;
+      case 'y': cooperate = 1;                                    break;
+      case 'v': verbose = 1;                                      break;
+      default:
+        print_usage(argv[0]);
+        return EXIT_FAILURE;
+    }
+  }
+  if(strspn(pattern, "ci") != strlen(pattern) || pattern[0] == '\0') {
+    print_usage(argv[0]);
+    return EXIT_FAILURE;
+  }
+  // Sleeping uses next to no CPU time, so without a 'c' phase only wall time can end the run.
+  int spins = (strchr(pattern, 'c') != NULL);
+  if(work_msec > 0 && !spins) {
+    fprintf(stderr, "%s[PID: %d] workload -w needs a 'c' phase in the pattern, or it never finishes%s\n",
+            RED, getpid(), RST);
+    return EXIT_FAILURE;
+  }
+  if(wall_msec == 0 && work_msec == 0) {
+    if(spins) {
+      work_msec = DEFAULT_WORK_MSEC;
+    }
+    else {
+      wall_msec = DEFAULT_WORK_MSEC;
+    }
+  }
+
+  // Count the scheduler's suspend/resume cycles as they happen.
+  struct sigaction sa = {0};
+  sa.sa_handler = hnd_sigtstp;
+  sigaction(SIGTSTP, &sa, NULL);
+  sa.sa_handler = hnd_sigcont;
+  sigaction(SIGCONT, &sa, NULL);
+
+  // Allocate and fault in the memory footprint up front.
+  size_t mem_size = (size_t)mem_kb * 1024;
+  char *mem = NULL;
+  if(mem_size > 0) {
+    mem = malloc(mem_size);
+    if(mem == NULL) {
+      fprintf(stderr, "%s[PID: %d] workload could not allocate %ld KB%s\n", RED, getpid(), mem_kb, RST);
+      return EXIT_FAILURE;
+    }
+    memset(mem, 1, mem_size);
+  }
+
+  long long wall_start = clock_usec(CLOCK_MONOTONIC);
+  long long wall_goal = wall_msec ? wall_start + wall_msec * 1000LL : 0;
+  long long work_goal = work_msec ? work_msec * 1000LL : 0;
+  int passes = 0;
+  int done = 0;
+
+  // Repeat the pattern until one of the limits is reached.
+  while(!done) {
+    for(char *phase = pattern; *phase != '\0' && !done; phase++) {
+      if(*phase == 'c') {
+        spin_burst(spin_usec, mem, mem_size);
+        if(cooperate) {
+          shvm_yield(); // The burst is done, so is this slice
+        }
+      }
+      else {
+        if(cooperate) {
+          shvm_block();
+        }
+        io_sleep(sleep_usec);
+        if(cooperate) {
+          shvm_unblock();
+        }
+      }
+      done = (wall_goal && clock_usec(CLOCK_MONOTONIC) >= wall_goal) ||
+             (work_goal && clock_usec(CLOCK_PROCESS_CPUTIME_ID) >= work_goal);
+    }
+    passes++;
+    if(cooperate) {
+      shvm_progress(passes);
+    }
+    if(verbose) {
+      printf("%s[PID: %d] workload pass %d ...%s\n", BLUE, getpid(), passes, RST);
+    }
+  }
+
+  // Report what was actually achieved, as seen by this process.
+  struct rusage usage = {0};
+  getrusage(RUSAGE_SELF, &usage);
+  long long wall_usec = clock_usec(CLOCK_MONOTONIC) - wall_start;
+  printf("%s[PID: %d] workload done: cpu %ld.%06lds (user %ld.%06lds, sys %ld.%06lds), wall %lld.%06llds, "
+         "passes %d, stops %d, conts %d, exit %d%s\n", BLUE, getpid(),
+         (long)(usage.ru_utime.tv_sec + usage.ru_stime.tv_sec +
+                (usage.ru_utime.tv_usec + usage.ru_stime.tv_usec) / 1000000),
+         (long)((usage.ru_utime.tv_usec + usage.ru_stime.tv_usec) % 1000000),
+         (long)usage.ru_utime.tv_sec, (long)usage.ru_utime.tv_usec,
+         (long)usage.ru_stime.tv_sec, (long)usage.ru_stime.tv_usec,
+         wall_usec / 1000000, wall_usec % 1000000,
+         passes, (int)g_stops, (int)g_conts, exit_code, RST);
+
+  free(mem);
+  return exit_code;
+}